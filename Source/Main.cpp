@@ -18,9 +18,12 @@
 // Modules
 #include "Modules/Low/Engine.h"
 #include "Modules/Low/Inputs.h"
+#include "Modules/Low/Readback.h"
 #include "Modules/Low/RHI.h"
+#include "Modules/Low/RenderGraph.h"
 #include "Modules/Low/Window.h"
 
+#include "Modules/Medium/DynamicResolution.h"
 #include "Modules/Medium/FontRendering.h"
 #include "Modules/Medium/Imgui/UI.h"
 
@@ -79,6 +82,8 @@ static bool InitTheForge()
         return false;
 
     fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_LOG, "");
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_SCREENSHOTS, "");
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_OTHER_FILES, ""); // input recordings
     fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_FONTS, "Assets/Fonts");
     fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_GPU_CONFIG, "Assets/GPUCfg");
     fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_SHADER_BINARIES, "Assets/FSL/binary");
@@ -115,7 +120,7 @@ SDL_AppResult SDL_Fail()
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
 {
     // Init SDL.  Many systems will rely on SDL being initialized.
-    if (!SDL_Init(SDL_INIT_VIDEO))
+    if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD))
     {
         return SDL_Fail();
     }
@@ -140,8 +145,11 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
     pApp->lowModules.push_back(pApp->ecs.import<Engine::module>().get_mut<Engine::module>());
     pApp->lowModules.push_back(pApp->ecs.import<Window::module>().get_mut<Window::module>());
     pApp->lowModules.push_back(pApp->ecs.import<RHI::module>().get_mut<RHI::module>());
+    pApp->lowModules.push_back(pApp->ecs.import<RenderGraph::module>().get_mut<RenderGraph::module>());
+    pApp->lowModules.push_back(pApp->ecs.import<Readback::module>().get_mut<Readback::module>());
     pApp->lowModules.push_back(pApp->ecs.import<Inputs::module>().get_mut<Inputs::module>());
 
+    pApp->lowModules.push_back(pApp->ecs.import<DynamicResolution::module>().get_mut<DynamicResolution::module>());
     pApp->lowModules.push_back(pApp->ecs.import<FontRendering::module>().get_mut<FontRendering::module>());
     pApp->lowModules.push_back(pApp->ecs.import<UI::module>().get_mut<UI::module>());
 
@@ -159,11 +167,38 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char* argv[])
     std::string moduleName = "";
     cli.add_option("-a,--appmodule", moduleName, "The app (high level) module to use.");
 
+    std::string recordFile = "";
+    std::string replayFile = "";
+    cli.add_option("--record", recordFile, "Records inputs and frame times to the given file.");
+    cli.add_option("--replay", replayFile, "Replays inputs and frame times from the given file (pins the random seed).");
+
+    std::string captureFile = "";
+    unsigned int captureFrame = 60;
+    bool captureOffscreen = false;
+    cli.add_option("--capture", captureFile, "Captures the main window to the given PPM file once --capture-frame frames were rendered, then exits.");
+    cli.add_option("--capture-frame", captureFrame, "Frames rendered before capturing (60 by default).");
+    cli.add_flag("--capture-offscreen", captureOffscreen, "Captures an offscreen canvas of the main window's size instead of the window.");
+
     cli.parse(argc, argv);
 
     // Kickstart the engine to activate the first systems
     Engine::KickstartEngine(pApp->ecs);
 
+    // Start recording/replaying before the app module gets launched so it sees the pinned seed and its first frame is covered
+    if (!replayFile.empty())
+    {
+        if (!Inputs::StartReplay(pApp->ecs, replayFile.c_str()))
+            return SDL_APP_FAILURE;
+    }
+    else if (!recordFile.empty())
+    {
+        if (!Inputs::StartRecording(pApp->ecs, recordFile.c_str()))
+            return SDL_APP_FAILURE;
+    }
+
+    if (!captureFile.empty())
+        Readback::CaptureToFile(pApp->ecs, captureFile.c_str(), captureFrame, captureOffscreen);
+
     // Setup the app launcher module that will handle launching the proper app
     AppModuleLauncher::module::SetAppModuleToStart(moduleName);
     pApp->pAppLauncherModule = pApp->ecs.import<AppModuleLauncher::module>().get_mut<AppModuleLauncher::module>();
@@ -246,7 +281,11 @@ SDL_AppResult SDL_AppIterate(void *appstate)
     pApp->pAppLauncherModule->PreProgress(pApp->ecs);
 
     if (!pApp->pauseApp)
-        pApp->ecs.progress();
+    {
+        // A fixed delta time is set when replaying, otherwise flecs measures it (0)
+        pEngineContext = pApp->ecs.has<Engine::Context>() ? pApp->ecs.get<Engine::Context>() : nullptr;
+        pApp->ecs.progress(pEngineContext ? pEngineContext->FixedDeltaTime() : 0.f);
+    }
     
     return pApp->quitApp ? SDL_APP_SUCCESS : SDL_APP_CONTINUE;
 }
@@ -8,6 +8,7 @@
 #include "Low/Engine.h"
 #include "Low/Inputs.h"
 #include "Low/RHI.h"
+#include "Low/RenderGraph.h"
 #include "Low/Window.h"
 #include "Medium/Imgui/UI.h"
 
@@ -27,6 +28,11 @@ namespace AppModuleLauncher
         std::function<void(flecs::world&)> Start;
     };
 
+    struct RenderPassData
+    {
+        flecs::entity clearPass = {};
+    };
+
     // The module that was launched
     LifeCycledModule* pLaunchedAppModule = nullptr;
 
@@ -52,6 +58,7 @@ namespace AppModuleLauncher
     module::module(flecs::world& ecs)
     {
         ecs.import<RHI::module>();
+        ecs.import<RenderGraph::module>();
         ecs.import<Window::module>();
         ecs.import<Engine::module>();
 
@@ -126,27 +133,31 @@ namespace AppModuleLauncher
         uiEntity = ecs.entity("AppModuleLauncher::UI").set<UI::UI>(ui);
 
         // Clear screen
-        ecs.system<Engine::Canvas, Window::SDLWindow>("AppModuleLauncher::Draw")
-            .kind(flecs::OnStore)
-            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+        // Nothing gets drawn, the pass only makes sure the backbuffer gets cleared if nothing else does it first
+        RenderGraph::Pass clearPass = {};
+        clearPass.phase = Engine::SCENE_RENDER;
+        clearPass.writes = { RenderGraph::SCENE_COLOR };
+        clearPass.clear = true;
+        ecs.component<RenderPassData>();
+        RenderPassData renderPassData = {};
+        renderPassData.clearPass = ecs.entity("AppModuleLauncher::ClearPass").set<RenderGraph::Pass>(clearPass);
+        ecs.set<RenderPassData>(renderPassData);
+
+        ecs.system<Engine::Canvas, RenderGraph::CanvasTarget>("AppModuleLauncher::Draw")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::SCENE_RENDER))
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, RenderGraph::CanvasTarget const& canvasTarget)
                 {
-                    ASSERTMSG(i == 0, "Drawing to more than one window not implemented.");
-
                     RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+                    RenderPassData const* pRPD = it.world().has<RenderPassData>() ? it.world().get<RenderPassData>() : nullptr;
 
-                    if (pRHI && sdlWin.pCurRT)
+                    if (pRHI && pRPD && RenderGraph::HasTarget(canvasTarget))
                     {
                         Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
                         ASSERT(pCmd);
 
-                        BindRenderTargetsDesc bindRenderTargets = {};
-                        bindRenderTargets.mRenderTargetCount = 1;
-                        bindRenderTargets.mRenderTargets[0] = { sdlWin.pCurRT, LOAD_ACTION_CLEAR };
-                        cmdBindRenderTargets(pCmd, &bindRenderTargets);
-                        cmdSetViewport(pCmd, 0.0f, 0.0f, (float)canvas.width, (float)canvas.height, 0.0f, 1.0f);
-                        cmdSetScissor(pCmd, 0, 0, canvas.width, canvas.height);
-
-                        cmdBindRenderTargets(pCmd, nullptr);
+                        auto world = it.world();
+                        if (RenderGraph::BeginPass(world, pCmd, pRPD->clearPass, canvasTarget))
+                            RenderGraph::EndPass(world, pCmd, pRPD->clearPass);
                     }
                 }
             );
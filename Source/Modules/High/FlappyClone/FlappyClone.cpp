@@ -10,6 +10,7 @@
 #include "Low/Engine.h"
 #include "Low/Inputs.h"
 #include "Low/RHI.h"
+#include "Low/RenderGraph.h"
 #include "Low/Window.h"
 #include "Medium/FontRendering.h"
 #include "FlappyClone.h"
@@ -40,11 +41,12 @@ namespace FlappyClone
         Shader* pTriShader = nullptr;
         RootSignature* pRootSignature = nullptr;
         DescriptorSet* pDescriptorSetUniforms = nullptr;
-        Pipeline* pPipeline = nullptr;
+        RHI::PipelineHandle pipeline = {}; // compiled async
         VertexLayout vertexLayout = {};
-        Buffer* pVertexBuffer = nullptr;
-        Buffer* pIndexBuffer = nullptr;
+        RHI::BufferRange vertexBuffer = {}; // pooled
+        RHI::BufferRange indexBuffer = {}; // pooled
         std::vector<Buffer*> uniformsBuffers;
+        flecs::entity drawPass = {};
 
         // Uniforms data
         struct UniformsData
@@ -60,11 +62,12 @@ namespace FlappyClone
             pTriShader = nullptr;
             pRootSignature = nullptr;
             pDescriptorSetUniforms = nullptr;
-            pPipeline = nullptr;
+            pipeline = {};
             vertexLayout = {};
-            pVertexBuffer = nullptr;
-            pIndexBuffer = nullptr;
+            vertexBuffer = {};
+            indexBuffer = {};
             uniformsBuffers.clear();
+            drawPass = {};
             uniformsData = {};
         }
 
@@ -121,6 +124,8 @@ namespace FlappyClone
         } state = RESET_WORLD;
 
         unsigned int obstaclesCreated = 0; // used to create unique names for obstacles
+
+        std::mt19937 randomGen; // seeded from the engine context so replays generate the same obstacles
     };
     //////////////////////////
 
@@ -189,12 +194,12 @@ namespace FlappyClone
         pipelineSettings.pShaderProgram = passDataInOut.pTriShader;
         pipelineSettings.pVertexLayout = &passDataInOut.vertexLayout;
         pipelineSettings.pRasterizerState = &rasterizerStateDesc;
-        addPipeline(pRHI->pRenderer, &desc, &passDataInOut.pPipeline);
+        passDataInOut.pipeline = RHI::AddPipelineAsync(pRHI->pRenderer, desc);
     }
 
     static void RemovePipeline(Renderer* const pRenderer, RenderPassData& passDataInOut)
     {
-        removePipeline(pRenderer, passDataInOut.pPipeline);
+        RHI::RemovePipelineAsync(pRenderer, passDataInOut.pipeline);
     }
     //////////////////////////
 
@@ -214,10 +219,9 @@ namespace FlappyClone
         std::array<Scale, 2>& scale,
         std::array<Color, 2>& color,
         float const xOffset0,
-        float const xOffset1)
+        float const xOffset1,
+        std::mt19937& gen)
     {
-        std::random_device rd;
-        std::mt19937 gen(rd());
         float const minVerticalOffset = OBSTACLE_WIDTH + OBSTACLE_WIDTH * 0.5f;
         std::uniform_real_distribution<float> dis(minVerticalOffset, 1.f - minVerticalOffset);
         float const gapPosY = dis(gen);
@@ -249,7 +253,9 @@ namespace FlappyClone
 
     module::module(flecs::world& ecs)
     {
+        ecs.import<Inputs::module>();
         ecs.import<RHI::module>();
+        ecs.import<RenderGraph::module>();
         ecs.import<Window::module>();
         ecs.import<Engine::module>();
 
@@ -304,13 +310,7 @@ namespace FlappyClone
         triPositions[2] = { 0.5f, 0.5f , 0.f };
         triPositions[3] = { -0.5f, 0.5f , 0.f };
 
-        BufferLoadDesc vbDesc = {};
-        vbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-        vbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-        vbDesc.mDesc.mSize = triPositions.size() * 12;
-        vbDesc.pData = triPositions.data();
-        vbDesc.ppBuffer = &renderPassData.pVertexBuffer;
-        addResource(&vbDesc, nullptr);
+        renderPassData.vertexBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_GEOMETRY, triPositions.size() * 12, triPositions.data());
 
         std::vector<uint16_t> triIndices(8);
         triIndices[0] = 0;
@@ -320,13 +320,7 @@ namespace FlappyClone
         triIndices[4] = 3;
         triIndices[5] = 0;
 
-        BufferLoadDesc ibDesc = {};
-        ibDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_INDEX_BUFFER;
-        ibDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-        ibDesc.mDesc.mSize = triIndices.size() * sizeof(uint16_t);
-        ibDesc.pData = triIndices.data();
-        ibDesc.ppBuffer = &renderPassData.pIndexBuffer;
-        addResource(&ibDesc, nullptr);
+        renderPassData.indexBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_GEOMETRY, triIndices.size() * sizeof(uint16_t), triIndices.data());
 
 
         Window::SDLWindow const* pWindow = nullptr;
@@ -343,6 +337,12 @@ namespace FlappyClone
 
         waitForAllResourceLoads();
 
+        RenderGraph::Pass drawPass = {};
+        drawPass.phase = Engine::SCENE_RENDER;
+        drawPass.writes = { RenderGraph::SCENE_COLOR };
+        drawPass.clear = true;
+        renderPassData.drawPass = ecs.entity("FlappyClone::DrawPass").set<RenderGraph::Pass>(drawPass);
+
         ecs.set<RenderPassData>(renderPassData);
 
         // Create the player entity
@@ -373,8 +373,15 @@ namespace FlappyClone
             with<Obstacle>().up(flecs::ChildOf).
             cached().
             build();
+        Engine::Context const* pEngineContext = ecs.has<Engine::Context>() ? ecs.get<Engine::Context>() : nullptr;
+        gameContext.randomGen.seed(pEngineContext ? pEngineContext->RandomSeed() : std::mt19937::default_seed);
         ecs.set<GameContext>(gameContext);
 
+        // Bind the game's actions, systems read the results computed once per frame by the inputs module
+        Inputs::ActionMap* pActionMap = ecs.get_mut<Inputs::ActionMap>();
+        Inputs::ActionId const exitAction = pActionMap->Bind("FlappyClone::Exit", { { SDLK_ESCAPE } });
+        Inputs::ActionId const flapAction = pActionMap->Bind("FlappyClone::Flap", { { SDLK_SPACE }, {}, SDL_BUTTON_LMASK });
+
         // Following are all systems (note the decl' order is important for systems within the same flecs phase)
 
         // State Transitioning
@@ -382,16 +389,15 @@ namespace FlappyClone
         // - Checks for ESC key press to exit app
         ecs.system("FlappyClone::StateTransitioning")
                 .kind(flecs::PreUpdate)
-                .run([](flecs::iter& it)
+                .run([exitAction, flapAction](flecs::iter& it)
                 {
-                    Inputs::RawKeboardStates const* pKeyboard = it.world().has<Inputs::RawKeboardStates>() ? it.world().get<Inputs::RawKeboardStates>() : nullptr;
-                    Inputs::RawMouseStates const* pMouse = it.world().has<Inputs::RawMouseStates>() ? it.world().get<Inputs::RawMouseStates>() : nullptr;
+                    Inputs::ActionMap const* pActionMap = it.world().has<Inputs::ActionMap>() ? it.world().get<Inputs::ActionMap>() : nullptr;
                     Engine::Context* pEngineContext = it.world().has<Engine::Context>() ? it.world().get_mut<Engine::Context>() : nullptr;
                    
-                    if (pKeyboard && pMouse && pEngineContext)
+                    if (pActionMap && pEngineContext)
                     {
                         // Exit if ESC is pressed
-                        if (pKeyboard->WasPressed(SDLK_ESCAPE))
+                        if (pActionMap->WasPressed(exitAction))
                         {
                             LOGF(eDEBUG, "ESC pressed, requesting to exit the app.");
                             pEngineContext->RequestExit();
@@ -401,7 +407,7 @@ namespace FlappyClone
                         GameContext* pGameCtx = it.world().has<GameContext>() ? it.world().get_mut<GameContext>() : nullptr;
                         if (pGameCtx)
                         {
-                            if (pKeyboard->WasPressed(SDLK_SPACE) || pMouse->WasPressed(SDL_BUTTON_LMASK))
+                            if (pActionMap->WasPressed(flapAction))
                             {
                                 if (GameContext::START == pGameCtx->state)
                                     pGameCtx->state = GameContext::IN_PLAY;
@@ -444,7 +450,7 @@ namespace FlappyClone
                                         it.world().entity((std::string("FlappyClone::Obstacle") + std::to_string(pGameCtx->obstaclesCreated) + "::BOTTOM").c_str())
                                     };
 
-                                    ResetObstacle(positions, scales, colors, OBSTACLE_GAME_START_X_OFFSET, (i * DIST_BETWEEN_OBSTACLES));
+                                    ResetObstacle(positions, scales, colors, OBSTACLE_GAME_START_X_OFFSET, (i * DIST_BETWEEN_OBSTACLES), pGameCtx->randomGen);
 
                                     for (unsigned int j = 0; j < 2; ++j)
                                     {
@@ -533,7 +539,7 @@ namespace FlappyClone
         // - Handles player inputs 
         ecs.system<Player, Position, Scale, Color, Velocity, FontRendering::FontText>("FlappyClone::UpdatePlayer")
             .kind(flecs::OnUpdate)
-            .each([](flecs::iter& it, size_t i, Player& player, Position const& position, Scale const& scale, Color const& color, Velocity& vel, FontRendering::FontText& fontText)
+            .each([flapAction](flecs::iter& it, size_t i, Player& player, Position const& position, Scale const& scale, Color const& color, Velocity& vel, FontRendering::FontText& fontText)
                 {
                     ASSERTMSG(i == 0, "More than 1 player not supported.");
                     
@@ -552,14 +558,12 @@ namespace FlappyClone
                     }
 
                     // Impulse force
-                    Inputs::RawKeboardStates const* pKeyboard = it.world().has<Inputs::RawKeboardStates>() ? it.world().get<Inputs::RawKeboardStates>() : nullptr;                   
-                    Inputs::RawMouseStates const* pMouse = it.world().has<Inputs::RawMouseStates>() ? it.world().get<Inputs::RawMouseStates>() : nullptr;
+                    Inputs::ActionMap const* pActionMap = it.world().has<Inputs::ActionMap>() ? it.world().get<Inputs::ActionMap>() : nullptr;
                     GameContext const* pGameCtx = it.world().has<GameContext>() ? it.world().get<GameContext>() : nullptr;
 
-                    if (pKeyboard && pMouse)
+                    if (pActionMap)
                     {
-                        if (pGameCtx &&
-                            pKeyboard->WasPressed(SDLK_SPACE) || pMouse->WasPressed(SDL_BUTTON_LMASK))
+                        if (pGameCtx && pActionMap->WasPressed(flapAction))
                         {                            
                             if (GameContext::IN_PLAY == pGameCtx->state)
                                 vel.y = IMPULSE_FORCE;
@@ -576,11 +580,13 @@ namespace FlappyClone
                     if (score < 0.f)
                         score = 0.f;
 
-                    fontText.text = std::to_string(static_cast<unsigned int>(score));
+                    // Interned, the score only gets formatted and laid out again when it changes
+                    fontText.text = FontRendering::TextHandle::FromNumber(static_cast<unsigned int>(score));
                     fontText.fontSize = 85.f;
 
                     float textSize[2] = {};
-                    FontRendering::MeasureText(it.world(), fontText, textSize[0], textSize[1]);
+                    auto world = it.world();
+                    FontRendering::MeasureText(world, fontText, textSize[0], textSize[1]);
 
                     if (pRPD)
                     {
@@ -661,12 +667,12 @@ namespace FlappyClone
         
         // Update Uniforms
         // - Updates gpu unif buffer
+        // - Projection is set up for the main window (other windows share it)
         ecs.system<Engine::Canvas, Window::SDLWindow>("FlappyClone::UpdateUniforms")
+            .with<Window::MainWindowTag>()
             .kind(flecs::PreStore)
             .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
                 {
-                    ASSERTMSG(i == 0, "Drawing to more than one window not implemented.");
-
                     RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
                     RenderPassData* pRPD = it.world().has<RenderPassData>() ? it.world().get_mut<RenderPassData>() : nullptr;
 
@@ -692,52 +698,46 @@ namespace FlappyClone
 
         // Draw
         // - Records GPU cmds
-        ecs.system<Engine::Canvas, Window::SDLWindow>("FlappyClone::Draw")
-            .kind(flecs::OnStore)
-            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+        ecs.system<Engine::Canvas, RenderGraph::CanvasTarget>("FlappyClone::Draw")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::SCENE_RENDER))
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, RenderGraph::CanvasTarget const& canvasTarget)
                 {
-                    ASSERTMSG(i == 0, "Drawing to more than one window not implemented.");
-
                     RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
                     RenderPassData* pRPD = it.world().has<RenderPassData>() ? it.world().get_mut<RenderPassData>() : nullptr;
 
 
-                    if (pRHI && pRPD && sdlWin.pCurRT)
+                    if (pRHI && pRPD && RenderGraph::HasTarget(canvasTarget))
                     {
                         // Updated latest res so that it can be used if needed during next frame's update
-                        pRPD->resX = sdlWin.pSwapChain->ppRenderTargets[0]->mWidth;
-                        pRPD->resY = sdlWin.pSwapChain->ppRenderTargets[0]->mHeight;
+                        if (it.entity(i).has<Window::MainWindowTag>())
+                        {
+                            pRPD->resX = canvas.width;
+                            pRPD->resY = canvas.height;
+                        }
 
                         Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
                         ASSERT(pCmd);
 
-                        cmdBeginDebugMarker(pCmd, 1, 0, 1, "FlappyClone::ClearScreen");
-
-                        RenderTargetBarrier barriers[] = {
-                                 { sdlWin.pCurRT, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET },
-                        };
-                        cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, 1, barriers);
-
-                        BindRenderTargetsDesc bindRenderTargets = {};
-                        bindRenderTargets.mRenderTargetCount = 1;
-                        bindRenderTargets.mRenderTargets[0] = { sdlWin.pCurRT, LOAD_ACTION_CLEAR };
-                        cmdBindRenderTargets(pCmd, &bindRenderTargets);
-                        cmdSetViewport(pCmd, 0.0f, 0.0f, static_cast<float>(sdlWin.pCurRT->mWidth), static_cast<float>(sdlWin.pCurRT->mHeight), 0.0f, 1.0f);
-                        cmdSetScissor(pCmd, 0, 0, sdlWin.pCurRT->mWidth, sdlWin.pCurRT->mHeight);
+                        // The render graph takes care of transitioning and clearing the backbuffer
+                        auto world = it.world();
+                        if (RenderGraph::BeginPass(world, pCmd, pRPD->drawPass, canvasTarget))
+                        {
+                            Pipeline* pPipeline = RHI::GetPipeline(pRPD->pipeline);
+                            if (pPipeline)
+                            {
+                                cmdBeginDebugMarker(pCmd, 1, 0, 1, "FlappyClone::DrawObstacles");
 
-                        cmdEndDebugMarker(pCmd);
+                                cmdBindPipeline(pCmd, pPipeline);
+                                cmdBindDescriptorSet(pCmd, pRHI->frameIndex, pRPD->pDescriptorSetUniforms);
+                                cmdBindVertexBuffer(pCmd, 1, &pRPD->vertexBuffer.pBuffer, &pRPD->vertexLayout.mBindings[0].mStride, &pRPD->vertexBuffer.offset);
+                                cmdBindIndexBuffer(pCmd, pRPD->indexBuffer.pBuffer, INDEX_TYPE_UINT16, pRPD->indexBuffer.offset);
+                                cmdDrawIndexedInstanced(pCmd, 6, 0, TOTALS_QUADS_TO_DRAW, 0, 0);
 
-                        cmdBeginDebugMarker(pCmd, 1, 0, 1, "FlappyClone::DrawObstacles");
-                        
-                        cmdBindPipeline(pCmd, pRPD->pPipeline);
-                        cmdBindDescriptorSet(pCmd, pRHI->frameIndex, pRPD->pDescriptorSetUniforms);
-                        cmdBindVertexBuffer(pCmd, 1, &pRPD->pVertexBuffer, &pRPD->vertexLayout.mBindings[0].mStride, nullptr);
-                        cmdBindIndexBuffer(pCmd, pRPD->pIndexBuffer, INDEX_TYPE_UINT16, 0);
-                        cmdDrawIndexedInstanced(pCmd, 6, 0, TOTALS_QUADS_TO_DRAW, 0, 0);
-
-                        cmdBindRenderTargets(pCmd, nullptr);
+                                cmdEndDebugMarker(pCmd);
+                            }
 
-                        cmdEndDebugMarker(pCmd);
+                            RenderGraph::EndPass(world, pCmd, pRPD->drawPass);
+                        }
                     }
                 }
             );
@@ -753,6 +753,7 @@ namespace FlappyClone
 
             Renderer* pRenderer = pRHI->pRenderer;
             RenderPassData* pRenderPassData = ecs.get_mut<RenderPassData>();
+            RemovePipeline(pRenderer, *pRenderPassData);
             RemoveDescriptorSet(pRenderer, *pRenderPassData);
             RemoveRootSignature(pRenderer, *pRenderPassData);
             RemoveShaders(pRenderer, *pRenderPassData);
@@ -762,10 +763,8 @@ namespace FlappyClone
                 removeResource(pRenderPassData->uniformsBuffers[i]);
             }
 
-            removeResource(pRenderPassData->pVertexBuffer);
-            removeResource(pRenderPassData->pIndexBuffer);
-
-            RemovePipeline(pRenderer, *pRenderPassData);
+            RHI::RemovePooledBuffer(pRenderPassData->vertexBuffer);
+            RHI::RemovePooledBuffer(pRenderPassData->indexBuffer);
 
             pRenderPassData->Reset();
         }
@@ -7,7 +7,9 @@
 #include "Low/Engine.h"
 #include "Low/Inputs.h"
 #include "Low/RHI.h"
+#include "Low/RenderGraph.h"
 #include "Low/Window.h"
+#include "Medium/FontRendering.h"
 #include "Medium/Imgui/UI.h"
 #include "HelloTriangle.h"
 
@@ -19,11 +21,12 @@ namespace HelloTriangle
         Shader* pTriShader = nullptr;
         RootSignature* pRootSignature = nullptr;
         DescriptorSet* pDescriptorSetUniforms = nullptr;
-        Pipeline* pPipeline = nullptr;
+        RHI::PipelineHandle pipeline = {}; // compiled async
         VertexLayout vertexLayout = {};
-        Buffer* pVertexBuffer = nullptr;
-        Buffer* pIndexBuffer = nullptr;
+        RHI::BufferRange vertexBuffer = {}; // pooled
+        RHI::BufferRange indexBuffer = {}; // pooled
         std::vector<Buffer*> uniformsBuffers;
+        flecs::entity drawPass = {};
 
         // Uniforms data
         struct UniformsData
@@ -37,11 +40,12 @@ namespace HelloTriangle
             pTriShader = nullptr;
             pRootSignature = nullptr;
             pDescriptorSetUniforms = nullptr;
-            pPipeline = nullptr;
+            pipeline = {};
             vertexLayout = {};
-            pVertexBuffer = nullptr;
-            pIndexBuffer = nullptr;
+            vertexBuffer = {};
+            indexBuffer = {};
             uniformsBuffers.clear();
+            drawPass = {};
         }
     };
     
@@ -109,19 +113,22 @@ namespace HelloTriangle
         pipelineSettings.pShaderProgram = passDataInOut.pTriShader;
         pipelineSettings.pVertexLayout = &passDataInOut.vertexLayout;
         pipelineSettings.pRasterizerState = &rasterizerStateDesc;
-        addPipeline(pRHI->pRenderer, &desc, &passDataInOut.pPipeline);
+        passDataInOut.pipeline = RHI::AddPipelineAsync(pRHI->pRenderer, desc);
     }
 
     static void RemovePipeline(Renderer* const pRenderer, RenderPassData& passDataInOut)
     {
-        removePipeline(pRenderer, passDataInOut.pPipeline);
+        RHI::RemovePipelineAsync(pRenderer, passDataInOut.pipeline);
     }
 
     module::module(flecs::world& ecs)
     {
+        ecs.import<Inputs::module>();
         ecs.import<RHI::module>();
+        ecs.import<RenderGraph::module>();
         ecs.import<Window::module>();
         ecs.import<Engine::module>();
+        ecs.import<FontRendering::module>();
 
         ecs.module<module>();
 
@@ -169,26 +176,14 @@ namespace HelloTriangle
         triPositions[1] = { 0.5f, -0.5f , 0.5f };
         triPositions[2] = { 0.f, 0.5f , 0.5f };
 
-        BufferLoadDesc vbDesc = {};
-        vbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
-        vbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-        vbDesc.mDesc.mSize = 3 * 12;
-        vbDesc.pData = triPositions.data();
-        vbDesc.ppBuffer = &renderPassData.pVertexBuffer;
-        addResource(&vbDesc, nullptr);
+        renderPassData.vertexBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_GEOMETRY, 3 * 12, triPositions.data());
 
         std::vector<uint16_t> triIndices(4); // 4 for alignment/padding
         triIndices[0] = 0;
         triIndices[1] = 1;
         triIndices[2] = 2;
 
-        BufferLoadDesc ibDesc = {};
-        ibDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_INDEX_BUFFER;
-        ibDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
-        ibDesc.mDesc.mSize = sizeof(uint16_t) * 4;
-        ibDesc.pData = triIndices.data();
-        ibDesc.ppBuffer = &renderPassData.pIndexBuffer;
-        addResource(&ibDesc, nullptr);
+        renderPassData.indexBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_GEOMETRY, sizeof(uint16_t) * 4, triIndices.data());
 
         Window::SDLWindow const* pWindow = nullptr;
         Window::MainWindow(ecs, &pWindow);
@@ -197,8 +192,25 @@ namespace HelloTriangle
 
         waitForAllResourceLoads();
 
+        RenderGraph::Pass drawPass = {};
+        drawPass.phase = Engine::SCENE_RENDER;
+        drawPass.writes = { RenderGraph::SCENE_COLOR };
+        drawPass.clear = true;
+        renderPassData.drawPass = ecs.entity("HelloTriangle::DrawPass").set<RenderGraph::Pass>(drawPass);
+
         ecs.set<RenderPassData>(renderPassData);
 
+        // The triangle is seen through the camera, so is its name plate (sitting on its top vertex)
+        Engine::Camera camera = {};
+        camera.projection = glm::orthoLH_ZO(-1.f, 1.f, -1.f, 1.f, 0.1f, 1.f);
+        ecs.set<Engine::Camera>(camera);
+
+        FontRendering::WorldText namePlate = {};
+        namePlate.text = "Hello Triangle";
+        namePlate.fontSize = 0.1f;
+        namePlate.transform = glm::translate(glm::mat4(1.f), glm::vec3(triPositions[2].x, triPositions[2].y + 0.05f, triPositions[2].z));
+        ecs.entity("HelloTriangle::NamePlate").set<FontRendering::WorldText>(namePlate);
+
         // Create a UI entity
         UI::UI ui = {};
         ui.Update = [](flecs::world& ecs) 
@@ -211,29 +223,29 @@ namespace HelloTriangle
 
                 // Test different imgui fonts
                 {
-                    ImFont* pFnt = UI::GetOrAddFont(ecs, FontRendering::CRIMSON_ROMAN, 20);
+                    ImFont* pFnt = UI::GetOrAddFont(ecs, FontRendering::MakeFontId("Crimson-Roman"), 20);
                     if (pFnt)
                     {
                         ImGui::PushFont(pFnt);
-                        ImGui::Text("UI::GetOrAddFont(ecs, FontRendering::CRIMSON_ROMAN, 20)");
+                        ImGui::Text("UI::GetOrAddFont(ecs, FontRendering::MakeFontId(\"Crimson-Roman\"), 20)");
                         ImGui::PopFont();
                     }
                 }
                 {
-                    ImFont* pFnt = UI::GetOrAddFont(ecs, FontRendering::INCONSOLATA_LGC_BOLD_ITALIC, 25);
+                    ImFont* pFnt = UI::GetOrAddFont(ecs, FontRendering::MakeFontId("Inconsolata-LGC-BoldItalic"), 25);
                     if (pFnt)
                     {
                         ImGui::PushFont(pFnt);
-                        ImGui::Text("UI::GetOrAddFont(ecs, FontRendering::INCONSOLATA_LGC_BOLD_ITALIC, 25)");
+                        ImGui::Text("UI::GetOrAddFont(ecs, FontRendering::MakeFontId(\"Inconsolata-LGC-BoldItalic\"), 25)");
                         ImGui::PopFont();
                     }
                 }
                 {
-                    ImFont* pFnt = UI::GetOrAddFont(ecs, FontRendering::COMIC_RELIEF, 30);
+                    ImFont* pFnt = UI::GetOrAddFont(ecs, FontRendering::MakeFontId("ComicRelief"), 30);
                     if (pFnt)
                     {
                         ImGui::PushFont(pFnt);
-                        ImGui::Text("UI::GetOrAddFont(ecs, FontRendering::COMIC_RELIEF, 30)");
+                        ImGui::Text("UI::GetOrAddFont(ecs, FontRendering::MakeFontId(\"ComicRelief\"), 30)");
                         ImGui::PopFont();
                     }
                 }
@@ -241,22 +253,25 @@ namespace HelloTriangle
         ecs.entity("HelloTriangle::UI").set<UI::UI>(ui);
 
         // Main update logic (in practice this would be distributed across multiple systems)
+        Inputs::ActionId const exitAction = ecs.get_mut<Inputs::ActionMap>()->Bind("HelloTriangle::Exit", { { SDLK_ESCAPE } });
+
         ecs.system("HelloTriangle::Update")
             .kind(flecs::OnUpdate)
-            .run([](flecs::iter& it)
+            .run([exitAction](flecs::iter& it)
                 {
                     auto ecs = it.world();
 
                     RHI::RHI const* pRHI = ecs.has<RHI::RHI>() ? ecs.get<RHI::RHI>() : nullptr;
                     RenderPassData const* pRPD = ecs.has<RenderPassData>() ? ecs.get<RenderPassData>() : nullptr;
-                    Inputs::RawKeboardStates const* pKeyboard = ecs.has<Inputs::RawKeboardStates>() ? ecs.get<Inputs::RawKeboardStates>() : nullptr;
+                    Engine::Camera const* pCamera = ecs.has<Engine::Camera>() ? ecs.get<Engine::Camera>() : nullptr;
+                    Inputs::ActionMap const* pActionMap = ecs.has<Inputs::ActionMap>() ? ecs.get<Inputs::ActionMap>() : nullptr;
                     Engine::Context* pEngineContext = ecs.has<Engine::Context>() ? ecs.get_mut<Engine::Context>() : nullptr;
 
                     // Rendering update
-                    if (pRHI && pRPD)
+                    if (pRHI && pRPD && pCamera)
                     {
                         RenderPassData::UniformsData updatedData = {};
-                        updatedData.mvp = glm::orthoLH_ZO(-1.f, 1.f, -1.f, 1.f, 0.1f, 1.f);
+                        updatedData.mvp = pCamera->projection * pCamera->view;
                         updatedData.color = glm::vec4(1.f, 1.f, 1.f, 1.f);
 
                         // Update uniform buffers
@@ -267,11 +282,11 @@ namespace HelloTriangle
                     }
 
                     // Exit if ESC is pressed
-                    if (pKeyboard && pEngineContext)
+                    if (pActionMap && pEngineContext)
                     {
                         if (!UI::WantsCaptureInputs(ecs))
                         {
-                            if (pKeyboard->WasPressed(SDLK_ESCAPE))
+                            if (pActionMap->WasPressed(exitAction))
                             {
                                 LOGF(eDEBUG, "ESC pressed, requesting to exit the app.");
                                 pEngineContext->RequestExit();
@@ -281,38 +296,37 @@ namespace HelloTriangle
                 }
             );
 
-        ecs.system<Engine::Canvas, Window::SDLWindow>("HelloTriangle::Draw")
-            .kind(flecs::OnStore)
-            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+        ecs.system<Engine::Canvas, RenderGraph::CanvasTarget>("HelloTriangle::Draw")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::SCENE_RENDER))
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, RenderGraph::CanvasTarget const& canvasTarget)
                 {
-                    ASSERTMSG(i == 0, "Drawing to more than one window not implemented.");
-
                     RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
                     RenderPassData* pRPD = it.world().has<RenderPassData>() ? it.world().get_mut<RenderPassData>() : nullptr;
 
-                    if (pRHI && pRPD && sdlWin.pCurRT)
+                    if (pRHI && pRPD && RenderGraph::HasTarget(canvasTarget))
                     {
                         Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
                         ASSERT(pCmd);
 
-                        cmdBeginDebugMarker(pCmd, 1, 0, 1, "HelloTriangle::DrawTri");
-
-                        BindRenderTargetsDesc bindRenderTargets = {};
-                        bindRenderTargets.mRenderTargetCount = 1;
-                        bindRenderTargets.mRenderTargets[0] = { sdlWin.pCurRT, LOAD_ACTION_CLEAR };
-                        cmdBindRenderTargets(pCmd, &bindRenderTargets);
-                        cmdSetViewport(pCmd, 0.0f, 0.0f, (float)canvas.width, (float)canvas.height, 0.0f, 1.0f);
-                        cmdSetScissor(pCmd, 0, 0, canvas.width, canvas.height);
+                        auto world = it.world();
+                        if (RenderGraph::BeginPass(world, pCmd, pRPD->drawPass, canvasTarget))
+                        {
+                            Pipeline* pPipeline = RHI::GetPipeline(pRPD->pipeline);
+                            if (pPipeline)
+                            {
+                                cmdBeginDebugMarker(pCmd, 1, 0, 1, "HelloTriangle::DrawTri");
 
-                        cmdBindPipeline(pCmd, pRPD->pPipeline);
-                        cmdBindDescriptorSet(pCmd, pRHI->frameIndex, pRPD->pDescriptorSetUniforms);
-                        cmdBindVertexBuffer(pCmd, 1, &pRPD->pVertexBuffer, &pRPD->vertexLayout.mBindings[0].mStride, nullptr);
-                        cmdBindIndexBuffer(pCmd, pRPD->pIndexBuffer, INDEX_TYPE_UINT16, 0);
-                        cmdDrawIndexed(pCmd, 3, 0, 0);
+                                cmdBindPipeline(pCmd, pPipeline);
+                                cmdBindDescriptorSet(pCmd, pRHI->frameIndex, pRPD->pDescriptorSetUniforms);
+                                cmdBindVertexBuffer(pCmd, 1, &pRPD->vertexBuffer.pBuffer, &pRPD->vertexLayout.mBindings[0].mStride, &pRPD->vertexBuffer.offset);
+                                cmdBindIndexBuffer(pCmd, pRPD->indexBuffer.pBuffer, INDEX_TYPE_UINT16, pRPD->indexBuffer.offset);
+                                cmdDrawIndexed(pCmd, 3, 0, 0);
 
-                        cmdBindRenderTargets(pCmd, nullptr);
+                                cmdEndDebugMarker(pCmd);
+                            }
 
-                        cmdEndDebugMarker(pCmd);
+                            RenderGraph::EndPass(world, pCmd, pRPD->drawPass);
+                        }
                     }
                 }
             );
@@ -328,6 +342,7 @@ namespace HelloTriangle
 
             Renderer* pRenderer = pRHI->pRenderer;
             RenderPassData* pRenderPassData = ecs.get_mut<RenderPassData>();
+            RemovePipeline(pRenderer, *pRenderPassData);
             RemoveDescriptorSet(pRenderer, *pRenderPassData);
             RemoveRootSignature(pRenderer, *pRenderPassData);
             RemoveShaders(pRenderer, *pRenderPassData);
@@ -337,10 +352,8 @@ namespace HelloTriangle
                 removeResource(pRenderPassData->uniformsBuffers[i]);
             }
 
-            removeResource(pRenderPassData->pVertexBuffer);
-            removeResource(pRenderPassData->pIndexBuffer);
-
-            RemovePipeline(pRenderer, *pRenderPassData);
+            RHI::RemovePooledBuffer(pRenderPassData->vertexBuffer);
+            RHI::RemovePooledBuffer(pRenderPassData->indexBuffer);
 
             pRenderPassData->Reset();
         }
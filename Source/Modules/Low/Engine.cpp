@@ -1,3 +1,4 @@
+#include <random>
 #include "Engine.h"
 #include <ILog.h>
 
@@ -8,32 +9,56 @@ namespace Engine
         ecs.module<module>();
 
         ecs.component<Context>();
+        ecs.component<Camera>();
 
         // Create custom FLECS phases
-        flecs::entity FontsRenderPhase = ecs.entity("FontsRenderPhase")
+        flecs::entity AcquirePhase = ecs.entity("AcquirePhase")
             .add(flecs::Phase)
             .depends_on(flecs::OnStore);
 
+        flecs::entity SceneRenderPhase = ecs.entity("SceneRenderPhase")
+            .add(flecs::Phase)
+            .depends_on(AcquirePhase);
+
+        flecs::entity UpscaleAcquirePhase = ecs.entity("UpscaleAcquirePhase")
+            .add(flecs::Phase)
+            .depends_on(SceneRenderPhase);
+
+        flecs::entity UpscalePhase = ecs.entity("UpscalePhase")
+            .add(flecs::Phase)
+            .depends_on(UpscaleAcquirePhase);
+
+        flecs::entity FontsRenderPhase = ecs.entity("FontsRenderPhase")
+            .add(flecs::Phase)
+            .depends_on(UpscalePhase);
+
         flecs::entity UIRenderPhase = ecs.entity("UIRenderPhase")
             .add(flecs::Phase)
             .depends_on(FontsRenderPhase);
 
-        flecs::entity PresentationPhase = ecs.entity("PresentationPhase")
+        flecs::entity ReadbackPhase = ecs.entity("ReadbackPhase")
             .add(flecs::Phase)
             .depends_on(UIRenderPhase);
+
+        flecs::entity PresentationPhase = ecs.entity("PresentationPhase")
+            .add(flecs::Phase)
+            .depends_on(ReadbackPhase);
     }
 
     void KickstartEngine(flecs::world& ecs, std::string const* pAppName)
     {
         // Create the context
         ecs.set<Context>({});
-        
+
+        auto pContext = ecs.get_mut<Context>();
+        ASSERT(pContext);
+
         if (pAppName)
-        {
-            auto pContext = ecs.get_mut<Context>();
-            ASSERT(pContext);
             pContext->SetAppName(*pAppName);
-        }
+
+        // Runs differ by default, replays pin this back to the recorded seed
+        std::random_device rd;
+        pContext->SetRandomSeed(rd());
 
         // Create a window entity with a canvas
         flecs::entity winEnt = ecs.entity("MainWindow");
@@ -46,12 +71,27 @@ namespace Engine
 
         switch (phase)
         {
+        case Engine::ACQUIRE:
+            ret = ecs.lookup("Engine::module::AcquirePhase");
+            break;
+        case Engine::SCENE_RENDER:
+            ret = ecs.lookup("Engine::module::SceneRenderPhase");
+            break;
+        case Engine::UPSCALE_ACQUIRE:
+            ret = ecs.lookup("Engine::module::UpscaleAcquirePhase");
+            break;
+        case Engine::UPSCALE:
+            ret = ecs.lookup("Engine::module::UpscalePhase");
+            break;
         case Engine::FONTS_RENDER:
             ret = ecs.lookup("Engine::module::FontsRenderPhase");
             break;
         case Engine::UI_RENDER:
             ret = ecs.lookup("Engine::module::UIRenderPhase");
             break;
+        case Engine::READBACK:
+            ret = ecs.lookup("Engine::module::ReadbackPhase");
+            break;
         case Engine::PRESENT:
             ret = ecs.lookup("Engine::module::PresentationPhase");
             break;
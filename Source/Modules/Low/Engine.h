@@ -2,6 +2,7 @@
 
 #include <string>
 #include <flecs.h>
+#include <glm/glm.hpp>
 #include "LifeCycledModule.h"
 
 #ifndef APP_NAME
@@ -15,6 +16,15 @@ namespace Engine
 	{
 		unsigned int width = 256;
 		unsigned int height = 256;
+		bool offscreen = false; // rendered to a render target instead of a window (eg. captures, displayless runs)
+	};
+
+	// View the world is rendered from (singleton, set by apps drawing in 3D).  Matrices follow glm's conventions, the projection's
+	// clip space the RHI's (depth in [0, 1]).
+	struct Camera
+	{
+		glm::mat4 view = glm::mat4(1.f);
+		glm::mat4 projection = glm::mat4(1.f);
 	};
 
 	// Contains general and commonly used data related to the current state(s) of the engine
@@ -24,12 +34,22 @@ namespace Engine
 	private:
 		std::string mAppName = APP_NAME;
 		bool mRequestedExit = false;
+		unsigned int mRandomSeed = 0;
+		float mFixedDeltaTime = 0.f;
 
 	public:
 		std::string const AppName() const { return mAppName; }
 		void SetAppName(std::string const& appName) { mAppName = appName; }
 		void RequestExit() { mRequestedExit = true; }
 		bool const HasRequestedExit() const { return mRequestedExit; }
+
+		// Seed apps should create their random generators with, pinned when replaying recorded inputs so runs are reproducible
+		unsigned int RandomSeed() const { return mRandomSeed; }
+		void SetRandomSeed(unsigned int const seed) { mRandomSeed = seed; }
+
+		// Delta time the world is progressed with, 0 lets flecs measure it (set when replaying recorded inputs)
+		float FixedDeltaTime() const { return mFixedDeltaTime; }
+		void SetFixedDeltaTime(float const deltaTime) { mFixedDeltaTime = deltaTime; }
 	};
 
 	class module : public LifeCycledModule
@@ -43,10 +63,16 @@ namespace Engine
 	void KickstartEngine(flecs::world& ecs, std::string const* pAppName = nullptr);
 
 	// Enum of custom flecs phases
+	// Declared in execution order
 	enum eCustomPhase
 	{
+		ACQUIRE, // late swapchain image acquires (see Window::Settings::lateAcquire), no passes
+		SCENE_RENDER,
+		UPSCALE_ACQUIRE, // late acquires of canvases whose scene is rendered offscreen, no passes
+		UPSCALE,
 		FONTS_RENDER,
 		UI_RENDER,
+		READBACK,
 		PRESENT
 	};
 
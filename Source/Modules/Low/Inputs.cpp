@@ -1,10 +1,387 @@
+#include <algorithm>
 #include <cstring>
+#include <iterator>
+#include <memory>
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_gamepad.h>
 #include <SDL3/SDL_keyboard.h>
+#include <SDL3/SDL_timer.h>
+#include <IFileSystem.h>
 #include <ILog.h>
+#include "Engine.h"
 #include "Inputs.h"
 
 namespace Inputs
 {
+    // Events keep on getting buffered while the world doesn't progress (eg. app paused), don't let that grow forever
+    static size_t const MAX_PENDING_EVENTS = 4096;
+
+    template<typename EventType>
+    static void PushPending(std::vector<EventType>& pending, EventType const& event)
+    {
+        if (pending.size() >= MAX_PENDING_EVENTS)
+            pending.erase(pending.begin());
+
+        pending.push_back(event);
+    }
+
+    // Recording file layout:
+    // - header: magic, version, random seed, number of key states
+    // - per frame: delta time, events time span, key states packed as bits, mouse states, key events, mouse events, gamepad states, touch states
+    static char const RECORDING_MAGIC[4] = { 'T', 'F', 'I', 'R' };
+    static Uint32 const RECORDING_VERSION = 2;
+
+    // Recordings are read and written relative to RD_OTHER_FILES
+    struct Recorder
+    {
+        FileStream stream = {};
+        bool isActive = false;
+        std::vector<Uint8> frameData; // reused to write a frame at once
+    };
+
+    struct Replayer
+    {
+        std::vector<Uint8> data; // whole recording
+        size_t offset = 0;       // where the next frame starts
+        int numRecordedKeys = 0;
+        int numKeys = 0;
+        std::unique_ptr<bool[]> pKeys; // replayed key states, RawKeboardStates::pCur points here while replaying
+        InputSnapshot::Buffer devices; // replayed gamepad and touch states, the snapshot takes them instead of polling SDL
+        bool isActive = false;
+    };
+
+    static Recorder gRecorder;
+    static Replayer gReplayer;
+
+    // Opened gamepads, indexed by their snapshot slot
+    static SDL_Gamepad* gGamepads[InputSnapshot::MAX_GAMEPADS] = {};
+
+    template<typename T>
+    static void WriteValue(std::vector<Uint8>& out, T const& value)
+    {
+        Uint8 const* pBytes = reinterpret_cast<Uint8 const*>(&value);
+        out.insert(out.end(), pBytes, pBytes + sizeof(T));
+    }
+
+    template<typename T>
+    static bool ReadValue(std::vector<Uint8> const& in, size_t& offset, T& value)
+    {
+        if (offset + sizeof(T) > in.size())
+            return false;
+
+        std::memcpy(&value, in.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    static void WriteMouseState(std::vector<Uint8>& out, RawMouseStates::MouseState const& state)
+    {
+        WriteValue(out, state.x);
+        WriteValue(out, state.y);
+        WriteValue(out, state.buttons);
+    }
+
+    static bool ReadMouseState(std::vector<Uint8> const& in, size_t& offset, RawMouseStates::MouseState& state)
+    {
+        return ReadValue(in, offset, state.x) && ReadValue(in, offset, state.y) && ReadValue(in, offset, state.buttons);
+    }
+
+    // Only connected gamepads and touching fingers are written
+    static void WriteDeviceStates(std::vector<Uint8>& out, InputSnapshot::Buffer const& devices)
+    {
+        WriteValue(out, static_cast<Uint8>(devices.gamepadConnected.to_ulong()));
+        for (unsigned int g = 0; g < InputSnapshot::MAX_GAMEPADS; ++g)
+        {
+            if (!devices.gamepadConnected.test(g))
+                continue;
+
+            WriteValue(out, devices.gamepadButtons[g]);
+            for (int a = 0; a < SDL_GAMEPAD_AXIS_COUNT; ++a)
+                WriteValue(out, devices.gamepadAxes[a][g]);
+        }
+
+        WriteValue(out, static_cast<Uint16>(devices.touchDown.to_ulong()));
+        for (unsigned int t = 0; t < InputSnapshot::MAX_TOUCHES; ++t)
+        {
+            if (!devices.touchDown.test(t))
+                continue;
+
+            WriteValue(out, devices.touchIds[t]);
+            WriteValue(out, devices.touchX[t]);
+            WriteValue(out, devices.touchY[t]);
+            WriteValue(out, devices.touchPressure[t]);
+        }
+    }
+
+    static bool ReadDeviceStates(std::vector<Uint8> const& in, size_t& offset, InputSnapshot::Buffer& devices)
+    {
+        static_assert(InputSnapshot::MAX_GAMEPADS <= 8 && InputSnapshot::MAX_TOUCHES <= 16, "Connected gamepads and touching fingers are recorded as bit masks.");
+
+        Uint8 gamepadConnected = 0;
+        if (!ReadValue(in, offset, gamepadConnected))
+            return false;
+
+        devices.gamepadConnected = std::bitset<InputSnapshot::MAX_GAMEPADS>(gamepadConnected);
+        for (unsigned int g = 0; g < InputSnapshot::MAX_GAMEPADS; ++g)
+        {
+            devices.gamepadButtons[g] = 0;
+            for (int a = 0; a < SDL_GAMEPAD_AXIS_COUNT; ++a)
+                devices.gamepadAxes[a][g] = 0.f;
+
+            if (!devices.gamepadConnected.test(g))
+                continue;
+
+            if (!ReadValue(in, offset, devices.gamepadButtons[g]))
+                return false;
+            for (int a = 0; a < SDL_GAMEPAD_AXIS_COUNT; ++a)
+                if (!ReadValue(in, offset, devices.gamepadAxes[a][g]))
+                    return false;
+        }
+
+        Uint16 touchDown = 0;
+        if (!ReadValue(in, offset, touchDown))
+            return false;
+
+        devices.touchDown = std::bitset<InputSnapshot::MAX_TOUCHES>(touchDown);
+        for (unsigned int t = 0; t < InputSnapshot::MAX_TOUCHES; ++t)
+        {
+            if (!devices.touchDown.test(t))
+                continue;
+
+            if (!ReadValue(in, offset, devices.touchIds[t]) || !ReadValue(in, offset, devices.touchX[t]) ||
+                !ReadValue(in, offset, devices.touchY[t]) || !ReadValue(in, offset, devices.touchPressure[t]))
+                return false;
+        }
+
+        return true;
+    }
+
+    static void RecordFrame(float const deltaTime, RawKeboardStates const& rawKb, RawMouseStates const& rawMouse, KeyboardEvents const& kbEvents, MouseEvents const& mouseEvents,
+        InputSnapshot::Buffer const& devices)
+    {
+        std::vector<Uint8>& out = gRecorder.frameData;
+        out.clear();
+
+        WriteValue(out, deltaTime);
+        WriteValue(out, kbEvents.span.beginNS);
+        WriteValue(out, kbEvents.span.endNS);
+
+        for (int k = 0; k < rawKb.numStates; k += 8)
+        {
+            Uint8 bits = 0;
+            for (int b = 0; b < 8 && k + b < rawKb.numStates; ++b)
+                bits |= rawKb.pCur[k + b] ? (1 << b) : 0;
+            out.push_back(bits);
+        }
+
+        WriteMouseState(out, rawMouse.last);
+        WriteMouseState(out, rawMouse.cur);
+        WriteValue(out, mouseEvents.buttonsDown);
+
+        WriteValue(out, static_cast<Uint16>(kbEvents.events.size()));
+        for (KeyEvent const& event : kbEvents.events)
+        {
+            WriteValue(out, event.timestampNS);
+            WriteValue(out, static_cast<Uint16>(event.scanCode));
+            WriteValue(out, event.keyCode);
+            WriteValue(out, event.keyMod);
+            WriteValue(out, static_cast<Uint8>((event.isDown ? 1 : 0) | (event.isRepeat ? 2 : 0)));
+        }
+
+        WriteValue(out, static_cast<Uint16>(mouseEvents.events.size()));
+        for (MouseEvent const& event : mouseEvents.events)
+        {
+            WriteValue(out, event.timestampNS);
+            WriteValue(out, static_cast<Uint8>(event.type));
+            WriteValue(out, event.button);
+            WriteValue(out, event.x);
+            WriteValue(out, event.y);
+        }
+
+        WriteDeviceStates(out, devices);
+
+        if (fsWriteToStream(&gRecorder.stream, out.data(), out.size()) != out.size())
+        {
+            LOGF(eERROR, "Could not write the inputs of the frame, recording stopped.");
+            fsCloseStream(&gRecorder.stream);
+            gRecorder.isActive = false;
+        }
+    }
+
+    // Returns false once there are no (complete) frames left
+    static bool ReplayFrame(RawKeboardStates& rawKb, RawMouseStates& rawMouse, KeyboardEvents& kbEvents, MouseEvents& mouseEvents)
+    {
+        std::vector<Uint8> const& in = gReplayer.data;
+        size_t offset = gReplayer.offset;
+
+        float deltaTime = 0.f;
+        EventsTimeSpan span = {};
+        if (!ReadValue(in, offset, deltaTime) || !ReadValue(in, offset, span.beginNS) || !ReadValue(in, offset, span.endNS))
+            return false;
+
+        for (int k = 0; k < gReplayer.numRecordedKeys; k += 8)
+        {
+            Uint8 bits = 0;
+            if (!ReadValue(in, offset, bits))
+                return false;
+            for (int b = 0; b < 8 && k + b < gReplayer.numKeys; ++b)
+                gReplayer.pKeys[k + b] = (bits >> b) & 1;
+        }
+
+        RawMouseStates::MouseState last = {};
+        RawMouseStates::MouseState cur = {};
+        Uint32 buttonsDown = 0;
+        if (!ReadMouseState(in, offset, last) || !ReadMouseState(in, offset, cur) || !ReadValue(in, offset, buttonsDown))
+            return false;
+
+        Uint16 numKeyEvents = 0;
+        if (!ReadValue(in, offset, numKeyEvents))
+            return false;
+
+        kbEvents.events.resize(numKeyEvents);
+        for (KeyEvent& event : kbEvents.events)
+        {
+            Uint16 scanCode = 0;
+            Uint8 flags = 0;
+            if (!ReadValue(in, offset, event.timestampNS) || !ReadValue(in, offset, scanCode) || !ReadValue(in, offset, event.keyCode) ||
+                !ReadValue(in, offset, event.keyMod) || !ReadValue(in, offset, flags))
+                return false;
+
+            event.scanCode = static_cast<SDL_Scancode>(scanCode);
+            event.isDown = flags & 1;
+            event.isRepeat = flags & 2;
+        }
+
+        Uint16 numMouseEvents = 0;
+        if (!ReadValue(in, offset, numMouseEvents))
+            return false;
+
+        mouseEvents.events.resize(numMouseEvents);
+        for (MouseEvent& event : mouseEvents.events)
+        {
+            Uint8 type = 0;
+            if (!ReadValue(in, offset, event.timestampNS) || !ReadValue(in, offset, type) || !ReadValue(in, offset, event.button) ||
+                !ReadValue(in, offset, event.x) || !ReadValue(in, offset, event.y))
+                return false;
+
+            event.type = static_cast<MouseEvent::eType>(type);
+        }
+
+        if (!ReadDeviceStates(in, offset, gReplayer.devices))
+            return false;
+
+        // Live events received meanwhile are dropped, the recording replaces them
+        kbEvents.pending.clear();
+        kbEvents.span = span;
+        mouseEvents.pending.clear();
+        mouseEvents.span = span;
+        mouseEvents.buttonsDown = buttonsDown;
+
+        rawKb.pCur = gReplayer.pKeys.get();
+        rawMouse.last = last;
+        rawMouse.cur = cur;
+
+        gReplayer.offset = offset;
+        return true;
+    }
+
+    // Delta time of the frame that will be replayed next (0 if none)
+    static float NextReplayDeltaTime()
+    {
+        size_t offset = gReplayer.offset;
+        float deltaTime = 0.f;
+        return ReadValue(gReplayer.data, offset, deltaTime) ? deltaTime : 0.f;
+    }
+
+    float EventsTimeSpan::Fraction(Uint64 const timestampNS) const
+    {
+        if (endNS <= beginNS)
+            return 1.f;
+
+        if (timestampNS <= beginNS)
+            return 0.f;
+
+        return std::min(1.f, static_cast<float>(static_cast<double>(timestampNS - beginNS) / static_cast<double>(endNS - beginNS)));
+    }
+
+    bool KeyboardEvents::WasPressed(SDL_Scancode const scanCode, Uint64* pTimestampNS) const
+    {
+        for (KeyEvent const& event : events)
+        {
+            if (event.scanCode == scanCode && event.isDown && !event.isRepeat)
+            {
+                if (pTimestampNS)
+                    *pTimestampNS = event.timestampNS;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool KeyboardEvents::WasReleased(SDL_Scancode const scanCode, Uint64* pTimestampNS) const
+    {
+        for (KeyEvent const& event : events)
+        {
+            if (event.scanCode == scanCode && !event.isDown)
+            {
+                if (pTimestampNS)
+                    *pTimestampNS = event.timestampNS;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool KeyboardEvents::WasPressed(SDL_Keycode const keyCode, SDL_Keymod* pKeyMod, Uint64* pTimestampNS) const
+    {
+        SDL_Scancode scanCode = SDL_GetScancodeFromKey(keyCode, pKeyMod);
+        return WasPressed(scanCode, pTimestampNS);
+    }
+
+    unsigned int KeyboardEvents::PressCount(SDL_Scancode const scanCode) const
+    {
+        return static_cast<unsigned int>(std::count_if(events.begin(), events.end(), [scanCode](KeyEvent const& event)
+            {
+                return event.scanCode == scanCode && event.isDown && !event.isRepeat;
+            }));
+    }
+
+    bool MouseEvents::WasPressed(Uint8 const button, Uint64* pTimestampNS) const
+    {
+        for (MouseEvent const& event : events)
+        {
+            if (event.type == MouseEvent::BUTTON_DOWN && event.button == button)
+            {
+                if (pTimestampNS)
+                    *pTimestampNS = event.timestampNS;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool MouseEvents::WasReleased(Uint8 const button, Uint64* pTimestampNS) const
+    {
+        for (MouseEvent const& event : events)
+        {
+            if (event.type == MouseEvent::BUTTON_UP && event.button == button)
+            {
+                if (pTimestampNS)
+                    *pTimestampNS = event.timestampNS;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned int MouseEvents::PressCount(Uint8 const button) const
+    {
+        return static_cast<unsigned int>(std::count_if(events.begin(), events.end(), [button](MouseEvent const& event)
+            {
+                return event.type == MouseEvent::BUTTON_DOWN && event.button == button;
+            }));
+    }
+
     RawKeboardStates::RawKeboardStates()
     {
         pCur = SDL_GetKeyboardState(&numStates);
@@ -51,6 +428,198 @@ namespace Inputs
         return (last.buttons & SDL_BUTTON_LMASK) && !(cur.buttons & SDL_BUTTON_LMASK);
     }
 
+    std::bitset<InputSnapshot::MAX_GAMEPADS> InputSnapshot::GamepadsHolding(SDL_GamepadButton const button) const
+    {
+        std::bitset<MAX_GAMEPADS> holding;
+        for (unsigned int g = 0; g < MAX_GAMEPADS; ++g)
+            holding[g] = (cur.gamepadButtons[g] >> button) & 1;
+        return holding;
+    }
+
+    static_assert(SDL_GAMEPAD_BUTTON_COUNT <= 32, "Gamepad buttons are packed in 32 bits.");
+
+    static void SnapshotGamepads(InputSnapshot::Buffer& buffer)
+    {
+        buffer.gamepadConnected.reset();
+
+        for (unsigned int g = 0; g < InputSnapshot::MAX_GAMEPADS; ++g)
+        {
+            buffer.gamepadButtons[g] = 0;
+            for (int a = 0; a < SDL_GAMEPAD_AXIS_COUNT; ++a)
+                buffer.gamepadAxes[a][g] = 0.f;
+
+            SDL_Gamepad* pGamepad = gGamepads[g];
+            if (!pGamepad)
+                continue;
+
+            buffer.gamepadConnected.set(g);
+
+            for (int b = 0; b < SDL_GAMEPAD_BUTTON_COUNT; ++b)
+                if (SDL_GetGamepadButton(pGamepad, static_cast<SDL_GamepadButton>(b)))
+                    buffer.gamepadButtons[g] |= 1u << b;
+
+            for (int a = 0; a < SDL_GAMEPAD_AXIS_COUNT; ++a)
+                buffer.gamepadAxes[a][g] = std::max(-1.f, SDL_GetGamepadAxis(pGamepad, static_cast<SDL_GamepadAxis>(a)) / static_cast<float>(SDL_JOYSTICK_AXIS_MAX));
+        }
+    }
+
+    // Keeps a finger in the slot it had last frame, new fingers take a slot that was free on both frames
+    static unsigned int FindTouchSlot(InputSnapshot::Buffer const& prev, InputSnapshot::Buffer const& cur, SDL_FingerID const fingerId)
+    {
+        for (unsigned int t = 0; t < InputSnapshot::MAX_TOUCHES; ++t)
+            if (prev.touchDown[t] && prev.touchIds[t] == fingerId)
+                return t;
+
+        for (unsigned int t = 0; t < InputSnapshot::MAX_TOUCHES; ++t)
+            if (!prev.touchDown[t] && !cur.touchDown[t])
+                return t;
+
+        for (unsigned int t = 0; t < InputSnapshot::MAX_TOUCHES; ++t)
+            if (!cur.touchDown[t])
+                return t;
+
+        return InputSnapshot::MAX_TOUCHES;
+    }
+
+    static void SnapshotTouches(InputSnapshot::Buffer const& prev, InputSnapshot::Buffer& cur)
+    {
+        cur.touchDown.reset();
+
+        int numDevices = 0;
+        SDL_TouchID* pDevices = SDL_GetTouchDevices(&numDevices);
+        for (int d = 0; d < numDevices; ++d)
+        {
+            int numFingers = 0;
+            SDL_Finger** ppFingers = SDL_GetTouchFingers(pDevices[d], &numFingers);
+            for (int f = 0; f < numFingers; ++f)
+            {
+                unsigned int const slot = FindTouchSlot(prev, cur, ppFingers[f]->id);
+                if (slot >= InputSnapshot::MAX_TOUCHES)
+                    break;
+
+                cur.touchDown.set(slot);
+                cur.touchIds[slot] = ppFingers[f]->id;
+                cur.touchX[slot] = ppFingers[f]->x;
+                cur.touchY[slot] = ppFingers[f]->y;
+                cur.touchPressure[slot] = ppFingers[f]->pressure;
+            }
+            SDL_free(ppFingers);
+        }
+        SDL_free(pDevices);
+    }
+
+    // Copies gamepad and touch states only (eg. replayed ones)
+    static void CopyDeviceStates(InputSnapshot::Buffer const& src, InputSnapshot::Buffer& dst)
+    {
+        dst.gamepadConnected = src.gamepadConnected;
+        std::copy(std::begin(src.gamepadButtons), std::end(src.gamepadButtons), std::begin(dst.gamepadButtons));
+        std::memcpy(dst.gamepadAxes, src.gamepadAxes, sizeof(dst.gamepadAxes));
+
+        dst.touchDown = src.touchDown;
+        std::copy(std::begin(src.touchIds), std::end(src.touchIds), std::begin(dst.touchIds));
+        std::copy(std::begin(src.touchX), std::end(src.touchX), std::begin(dst.touchX));
+        std::copy(std::begin(src.touchY), std::end(src.touchY), std::begin(dst.touchY));
+        std::copy(std::begin(src.touchPressure), std::end(src.touchPressure), std::begin(dst.touchPressure));
+    }
+
+    static void CompileAction(ActionMap::Action& action)
+    {
+        action.keys.reset();
+
+        for (SDL_Scancode const scanCode : action.binding.scanCodes)
+            if (scanCode > SDL_SCANCODE_UNKNOWN && scanCode < SDL_SCANCODE_COUNT)
+                action.keys.set(scanCode);
+
+        for (SDL_Keycode const keyCode : action.binding.keyCodes)
+        {
+            SDL_Scancode const scanCode = SDL_GetScancodeFromKey(keyCode, nullptr);
+            if (scanCode > SDL_SCANCODE_UNKNOWN && scanCode < SDL_SCANCODE_COUNT)
+                action.keys.set(scanCode);
+        }
+    }
+
+    ActionId ActionMap::Bind(char const* name, ActionBinding const& binding)
+    {
+        ActionId id = Find(name);
+
+        if (id == INVALID_ACTION)
+        {
+            ASSERTMSG(actions.size() < MAX_ACTIONS, "Too many actions bound.");
+            if (actions.size() >= MAX_ACTIONS)
+                return INVALID_ACTION;
+
+            id = static_cast<ActionId>(actions.size());
+            actions.push_back({});
+            actions.back().name = name;
+        }
+
+        actions[id].binding = binding;
+        CompileAction(actions[id]);
+
+        return id;
+    }
+
+    ActionId ActionMap::Find(char const* name) const
+    {
+        for (size_t a = 0; a < actions.size(); ++a)
+        {
+            if (actions[a].name == name)
+                return static_cast<ActionId>(a);
+        }
+        return INVALID_ACTION;
+    }
+
+    void ActionMap::Compile()
+    {
+        for (Action& action : actions)
+            CompileAction(action);
+    }
+
+    void ActionMap::Update(InputSnapshot const& snapshot, KeyboardEvents const& kbEvents, MouseEvents const& mouseEvents)
+    {
+        std::bitset<SDL_SCANCODE_COUNT> const& keysDown = snapshot.cur.keys;
+        Uint32 const mouseButtonsDown = snapshot.cur.mouseButtons;
+
+        // Keys and buttons that went down/up during the frame, catches presses shorter than a frame
+        std::bitset<SDL_SCANCODE_COUNT> keysPressed;
+        std::bitset<SDL_SCANCODE_COUNT> keysReleased;
+        for (KeyEvent const& event : kbEvents.events)
+        {
+            if (event.isRepeat || event.scanCode <= SDL_SCANCODE_UNKNOWN || event.scanCode >= SDL_SCANCODE_COUNT)
+                continue;
+
+            if (event.isDown)
+                keysPressed.set(event.scanCode);
+            else
+                keysReleased.set(event.scanCode);
+        }
+
+        Uint32 buttonsPressed = 0;
+        Uint32 buttonsReleased = 0;
+        for (MouseEvent const& event : mouseEvents.events)
+        {
+            if (event.type == MouseEvent::BUTTON_DOWN)
+                buttonsPressed |= SDL_BUTTON_MASK(event.button);
+            else if (event.type == MouseEvent::BUTTON_UP)
+                buttonsReleased |= SDL_BUTTON_MASK(event.button);
+        }
+
+        std::bitset<MAX_ACTIONS> newHeld;
+        std::bitset<MAX_ACTIONS> tapped;
+        std::bitset<MAX_ACTIONS> lifted;
+        for (size_t a = 0; a < actions.size(); ++a)
+        {
+            Action const& action = actions[a];
+            newHeld[a] = (action.keys & keysDown).any() || (action.binding.mouseButtons & mouseButtonsDown);
+            tapped[a] = (action.keys & keysPressed).any() || (action.binding.mouseButtons & buttonsPressed);
+            lifted[a] = (action.keys & keysReleased).any() || (action.binding.mouseButtons & buttonsReleased);
+        }
+
+        pressed = (newHeld & ~held) | tapped;
+        released = (held & ~newHeld) | lifted;
+        held = newHeld;
+    }
+
     module::module(flecs::world& ecs)
     {
         ecs.module<module>();
@@ -58,6 +627,163 @@ namespace Inputs
         // Create singletons
         ecs.set<RawKeboardStates>(RawKeboardStates());
         ecs.set<RawMouseStates>(RawMouseStates());
+        ecs.set<KeyboardEvents>({});
+        ecs.set<MouseEvents>({});
+        ecs.set<InputSnapshot>({});
+        ecs.set<ActionMap>({});
+
+        // Hands the events received since last frame over to this frame
+        auto gatherEvents = ecs.system("Gather Input Events")
+            .kind(flecs::OnLoad)
+            .run([](flecs::iter& it)
+                {
+                    Uint64 const nowNS = SDL_GetTicksNS();
+
+                    KeyboardEvents* pKbEvents = it.world().has<KeyboardEvents>() ? it.world().get_mut<KeyboardEvents>() : nullptr;
+                    if (pKbEvents)
+                    {
+                        pKbEvents->events.swap(pKbEvents->pending);
+                        pKbEvents->pending.clear();
+                        pKbEvents->span.beginNS = pKbEvents->span.endNS;
+                        pKbEvents->span.endNS = nowNS;
+                    }
+
+                    MouseEvents* pMouseEvents = it.world().has<MouseEvents>() ? it.world().get_mut<MouseEvents>() : nullptr;
+                    if (pMouseEvents)
+                    {
+                        pMouseEvents->events.swap(pMouseEvents->pending);
+                        pMouseEvents->pending.clear();
+                        pMouseEvents->span.beginNS = pMouseEvents->span.endNS;
+                        pMouseEvents->span.endNS = nowNS;
+                        pMouseEvents->buttonsDown = SDL_GetMouseState(nullptr, nullptr);
+                    }
+                }
+            );
+
+        // Overrides this frame's states and events with the replayed ones
+        auto replayInputs = ecs.system("Replay Inputs")
+            .kind(flecs::OnLoad)
+            .run([](flecs::iter& it)
+                {
+                    if (!gReplayer.isActive)
+                        return;
+
+                    RawKeboardStates* pRawKb = it.world().has<RawKeboardStates>() ? it.world().get_mut<RawKeboardStates>() : nullptr;
+                    RawMouseStates* pRawMouse = it.world().has<RawMouseStates>() ? it.world().get_mut<RawMouseStates>() : nullptr;
+                    KeyboardEvents* pKbEvents = it.world().has<KeyboardEvents>() ? it.world().get_mut<KeyboardEvents>() : nullptr;
+                    MouseEvents* pMouseEvents = it.world().has<MouseEvents>() ? it.world().get_mut<MouseEvents>() : nullptr;
+                    Engine::Context* pEngineContext = it.world().has<Engine::Context>() ? it.world().get_mut<Engine::Context>() : nullptr;
+
+                    if (!pRawKb || !pRawMouse || !pKbEvents || !pMouseEvents || !pEngineContext)
+                        return;
+
+                    if (!ReplayFrame(*pRawKb, *pRawMouse, *pKbEvents, *pMouseEvents))
+                    {
+                        LOGF(eINFO, "Input replay finished.");
+
+                        gReplayer.isActive = false;
+                        pRawKb->pCur = SDL_GetKeyboardState(nullptr);
+                        pKbEvents->events.clear();
+                        pMouseEvents->events.clear();
+                        pEngineContext->SetFixedDeltaTime(0.f);
+                        pEngineContext->RequestExit();
+                        return;
+                    }
+
+                    // The world is progressed with the recorded delta time of the frame
+                    pEngineContext->SetFixedDeltaTime(NextReplayDeltaTime());
+                }
+            );
+
+        // Takes the frame's snapshot of all devices.  Keyboard and mouse come from the singletons above so replays drive it too.
+        auto snapshotDevices = ecs.system("Snapshot Input Devices")
+            .kind(flecs::OnLoad)
+            .run([](flecs::iter& it)
+                {
+                    InputSnapshot* pSnapshot = it.world().has<InputSnapshot>() ? it.world().get_mut<InputSnapshot>() : nullptr;
+                    RawKeboardStates const* pRawKb = it.world().has<RawKeboardStates>() ? it.world().get<RawKeboardStates>() : nullptr;
+                    MouseEvents const* pMouseEvents = it.world().has<MouseEvents>() ? it.world().get<MouseEvents>() : nullptr;
+
+                    if (!pSnapshot || !pRawKb || !pMouseEvents)
+                        return;
+
+                    pSnapshot->prev = pSnapshot->cur;
+                    InputSnapshot::Buffer& cur = pSnapshot->cur;
+
+                    cur.keys.reset();
+                    for (int k = 0; k < std::min(pRawKb->numStates, static_cast<int>(SDL_SCANCODE_COUNT)); ++k)
+                        if (pRawKb->pCur[k])
+                            cur.keys.set(k);
+
+                    for (MouseEvent const& event : pMouseEvents->events)
+                    {
+                        if (event.type != MouseEvent::WHEEL)
+                        {
+                            cur.mouseX = event.x;
+                            cur.mouseY = event.y;
+                        }
+                    }
+                    cur.mouseButtons = pMouseEvents->buttonsDown;
+
+                    KeyboardEvents const* pKbEvents = it.world().has<KeyboardEvents>() ? it.world().get<KeyboardEvents>() : nullptr;
+                    pSnapshot->newestEventNS = 0;
+                    if (!gReplayer.isActive)
+                    {
+                        if (pKbEvents && !pKbEvents->events.empty())
+                            pSnapshot->newestEventNS = pKbEvents->events.back().timestampNS;
+                        if (!pMouseEvents->events.empty())
+                            pSnapshot->newestEventNS = std::max(pSnapshot->newestEventNS, pMouseEvents->events.back().timestampNS);
+                    }
+
+                    if (gReplayer.isActive)
+                    {
+                        CopyDeviceStates(gReplayer.devices, cur);
+                    }
+                    else
+                    {
+                        SnapshotGamepads(cur);
+                        SnapshotTouches(pSnapshot->prev, cur);
+                    }
+                }
+            );
+
+        // Writes this frame's states and events, as the rest of the frame will see them (after the snapshot, which polls gamepads and touches)
+        auto recordInputs = ecs.system("Record Inputs")
+            .kind(flecs::OnLoad)
+            .run([](flecs::iter& it)
+                {
+                    if (!gRecorder.isActive)
+                        return;
+
+                    RawKeboardStates const* pRawKb = it.world().has<RawKeboardStates>() ? it.world().get<RawKeboardStates>() : nullptr;
+                    RawMouseStates const* pRawMouse = it.world().has<RawMouseStates>() ? it.world().get<RawMouseStates>() : nullptr;
+                    KeyboardEvents const* pKbEvents = it.world().has<KeyboardEvents>() ? it.world().get<KeyboardEvents>() : nullptr;
+                    MouseEvents const* pMouseEvents = it.world().has<MouseEvents>() ? it.world().get<MouseEvents>() : nullptr;
+                    InputSnapshot const* pSnapshot = it.world().has<InputSnapshot>() ? it.world().get<InputSnapshot>() : nullptr;
+
+                    if (!pRawKb || !pRawMouse || !pKbEvents || !pMouseEvents || !pSnapshot)
+                        return;
+
+                    RecordFrame(it.delta_time(), *pRawKb, *pRawMouse, *pKbEvents, *pMouseEvents, pSnapshot->cur);
+                }
+            );
+
+        // Computes every action's state once for all the systems reading them
+        auto updateActions = ecs.system("Update Actions")
+            .kind(flecs::OnLoad)
+            .run([](flecs::iter& it)
+                {
+                    ActionMap* pActionMap = it.world().has<ActionMap>() ? it.world().get_mut<ActionMap>() : nullptr;
+                    InputSnapshot const* pSnapshot = it.world().has<InputSnapshot>() ? it.world().get<InputSnapshot>() : nullptr;
+                    KeyboardEvents const* pKbEvents = it.world().has<KeyboardEvents>() ? it.world().get<KeyboardEvents>() : nullptr;
+                    MouseEvents const* pMouseEvents = it.world().has<MouseEvents>() ? it.world().get<MouseEvents>() : nullptr;
+
+                    if (!pActionMap || !pSnapshot || !pKbEvents || !pMouseEvents || pActionMap->actions.empty())
+                        return;
+
+                    pActionMap->Update(*pSnapshot, *pKbEvents, *pMouseEvents);
+                }
+            );
 
         // System to poll states and update singletons
         auto pollStates = ecs.system("Poll Inputs")
@@ -71,8 +797,227 @@ namespace Inputs
                    ASSERTMSG(it.world().has<RawMouseStates>(), "Raw mouse states singleton doesn't exist.");
                    auto pRawMouse = it.world().get_mut<RawMouseStates>();
                    pRawMouse->last = pRawMouse->cur;
-                   pRawMouse->cur.buttons = SDL_GetMouseState(&pRawMouse->cur.x, &pRawMouse->cur.y);
+                   if (!gReplayer.isActive)
+                       pRawMouse->cur.buttons = SDL_GetMouseState(&pRawMouse->cur.x, &pRawMouse->cur.y);
                 }
             );
     }
+
+    void module::OnExit(flecs::world& ecs)
+    {
+        if (gRecorder.isActive)
+        {
+            if (!fsCloseStream(&gRecorder.stream))
+                LOGF(eERROR, "Could not close the input recording, it might be truncated.");
+            gRecorder.isActive = false;
+        }
+
+        for (SDL_Gamepad*& pGamepad : gGamepads)
+        {
+            if (pGamepad)
+                SDL_CloseGamepad(pGamepad);
+            pGamepad = nullptr;
+        }
+    }
+
+    void module::ProcessEvent(flecs::world& ecs, const SDL_Event* sdlEvent)
+    {
+        switch (sdlEvent->type)
+        {
+            case SDL_EVENT_KEYMAP_CHANGED:
+            {
+                // Key codes map to different scancodes now
+                ActionMap* pActionMap = ecs.has<ActionMap>() ? ecs.get_mut<ActionMap>() : nullptr;
+                if (pActionMap)
+                    pActionMap->Compile();
+                break;
+            }
+            case SDL_EVENT_GAMEPAD_ADDED:
+            {
+                // Also received for the gamepads connected at startup
+                for (SDL_Gamepad* pGamepad : gGamepads)
+                    if (pGamepad && SDL_GetGamepadID(pGamepad) == sdlEvent->gdevice.which)
+                        return;
+
+                SDL_Gamepad** ppSlot = std::find(std::begin(gGamepads), std::end(gGamepads), nullptr);
+                if (ppSlot == std::end(gGamepads))
+                {
+                    LOGF(eWARNING, "Too many gamepads connected, ignoring the new one.");
+                    break;
+                }
+
+                *ppSlot = SDL_OpenGamepad(sdlEvent->gdevice.which);
+                if (!*ppSlot)
+                    LOGF(eERROR, "Could not open gamepad: %s", SDL_GetError());
+                break;
+            }
+            case SDL_EVENT_GAMEPAD_REMOVED:
+            {
+                for (SDL_Gamepad*& pGamepad : gGamepads)
+                {
+                    if (pGamepad && SDL_GetGamepadID(pGamepad) == sdlEvent->gdevice.which)
+                    {
+                        SDL_CloseGamepad(pGamepad);
+                        pGamepad = nullptr;
+                    }
+                }
+                break;
+            }
+            case SDL_EVENT_KEY_DOWN:
+            case SDL_EVENT_KEY_UP:
+            {
+                KeyboardEvents* pKbEvents = ecs.has<KeyboardEvents>() ? ecs.get_mut<KeyboardEvents>() : nullptr;
+                if (!pKbEvents)
+                    break;
+
+                KeyEvent event = {};
+                event.timestampNS = sdlEvent->key.timestamp;
+                event.scanCode = sdlEvent->key.scancode;
+                event.keyCode = sdlEvent->key.key;
+                event.keyMod = sdlEvent->key.mod;
+                event.isDown = sdlEvent->key.down;
+                event.isRepeat = sdlEvent->key.repeat;
+                PushPending(pKbEvents->pending, event);
+                break;
+            }
+            case SDL_EVENT_MOUSE_MOTION:
+            case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            case SDL_EVENT_MOUSE_BUTTON_UP:
+            case SDL_EVENT_MOUSE_WHEEL:
+            {
+                MouseEvents* pMouseEvents = ecs.has<MouseEvents>() ? ecs.get_mut<MouseEvents>() : nullptr;
+                if (!pMouseEvents)
+                    break;
+
+                MouseEvent event = {};
+                if (sdlEvent->type == SDL_EVENT_MOUSE_MOTION)
+                {
+                    event.type = MouseEvent::MOTION;
+                    event.timestampNS = sdlEvent->motion.timestamp;
+                    event.x = sdlEvent->motion.x;
+                    event.y = sdlEvent->motion.y;
+                }
+                else if (sdlEvent->type == SDL_EVENT_MOUSE_WHEEL)
+                {
+                    event.type = MouseEvent::WHEEL;
+                    event.timestampNS = sdlEvent->wheel.timestamp;
+                    event.x = sdlEvent->wheel.x;
+                    event.y = sdlEvent->wheel.y;
+                }
+                else
+                {
+                    event.type = sdlEvent->button.down ? MouseEvent::BUTTON_DOWN : MouseEvent::BUTTON_UP;
+                    event.timestampNS = sdlEvent->button.timestamp;
+                    event.x = sdlEvent->button.x;
+                    event.y = sdlEvent->button.y;
+                    event.button = sdlEvent->button.button;
+                }
+                PushPending(pMouseEvents->pending, event);
+                break;
+            }
+        }
+    }
+
+    bool StartRecording(flecs::world& ecs, char const* filePath)
+    {
+        ASSERTMSG(!gRecorder.isActive && !gReplayer.isActive, "Inputs are already being recorded or replayed.");
+
+        Engine::Context const* pEngineContext = ecs.has<Engine::Context>() ? ecs.get<Engine::Context>() : nullptr;
+        RawKeboardStates const* pRawKb = ecs.has<RawKeboardStates>() ? ecs.get<RawKeboardStates>() : nullptr;
+        if (!pEngineContext || !pRawKb)
+        {
+            LOGF(eERROR, "Can't record inputs before the engine was kickstarted.");
+            return false;
+        }
+
+        if (!fsOpenStreamFromPath(RD_OTHER_FILES, filePath, FM_WRITE, &gRecorder.stream))
+        {
+            LOGF(eERROR, "Could not open %s for writing.", filePath);
+            return false;
+        }
+
+        std::vector<Uint8> header;
+        header.insert(header.end(), RECORDING_MAGIC, RECORDING_MAGIC + sizeof(RECORDING_MAGIC));
+        WriteValue(header, RECORDING_VERSION);
+        WriteValue(header, static_cast<Uint32>(pEngineContext->RandomSeed()));
+        WriteValue(header, static_cast<Uint32>(pRawKb->numStates));
+        if (fsWriteToStream(&gRecorder.stream, header.data(), header.size()) != header.size())
+        {
+            LOGF(eERROR, "Could not write the header of %s.", filePath);
+            fsCloseStream(&gRecorder.stream);
+            return false;
+        }
+
+        gRecorder.isActive = true;
+
+        LOGF(eINFO, "Recording inputs to %s.", filePath);
+        return true;
+    }
+
+    bool StartReplay(flecs::world& ecs, char const* filePath)
+    {
+        ASSERTMSG(!gRecorder.isActive && !gReplayer.isActive, "Inputs are already being recorded or replayed.");
+
+        Engine::Context* pEngineContext = ecs.has<Engine::Context>() ? ecs.get_mut<Engine::Context>() : nullptr;
+        RawKeboardStates* pRawKb = ecs.has<RawKeboardStates>() ? ecs.get_mut<RawKeboardStates>() : nullptr;
+        if (!pEngineContext || !pRawKb)
+        {
+            LOGF(eERROR, "Can't replay inputs before the engine was kickstarted.");
+            return false;
+        }
+
+        FileStream stream = {};
+        if (!fsOpenStreamFromPath(RD_OTHER_FILES, filePath, FM_READ, &stream))
+        {
+            LOGF(eERROR, "Could not open %s for reading.", filePath);
+            return false;
+        }
+
+        // Recordings are small (tens of bytes per frame), load it whole
+        ssize_t const fileSize = fsGetStreamFileSize(&stream);
+        std::vector<Uint8> data(fileSize > 0 ? static_cast<size_t>(fileSize) : 0);
+        size_t const readSize = data.empty() ? 0 : fsReadFromStream(&stream, data.data(), data.size());
+        fsCloseStream(&stream);
+
+        if (readSize != data.size())
+        {
+            LOGF(eERROR, "Could not read %s.", filePath);
+            return false;
+        }
+
+        size_t offset = 0;
+        char magic[4] = {};
+        Uint32 version = 0;
+        Uint32 seed = 0;
+        Uint32 numKeys = 0;
+        if (!ReadValue(data, offset, magic) || std::memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0 ||
+            !ReadValue(data, offset, version) || version != RECORDING_VERSION ||
+            !ReadValue(data, offset, seed) || !ReadValue(data, offset, numKeys))
+        {
+            LOGF(eERROR, "%s isn't a valid input recording.", filePath);
+            return false;
+        }
+
+        // Keys the recording doesn't know about stay released, recorded keys we don't know about are skipped
+        gReplayer.numRecordedKeys = static_cast<int>(numKeys);
+        gReplayer.numKeys = std::min(static_cast<int>(numKeys), pRawKb->numStates);
+        gReplayer.pKeys.reset(new bool[pRawKb->numStates]());
+        gReplayer.data.swap(data);
+        gReplayer.offset = offset;
+        gReplayer.isActive = true;
+
+        pRawKb->pCur = gReplayer.pKeys.get();
+        std::memset(pRawKb->last.data(), 0, pRawKb->last.size());
+
+        pEngineContext->SetRandomSeed(seed);
+        pEngineContext->SetFixedDeltaTime(NextReplayDeltaTime());
+
+        LOGF(eINFO, "Replaying inputs from %s.", filePath);
+        return true;
+    }
+
+    bool IsReplaying()
+    {
+        return gReplayer.isActive;
+    }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <bitset>
+#include <string>
 #include <vector>
 #include <flecs.h>
 #include "LifeCycledModule.h"
@@ -7,9 +9,13 @@
 #include <SDL3/SDL_keycode.h>
 #include <SDL3/SDL_scancode.h>
 #include <SDL3/SDL_mouse.h>
+#include <SDL3/SDL_gamepad.h>
+#include <SDL3/SDL_touch.h>
 
 // Describes the components that hold the low-level previous and current input states (each device will have their own singleton entities).
 // Based on these, higher level modules can handle different specific things (bindings, action types like combos, touch gestures, etc.).
+// Alongside the states, each device also has a buffered queue of the timestamped events received since the last frame, so presses and
+// releases happening within a single frame aren't lost and their sub-frame timing is kept.
 
 namespace Inputs
 {
@@ -46,9 +52,180 @@ namespace Inputs
 		bool WasReleased(Uint32 const buttonMask) const;
 	};
 
+	// Time span covered by a frame's buffered events (SDL_GetTicksNS() clock, same as SDL event timestamps)
+	struct EventsTimeSpan
+	{
+		Uint64 beginNS = 0; // when the previous frame gathered its events
+		Uint64 endNS = 0;   // when the current frame gathered its events
+
+		// Where a timestamp falls within the span, in [0, 1] (eg. to replay an input at the right fixed simulation sub-step)
+		float Fraction(Uint64 const timestampNS) const;
+	};
+
+	struct KeyEvent
+	{
+		Uint64 timestampNS = 0;
+		SDL_Scancode scanCode = SDL_SCANCODE_UNKNOWN;
+		SDL_Keycode keyCode = SDLK_UNKNOWN;
+		SDL_Keymod keyMod = SDL_KMOD_NONE;
+		bool isDown = false;
+		bool isRepeat = false;
+	};
+
+	struct MouseEvent
+	{
+		enum eType
+		{
+			MOTION,
+			BUTTON_DOWN,
+			BUTTON_UP,
+			WHEEL
+		};
+
+		eType type = MOTION;
+		Uint64 timestampNS = 0;
+		float x = 0.f; // cursor position (or scroll amount for wheel events)
+		float y = 0.f;
+		Uint8 button = 0; // SDL_BUTTON_LEFT, etc.
+	};
+
+	// Keyboard events received since the last frame, in the order they happened (singleton)
+	struct KeyboardEvents
+	{
+		std::vector<KeyEvent> events;
+		std::vector<KeyEvent> pending; // received while the frame runs, handed over next frame
+		EventsTimeSpan span;
+
+		// Utilities to check if something was pressed or released since last frame (key repeats are ignored).
+		// pTimestampNS is returned with the time of the first matching event.
+		bool WasPressed(SDL_Scancode const scanCode, Uint64* pTimestampNS = nullptr) const;
+		bool WasReleased(SDL_Scancode const scanCode, Uint64* pTimestampNS = nullptr) const;
+		bool WasPressed(SDL_Keycode const keyCode, SDL_Keymod* pKeyMod = nullptr, Uint64* pTimestampNS = nullptr) const;
+		unsigned int PressCount(SDL_Scancode const scanCode) const;
+	};
+
+	// Mouse events received since the last frame, in the order they happened (singleton)
+	struct MouseEvents
+	{
+		std::vector<MouseEvent> events;
+		std::vector<MouseEvent> pending; // received while the frame runs, handed over next frame
+		EventsTimeSpan span;
+		Uint32 buttonsDown = 0; // buttons held when the events were gathered
+
+		// Utilities to check if a button (eg. SDL_BUTTON_LEFT) was pressed or released since last frame.
+		// pTimestampNS is returned with the time of the first matching event.
+		bool WasPressed(Uint8 const button, Uint64* pTimestampNS = nullptr) const;
+		bool WasReleased(Uint8 const button, Uint64* pTimestampNS = nullptr) const;
+		unsigned int PressCount(Uint8 const button) const;
+	};
+
+	// Every device's state for the frame, taken once at the start of it (singleton).
+	// Fields are laid out as structure of arrays (eg. an axis of all gamepads is contiguous) and digital inputs as packed bitsets, with the
+	// previous frame's buffer kept alongside so edges are a couple of bitwise ops.  Gameplay and the UI both read it instead of querying devices.
+	struct InputSnapshot
+	{
+		static unsigned int const MAX_GAMEPADS = 8;
+		static unsigned int const MAX_TOUCHES = 10;
+
+		struct Buffer
+		{
+			std::bitset<SDL_SCANCODE_COUNT> keys;
+
+			float mouseX = 0.f;
+			float mouseY = 0.f;
+			Uint32 mouseButtons = 0; // SDL_BUTTON_LMASK, etc.
+
+			std::bitset<MAX_GAMEPADS> gamepadConnected;
+			Uint32 gamepadButtons[MAX_GAMEPADS] = {};                     // bit per SDL_GamepadButton
+			float gamepadAxes[SDL_GAMEPAD_AXIS_COUNT][MAX_GAMEPADS] = {}; // sticks in [-1, 1], triggers in [0, 1]
+
+			std::bitset<MAX_TOUCHES> touchDown; // slots keep the same finger for as long as it touches
+			SDL_FingerID touchIds[MAX_TOUCHES] = {};
+			float touchX[MAX_TOUCHES] = {}; // normalized to the touch device, in [0, 1]
+			float touchY[MAX_TOUCHES] = {};
+			float touchPressure[MAX_TOUCHES] = {};
+		};
+
+		Buffer prev;
+		Buffer cur;
+
+		Uint64 newestEventNS = 0; // timestamp of the newest event consumed this frame, 0 if none (or replaying).  Tags the frame for latency stats.
+
+		bool IsHeld(SDL_Scancode const scanCode) const { return cur.keys.test(scanCode); }
+		bool WasPressed(SDL_Scancode const scanCode) const { return cur.keys.test(scanCode) && !prev.keys.test(scanCode); }
+		bool WasReleased(SDL_Scancode const scanCode) const { return !cur.keys.test(scanCode) && prev.keys.test(scanCode); }
+
+		bool IsHeld(unsigned int const gamepad, SDL_GamepadButton const button) const { return cur.gamepadButtons[gamepad] & (1u << button); }
+		bool WasPressed(unsigned int const gamepad, SDL_GamepadButton const button) const { return cur.gamepadButtons[gamepad] & ~prev.gamepadButtons[gamepad] & (1u << button); }
+		bool WasReleased(unsigned int const gamepad, SDL_GamepadButton const button) const { return ~cur.gamepadButtons[gamepad] & prev.gamepadButtons[gamepad] & (1u << button); }
+		float Axis(unsigned int const gamepad, SDL_GamepadAxis const axis) const { return cur.gamepadAxes[axis][gamepad]; }
+
+		// Gamepads holding a button, one bit per gamepad (eg. to test all players at once)
+		std::bitset<MAX_GAMEPADS> GamepadsHolding(SDL_GamepadButton const button) const;
+	};
+
+	// Identifies an action of the action map
+	typedef unsigned int ActionId;
+	ActionId const INVALID_ACTION = static_cast<ActionId>(-1);
+
+	// What triggers an action: any of its keys or mouse buttons
+	struct ActionBinding
+	{
+		std::vector<SDL_Keycode> keyCodes;   // layout dependent, resolved to scancodes when bound (and when the keymap changes)
+		std::vector<SDL_Scancode> scanCodes; // layout independent (eg. WASD)
+		Uint32 mouseButtons = 0;             // SDL_BUTTON_LMASK, etc.
+	};
+
+	// Named actions (singleton).
+	// Bindings are compiled to scancode bitsets when bound.  Every action's state is then computed once per frame by diffing packed
+	// bitsets (including presses shorter than a frame, see KeyboardEvents), so reading actions costs the same no matter how many systems do.
+	struct ActionMap
+	{
+		static unsigned int const MAX_ACTIONS = 64;
+
+		// Rebinding an existing name replaces its binding (and keeps its id)
+		ActionId Bind(char const* name, ActionBinding const& binding);
+		ActionId Find(char const* name) const;
+
+		bool WasPressed(ActionId const action) const { return action < MAX_ACTIONS && pressed.test(action); }
+		bool WasReleased(ActionId const action) const { return action < MAX_ACTIONS && released.test(action); }
+		bool IsHeld(ActionId const action) const { return action < MAX_ACTIONS && held.test(action); }
+
+		// Resolves the key codes of all bindings (eg. after a keymap change)
+		void Compile();
+		// Computes this frame's action states (done by the module at the start of the frame)
+		void Update(InputSnapshot const& snapshot, KeyboardEvents const& kbEvents, MouseEvents const& mouseEvents);
+
+		struct Action
+		{
+			std::string name;
+			ActionBinding binding;
+			std::bitset<SDL_SCANCODE_COUNT> keys; // compiled from the binding
+		};
+
+		std::vector<Action> actions;
+		std::bitset<MAX_ACTIONS> held;
+		std::bitset<MAX_ACTIONS> pressed;
+		std::bitset<MAX_ACTIONS> released;
+	};
+
 	class module : public LifeCycledModule
 	{
 	public:
 		module(flecs::world& ecs); // Ctor that loads the module
+		virtual void OnExit(flecs::world& ecs) override;
+		virtual void ProcessEvent(flecs::world& ecs, const SDL_Event* sdlEvent) override;
 	};
+
+	// Records every frame's device states, buffered events and delta time to a compact binary file (relative to RD_OTHER_FILES), along with
+	// the engine's random seed.
+	// Needs the engine context, start it before the app module so the recording covers its first frame.
+	bool StartRecording(flecs::world& ecs, char const* filePath);
+
+	// Feeds a recording back in place of the devices (live inputs are ignored) and pins the engine's random seed and frame delta times,
+	// so the same frames get simulated.  Exit is requested once all frames were replayed.
+	bool StartReplay(flecs::world& ecs, char const* filePath);
+
+	// Whether a recording is being replayed.  Modules reading devices or SDL events on their own (eg. the UI) should ignore them meanwhile.
+	bool IsReplaying();
 }
@@ -1,4 +1,12 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include <ILog.h>
+#include <IResourceLoader.h>
 
 #include "Engine.h"
 #include "Window.h"
@@ -6,6 +14,293 @@
 
 namespace RHI
 {
+    // Worker threads compiling pipelines queued with AddPipelineAsync
+    class PipelineCompiler
+    {
+    public:
+        PipelineCompiler(Renderer* pRenderer) : pRenderer(pRenderer)
+        {
+            // Leave cores for the main thread (and the driver's own threads)
+            unsigned int const workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+            for (unsigned int i = 0; i < workerCount; ++i)
+                workers.emplace_back([this]() { Work(); });
+        }
+
+        ~PipelineCompiler()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isExiting = true;
+            }
+            condition.notify_all();
+
+            for (std::thread& worker : workers)
+                worker.join();
+        }
+
+        void Enqueue(PipelineHandle const& handle)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(handle);
+            }
+            condition.notify_one();
+        }
+
+        // Returns true if the job was still queued (and thus will never be compiled)
+        bool Cancel(PipelineHandle const& handle)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = std::find(jobs.begin(), jobs.end(), handle);
+            if (it == jobs.end())
+                return false;
+
+            jobs.erase(it);
+            return true;
+        }
+
+    private:
+        void Work()
+        {
+            while (true)
+            {
+                PipelineHandle handle;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [this]() { return isExiting || !jobs.empty(); });
+
+                    // Queued jobs are still compiled on exit so nobody waits on a pipeline that will never be ready
+                    if (jobs.empty())
+                        return;
+
+                    handle = jobs.front();
+                    jobs.pop_front();
+                }
+
+                addPipeline(pRenderer, &handle->desc, &handle->pPipeline);
+                handle->isReady.store(true, std::memory_order_release);
+            }
+        }
+
+        Renderer* pRenderer = nullptr;
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<PipelineHandle> jobs;
+        bool isExiting = false;
+    };
+
+    static PipelineCompiler* gpPipelineCompiler = nullptr;
+
+    // Large buffers small ranges are sub-allocated from (fewer driver allocations and less fragmentation)
+    class BufferPools
+    {
+    public:
+        BufferPools() {}
+
+        ~BufferPools()
+        {
+            for (Pool& pool : pools)
+            {
+                for (Page& page : pool.pages)
+                    removeResource(page.pBuffer);
+            }
+        }
+
+        BufferRange Allocate(eBufferPool const poolType, uint64_t const size, void const* pData)
+        {
+            Pool& pool = pools[poolType];
+            uint64_t const alignedSize = Align(std::max<uint64_t>(size, 1), PoolAlignment(poolType));
+
+            BufferRange range = {};
+            for (Page& page : pool.pages)
+            {
+                if (AllocateFromPage(page, alignedSize, range))
+                    break;
+            }
+
+            if (!range.pBuffer)
+            {
+                // Big allocations get a page of their own
+                pool.pages.push_back(AddPage(poolType, std::max(alignedSize, PoolPageSize(poolType))));
+                AllocateFromPage(pool.pages.back(), alignedSize, range);
+            }
+
+            ASSERTMSG(range.pBuffer, "Could not sub-allocate from buffer pool.");
+            range.size = size;
+
+            if (range.pBuffer && pData)
+            {
+                BufferUpdateDesc updateDesc = { range.pBuffer, range.offset, size };
+                beginUpdateResource(&updateDesc);
+                memcpy(updateDesc.pMappedData, pData, size);
+                endUpdateResource(&updateDesc);
+            }
+
+            return range;
+        }
+
+        void Free(BufferRange const& range)
+        {
+            retired.push_back({ range, currentFrame });
+        }
+
+        // Gives back ranges the GPU can't be using anymore
+        void Recycle(RHI const& rhi)
+        {
+            currentFrame = rhi.frameCount;
+
+            for (size_t r = 0; r < retired.size();)
+            {
+                if (rhi.IsFrameComplete(retired[r].frame))
+                {
+                    Release(retired[r].range);
+                    retired[r] = retired.back();
+                    retired.pop_back();
+                }
+                else
+                {
+                    ++r;
+                }
+            }
+        }
+
+    private:
+        struct FreeBlock
+        {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+        struct Page
+        {
+            Buffer* pBuffer = nullptr;
+            std::vector<FreeBlock> freeBlocks; // sorted by offset
+        };
+
+        struct Pool
+        {
+            std::vector<Page> pages;
+        };
+
+        struct RetiredRange
+        {
+            BufferRange range;
+            uint64_t frame = 0;
+        };
+
+        static uint64_t Align(uint64_t const value, uint64_t const alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        static uint64_t PoolAlignment(eBufferPool const poolType)
+        {
+            // Constant buffer views need 256 bytes alignment on D3D12
+            return poolType == BUFFER_POOL_UNIFORMS ? 256 : 16;
+        }
+
+        static uint64_t PoolPageSize(eBufferPool const poolType)
+        {
+            return poolType == BUFFER_POOL_UNIFORMS ? 64 * 1024 : 1024 * 1024;
+        }
+
+        static Page AddPage(eBufferPool const poolType, uint64_t const size)
+        {
+            Page page = {};
+
+            BufferLoadDesc desc = {};
+            desc.mDesc.mSize = size;
+            if (poolType == BUFFER_POOL_UNIFORMS)
+            {
+                desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+                desc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+                desc.mDesc.pName = "Uniforms Buffer Pool";
+            }
+            else
+            {
+                desc.mDesc.mDescriptors = static_cast<DescriptorType>(DESCRIPTOR_TYPE_VERTEX_BUFFER | DESCRIPTOR_TYPE_INDEX_BUFFER);
+                desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+                desc.mDesc.pName = "Geometry Buffer Pool";
+            }
+            desc.ppBuffer = &page.pBuffer;
+            addResource(&desc, nullptr);
+
+            page.freeBlocks.push_back({ 0, size });
+            return page;
+        }
+
+        static bool AllocateFromPage(Page& page, uint64_t const alignedSize, BufferRange& rangeOut)
+        {
+            // First fit
+            for (size_t b = 0; b < page.freeBlocks.size(); ++b)
+            {
+                FreeBlock& block = page.freeBlocks[b];
+                if (block.size < alignedSize)
+                    continue;
+
+                rangeOut.pBuffer = page.pBuffer;
+                rangeOut.offset = block.offset;
+
+                block.offset += alignedSize;
+                block.size -= alignedSize;
+                if (block.size == 0)
+                    page.freeBlocks.erase(page.freeBlocks.begin() + b);
+
+                return true;
+            }
+
+            return false;
+        }
+
+        void Release(BufferRange const& range)
+        {
+            for (unsigned int poolType = 0; poolType < BUFFER_POOL_COUNT; ++poolType)
+            {
+                for (Page& page : pools[poolType].pages)
+                {
+                    if (page.pBuffer != range.pBuffer)
+                        continue;
+
+                    uint64_t const alignment = PoolAlignment(static_cast<eBufferPool>(poolType));
+                    FreeBlock freed = { range.offset, Align(std::max<uint64_t>(range.size, 1), alignment) };
+
+                    // Insert sorted and merge with the neighbours
+                    auto it = std::lower_bound(page.freeBlocks.begin(), page.freeBlocks.end(), freed, [](FreeBlock const& a, FreeBlock const& b) { return a.offset < b.offset; });
+                    it = page.freeBlocks.insert(it, freed);
+
+                    auto next = it + 1;
+                    if (next != page.freeBlocks.end() && it->offset + it->size == next->offset)
+                    {
+                        it->size += next->size;
+                        page.freeBlocks.erase(next);
+                    }
+
+                    if (it != page.freeBlocks.begin())
+                    {
+                        auto prev = it - 1;
+                        if (prev->offset + prev->size == it->offset)
+                        {
+                            prev->size += it->size;
+                            page.freeBlocks.erase(it);
+                        }
+                    }
+
+                    return;
+                }
+            }
+
+            ASSERTMSG(false, "Freed range doesn't belong to any buffer pool.");
+        }
+
+        uint64_t currentFrame = 0;
+        Pool pools[BUFFER_POOL_COUNT];
+        std::vector<RetiredRange> retired;
+    };
+
+    static BufferPools* gpBufferPools = nullptr;
+
     RHI::RHI()
     {
         RendererDesc rendDesc;
@@ -25,11 +320,23 @@ namespace RHI
         cmdRingDesc.mCmdPerPoolCount = 1;
         cmdRingDesc.mAddSyncPrimitives = true;
         addGpuCmdRing(pRenderer, &cmdRingDesc, &gfxCmdRing);
+        frameFences.assign(dataBufferCount, nullptr);
+
+        gpPipelineCompiler = new PipelineCompiler(pRenderer);
+        gpBufferPools = new BufferPools();
     }
 
     RHI::~RHI()
     {
         ASSERT(pRenderer);
+
+        delete gpPipelineCompiler;
+        gpPipelineCompiler = nullptr;
+
+        // Everyone should be done with the pools by now
+        waitQueueIdle(pGfxQueue);
+        delete gpBufferPools;
+        gpBufferPools = nullptr;
         
         removeGpuCmdRing(pRenderer, &gfxCmdRing);
         
@@ -42,6 +349,47 @@ namespace RHI
         pRenderer = nullptr;
     }
 
+    bool RHI::IsFrameComplete(uint64_t const frame) const
+    {
+        if (frame < completedFrameCount)
+            return true;
+
+        // Not even submitted yet
+        if (frame >= frameCount)
+            return false;
+
+        // The queue executes frames in order, so poll from the oldest one that isn't known to be done
+        for (uint64_t f = completedFrameCount; f < frameCount; ++f)
+        {
+            Fence* pFence = frameFences[f % dataBufferCount];
+            ASSERT(pFence);
+
+            // A fence that was already polled as complete reports not submitted until it gets reused
+            FenceStatus fenceStatus;
+            getFenceStatus(pRenderer, pFence, &fenceStatus);
+            if (fenceStatus == FENCE_STATUS_INCOMPLETE)
+                break;
+
+            completedFrameCount = f + 1;
+        }
+
+        return frame < completedFrameCount;
+    }
+
+    void RHI::WaitForFrame(uint64_t const frame) const
+    {
+        if (IsFrameComplete(frame))
+            return;
+
+        ASSERTMSG(frame < frameCount, "Waiting on a frame that wasn't submitted would never return.");
+        if (frame >= frameCount)
+            return;
+
+        Fence* pFence = frameFences[frame % dataBufferCount];
+        waitForFences(pRenderer, 1, &pFence);
+        completedFrameCount = frame + 1;
+    }
+
 
 
     module::module(flecs::world& ecs)
@@ -64,12 +412,22 @@ namespace RHI
                     if (fenceStatus == FENCE_STATUS_INCOMPLETE)
                         waitForFences(pRHI->pRenderer, 1, &pRHI->curCmdRingElem.pFence);
 
+                    // That fence was last signaled by the frame dataBufferCount frames ago, which (and every frame before it) is now done
+                    if (pRHI->frameCount >= pRHI->dataBufferCount)
+                        pRHI->completedFrameCount = std::max(pRHI->completedFrameCount, pRHI->frameCount - pRHI->dataBufferCount + 1);
+                    pRHI->frameFences[pRHI->frameCount % pRHI->dataBufferCount] = pRHI->curCmdRingElem.pFence;
+
                     // Reset cmd pool for this frame
                     resetCmdPool(pRHI->pRenderer, pRHI->curCmdRingElem.pCmdPool);
 
                     // Begin the cmd
                     Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
                     beginCmd(pCmd);
+                    pRHI->frameSubmitted = false;
+
+                    // Pooled ranges freed by frames that are done can be reused
+                    if (gpBufferPools)
+                        gpBufferPools->Recycle(*pRHI);
                 }
             );
     }
@@ -85,4 +443,106 @@ namespace RHI
 
         return ecs.get<RHI>()->pRenderer != nullptr;
     }
-}
\ No newline at end of file
+
+    PipelineHandle AddPipelineAsync(Renderer* pRenderer, PipelineDesc const& desc)
+    {
+        PipelineHandle handle = std::make_shared<AsyncPipeline>();
+        handle->desc = desc;
+
+        if (desc.pName)
+        {
+            handle->name = desc.pName;
+            handle->desc.pName = handle->name.c_str();
+        }
+
+        ASSERTMSG(desc.pPipelineExtensions == nullptr, "Pipeline extensions aren't supported by async pipelines.");
+
+        if (desc.mType == PIPELINE_TYPE_GRAPHICS)
+        {
+            GraphicsPipelineDesc const& src = desc.mGraphicsDesc;
+            GraphicsPipelineDesc& dst = handle->desc.mGraphicsDesc;
+
+            if (src.pVertexLayout)
+            {
+                handle->vertexLayout = *src.pVertexLayout;
+                dst.pVertexLayout = &handle->vertexLayout;
+            }
+            if (src.pBlendState)
+            {
+                handle->blendState = *src.pBlendState;
+                dst.pBlendState = &handle->blendState;
+            }
+            if (src.pDepthState)
+            {
+                handle->depthState = *src.pDepthState;
+                dst.pDepthState = &handle->depthState;
+            }
+            if (src.pRasterizerState)
+            {
+                handle->rasterizerState = *src.pRasterizerState;
+                dst.pRasterizerState = &handle->rasterizerState;
+            }
+            if (src.pColorFormats)
+            {
+                handle->colorFormats.assign(src.pColorFormats, src.pColorFormats + src.mRenderTargetCount);
+                dst.pColorFormats = handle->colorFormats.data();
+            }
+        }
+
+        if (gpPipelineCompiler)
+        {
+            gpPipelineCompiler->Enqueue(handle);
+        }
+        else
+        {
+            addPipeline(pRenderer, &handle->desc, &handle->pPipeline);
+            handle->isReady.store(true, std::memory_order_release);
+        }
+
+        return handle;
+    }
+
+    Pipeline* GetPipeline(PipelineHandle const& handle)
+    {
+        if (!handle || !handle->isReady.load(std::memory_order_acquire))
+            return nullptr;
+
+        return handle->pPipeline;
+    }
+
+    void RemovePipelineAsync(Renderer* pRenderer, PipelineHandle& handle)
+    {
+        if (!handle)
+            return;
+
+        bool const wasCancelled = gpPipelineCompiler && gpPipelineCompiler->Cancel(handle);
+        if (!wasCancelled)
+        {
+            while (!handle->isReady.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            if (handle->pPipeline)
+                removePipeline(pRenderer, handle->pPipeline);
+        }
+
+        handle.reset();
+    }
+
+    BufferRange AddPooledBuffer(eBufferPool const pool, uint64_t const size, void const* pData)
+    {
+        ASSERTMSG(gpBufferPools, "Buffer pools are created with the RHI.");
+        if (!gpBufferPools)
+            return {};
+
+        return gpBufferPools->Allocate(pool, size, pData);
+    }
+
+    void RemovePooledBuffer(BufferRange& range)
+    {
+        if (!gpBufferPools || !range.pBuffer)
+            return;
+
+        gpBufferPools->Free(range);
+        range = {};
+    }
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 #include <IGraphics.h>
 #include <RingBuffer.h>
 #include <flecs.h>
@@ -22,9 +26,52 @@ namespace RHI
 		Renderer* pRenderer = nullptr;
 		unsigned int dataBufferCount = 2; // 1 frame in flight and one being updated on CPU
 		unsigned int frameIndex = 0;
+		uint64_t frameCount = 0; // number of frames submitted so far (monotonically increasing)
+		bool frameSubmitted = false; // whether the current frame's cmds were already submitted
 		Queue* pGfxQueue = nullptr;
 		GpuCmdRing gfxCmdRing = {};
 		GpuCmdRingElement curCmdRingElem = {};
+
+		// GPU progress as a single counter: work recorded while frameCount was N is done once IsFrameComplete(N).
+		// Anything waiting on the GPU (uploads, readbacks, deferred deletions, queries) should key off it instead of the ring's fences.
+		bool IsFrameComplete(uint64_t const frame) const; // never blocks
+		void WaitForFrame(uint64_t const frame) const; // blocks until the frame is done (it must have been submitted)
+
+		mutable uint64_t completedFrameCount = 0; // every frame below this value is done on the GPU (updated lazily)
+		std::vector<Fence*> frameFences; // fence signaled by frame N at [N % dataBufferCount]
+	};
+
+	// Pipeline compiled on a worker thread (see AddPipelineAsync)
+	struct AsyncPipeline
+	{
+		std::atomic<bool> isReady = false;
+		Pipeline* pPipeline = nullptr; // only valid once ready
+
+		// Copies of what the desc points to so the caller's desc doesn't need to outlive the compilation
+		PipelineDesc desc = {};
+		VertexLayout vertexLayout = {};
+		BlendStateDesc blendState = {};
+		DepthStateDesc depthState = {};
+		RasterizerStateDesc rasterizerState = {};
+		std::vector<TinyImageFormat> colorFormats;
+		std::string name;
+	};
+	typedef std::shared_ptr<AsyncPipeline> PipelineHandle;
+
+	// Pools small buffers get sub-allocated from, so tiny static meshes and uniforms don't each need their own resource
+	enum eBufferPool
+	{
+		BUFFER_POOL_GEOMETRY, // static vertex/index data (GPU only, uploaded through the resource loader)
+		BUFFER_POOL_UNIFORMS, // constant data (CPU to GPU, persistently mapped)
+		BUFFER_POOL_COUNT
+	};
+
+	// Range of a pooled buffer.  Bind pBuffer with offset (or use the range when updating descriptors).
+	struct BufferRange
+	{
+		Buffer* pBuffer = nullptr;
+		uint64_t offset = 0;
+		uint64_t size = 0;
 	};
 
 	class module : public LifeCycledModule
@@ -35,4 +82,17 @@ namespace RHI
 
 	// Creates the RHI singleton
 	bool CreateRHI(flecs::world& ecs);
+
+	// Queues the creation of a pipeline on worker threads and returns right away so loading a module doesn't freeze the frame loop
+	// (compiles on the calling thread if the RHI doesn't exist yet)
+	PipelineHandle AddPipelineAsync(Renderer* pRenderer, PipelineDesc const& desc);
+	// Returns the pipeline once it's done compiling, nullptr until then.  Draw systems should skip (or substitute) while it's not ready.
+	Pipeline* GetPipeline(PipelineHandle const& handle);
+	// Cancels the compilation if it hasn't started, waits for it otherwise, then removes the pipeline.  Call it before removing the shaders and root signature in the desc.
+	void RemovePipelineAsync(Renderer* pRenderer, PipelineHandle& handle);
+
+	// Sub-allocates a range from one of the buffer pools (pData is copied in if provided).  Returns an empty range on failure.
+	BufferRange AddPooledBuffer(eBufferPool const pool, uint64_t const size, void const* pData = nullptr);
+	// The range goes back to the pool once the frames that could be using it are done on the GPU
+	void RemovePooledBuffer(BufferRange& range);
 }
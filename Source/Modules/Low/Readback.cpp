@@ -0,0 +1,380 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <tinyimageformat/tinyimageformat_query.h>
+#include <IResourceLoader.h>
+#include <IFileSystem.h>
+#include <ILog.h>
+
+#include "Engine.h"
+#include "RHI.h"
+#include "RenderGraph.h"
+#include "Window.h"
+#include "Readback.h"
+
+namespace Readback
+{
+    // Row pitch alignment required for buffer <-> texture copies (D3D12 is the strictest)
+    static uint32_t const ROW_PITCH_ALIGNMENT = 256;
+
+    struct StagingSlot
+    {
+        Buffer* pBuffer = nullptr;
+        uint64_t size = 0;
+        bool isPending = false; // a copy was recorded and hasn't been consumed yet
+        uint64_t frame = 0;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        uint32_t rowPitch = 0;
+        TinyImageFormat format = TinyImageFormat_UNDEFINED;
+    };
+
+    struct RetiredBuffer
+    {
+        Buffer* pBuffer = nullptr;
+        uint64_t frame = 0; // last frame the buffer could have been used on
+    };
+
+    // Per capturing canvas, ring of staging buffers the GPU copies into
+    struct StagingRing
+    {
+        std::vector<StagingSlot> slots;
+        std::vector<RetiredBuffer> retired;
+        unsigned int framesUntilCapture = 0;
+        unsigned int capturesRecorded = 0;
+        unsigned int framesDelayed = 0; // frames waited so far (see Capture::delay)
+    };
+
+    // Capture requested with CaptureToFile, started once the main window exists (singleton)
+    struct FileCaptureRequest
+    {
+        std::string fileName;
+        unsigned int frameDelay = 0;
+        bool offscreen = false;
+    };
+
+    static void RemoveStagingRing(flecs::world& ecs, StagingRing& ring)
+    {
+        auto pRHI = ecs.has<RHI::RHI>() ? ecs.get<RHI::RHI>() : nullptr;
+        if (!pRHI)
+            return;
+
+        bool hasBuffers = !ring.retired.empty();
+        for (StagingSlot const& slot : ring.slots)
+            hasBuffers |= slot.pBuffer != nullptr;
+
+        if (!hasBuffers)
+            return;
+
+        // Only happens when captures are cancelled or on exit
+        waitQueueIdle(pRHI->pGfxQueue);
+
+        for (StagingSlot& slot : ring.slots)
+        {
+            if (slot.pBuffer)
+                removeResource(slot.pBuffer);
+            slot = {};
+        }
+
+        for (RetiredBuffer const& retired : ring.retired)
+            removeResource(retired.pBuffer);
+        ring.retired.clear();
+    }
+
+    static bool IsSlotReady(RHI::RHI const* pRHI, StagingSlot const& slot)
+    {
+        return slot.isPending && pRHI->IsFrameComplete(slot.frame);
+    }
+
+    module::module(flecs::world& ecs)
+    {
+        ecs.import<Engine::module>();
+        ecs.import<RHI::module>();
+        ecs.import<RenderGraph::module>();
+        ecs.import<Window::module>();
+
+        ecs.module<module>();
+
+        ecs.component<Capture>();
+        ecs.component<FileCaptureRequest>();
+        ecs.component<StagingRing>()
+            .on_remove([](flecs::entity e, StagingRing& ring)
+                {
+                    auto world = e.world();
+                    RemoveStagingRing(world, ring);
+                }
+            );
+
+        // Hands over the images that the GPU is done copying
+        ecs.system<Capture, StagingRing>("Readback Collector")
+            .kind(flecs::PreUpdate)
+            .each([](flecs::iter& it, size_t i, Capture& capture, StagingRing& ring)
+                {
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+                    if (!pRHI)
+                        return;
+
+                    auto world = it.world();
+                    flecs::entity canvasEnt = it.entity(i);
+
+                    // Deliver in the order the copies were recorded
+                    while (true)
+                    {
+                        StagingSlot* pOldest = nullptr;
+                        for (StagingSlot& slot : ring.slots)
+                        {
+                            if (IsSlotReady(pRHI, slot) && (!pOldest || slot.frame < pOldest->frame))
+                                pOldest = &slot;
+                        }
+
+                        if (!pOldest)
+                            break;
+
+                        Image image = {};
+                        image.width = pOldest->width;
+                        image.height = pOldest->height;
+                        image.format = pOldest->format;
+                        image.frame = pOldest->frame;
+
+                        uint32_t const rowSize = image.width * (TinyImageFormat_BitSizeOfBlock(image.format) / 8);
+                        image.pixels.resize(static_cast<size_t>(rowSize) * image.height);
+
+                        uint8_t const* pSrc = static_cast<uint8_t const*>(pOldest->pBuffer->pCpuMappedAddress);
+                        for (unsigned int row = 0; row < image.height; ++row)
+                            memcpy(image.pixels.data() + static_cast<size_t>(row) * rowSize, pSrc + static_cast<size_t>(row) * pOldest->rowPitch, rowSize);
+
+                        pOldest->isPending = false;
+
+                        if (capture.OnCaptured)
+                            capture.OnCaptured(world, canvasEnt, image);
+                    }
+
+                    // Release buffers that got replaced (eg. canvas resize) once the GPU is done with them
+                    for (size_t r = 0; r < ring.retired.size();)
+                    {
+                        if (pRHI->IsFrameComplete(ring.retired[r].frame))
+                        {
+                            removeResource(ring.retired[r].pBuffer);
+                            ring.retired[r] = ring.retired.back();
+                            ring.retired.pop_back();
+                        }
+                        else
+                        {
+                            ++r;
+                        }
+                    }
+
+                    // Done capturing?
+                    if (!capture.continuous && ring.capturesRecorded >= capture.count)
+                    {
+                        bool hasPending = false;
+                        for (StagingSlot const& slot : ring.slots)
+                            hasPending |= slot.isPending;
+
+                        if (!hasPending && ring.retired.empty())
+                        {
+                            // Everything was consumed so the GPU is done with the buffers, no need to wait for it
+                            for (StagingSlot& slot : ring.slots)
+                            {
+                                if (slot.pBuffer)
+                                    removeResource(slot.pBuffer);
+                                slot = {};
+                            }
+
+                            canvasEnt.remove<StagingRing>();
+                            canvasEnt.remove<Capture>();
+                        }
+                    }
+                }
+            );
+
+        // Records the copies of the canvases' targets into the staging buffers
+        ecs.system<Capture, RenderGraph::CanvasTarget>("Readback Recorder")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::READBACK))
+            .each([](flecs::iter& it, size_t i, Capture& capture, RenderGraph::CanvasTarget const& canvasTarget)
+                {
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+                    if (!pRHI || !canvasTarget.pCurRT)
+                        return;
+
+                    flecs::entity canvasEnt = it.entity(i);
+                    StagingRing& ring = canvasEnt.ensure<StagingRing>();
+
+                    if (!capture.continuous && ring.capturesRecorded >= capture.count)
+                        return;
+
+                    if (ring.framesDelayed < capture.delay)
+                    {
+                        ring.framesDelayed += 1;
+                        return;
+                    }
+
+                    if (ring.framesUntilCapture > 0)
+                    {
+                        ring.framesUntilCapture -= 1;
+                        return;
+                    }
+
+                    // One more slot than frames in flight so a free one is normally always available
+                    if (ring.slots.size() != pRHI->dataBufferCount + 1)
+                        ring.slots.resize(pRHI->dataBufferCount + 1);
+
+                    StagingSlot* pSlot = nullptr;
+                    for (StagingSlot& slot : ring.slots)
+                    {
+                        if (!slot.isPending)
+                        {
+                            pSlot = &slot;
+                            break;
+                        }
+                    }
+
+                    // Never stall: skip this capture and try again next frame
+                    if (!pSlot)
+                        return;
+
+                    RenderTarget* pRT = canvasTarget.pCurRT;
+                    uint32_t const bytesPerPixel = TinyImageFormat_BitSizeOfBlock(pRT->mFormat) / 8;
+                    uint32_t const rowPitch = ((pRT->mWidth * bytesPerPixel) + ROW_PITCH_ALIGNMENT - 1) & ~(ROW_PITCH_ALIGNMENT - 1);
+                    uint64_t const size = static_cast<uint64_t>(rowPitch) * pRT->mHeight;
+
+                    if (pSlot->pBuffer && pSlot->size < size)
+                    {
+                        ring.retired.push_back({ pSlot->pBuffer, pRHI->frameCount });
+                        pSlot->pBuffer = nullptr;
+                    }
+
+                    if (!pSlot->pBuffer)
+                    {
+                        BufferLoadDesc bufferDesc = {};
+                        bufferDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_TO_CPU;
+                        bufferDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+                        bufferDesc.mDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+                        bufferDesc.mDesc.mSize = size;
+                        bufferDesc.mDesc.pName = "Readback Staging Buffer";
+                        bufferDesc.ppBuffer = &pSlot->pBuffer;
+                        addResource(&bufferDesc, nullptr);
+                        pSlot->size = size;
+                    }
+
+                    Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
+                    ASSERT(pCmd);
+
+                    auto world = it.world();
+                    if (!RenderGraph::Transition(world, pCmd, RenderGraph::BACKBUFFER, canvasTarget, RESOURCE_STATE_COPY_SOURCE))
+                        return;
+
+                    cmdBeginDebugMarker(pCmd, 1, 0, 1, "Readback::Copy");
+
+                    SubresourceDataDesc subresourceDesc = {};
+                    subresourceDesc.mArrayLayer = 0;
+                    subresourceDesc.mMipLevel = 0;
+                    subresourceDesc.mSrcOffset = 0;
+#if defined(VULKAN) || defined(METAL) || defined(DIRECT3D11)
+                    subresourceDesc.mRowPitch = rowPitch;
+                    subresourceDesc.mSlicePitch = static_cast<uint32_t>(size);
+#endif
+                    cmdCopySubresource(pCmd, pSlot->pBuffer, pRT->pTexture, &subresourceDesc);
+
+                    cmdEndDebugMarker(pCmd);
+
+                    pSlot->isPending = true;
+                    pSlot->frame = pRHI->frameCount;
+                    pSlot->width = pRT->mWidth;
+                    pSlot->height = pRT->mHeight;
+                    pSlot->rowPitch = rowPitch;
+                    pSlot->format = pRT->mFormat;
+
+                    ring.capturesRecorded += 1;
+                    ring.framesUntilCapture = capture.interval > 0 ? capture.interval - 1 : 0;
+                }
+            );
+
+        // Starts the capture requested with CaptureToFile once the main window has its swapchain
+        ecs.system<Engine::Canvas, Window::SDLWindow>("Readback File Capture Starter")
+            .with<Window::MainWindowTag>()
+            .kind(flecs::OnLoad)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+                {
+                    auto world = it.world();
+                    FileCaptureRequest const* pRequest = world.has<FileCaptureRequest>() ? world.get<FileCaptureRequest>() : nullptr;
+                    if (!pRequest || !sdlWin.pSwapChain)
+                        return;
+
+                    flecs::entity canvasEnt = it.entity(i);
+                    if (pRequest->offscreen)
+                        canvasEnt = world.entity("Readback::OffscreenCapture").set<Engine::Canvas>({ canvas.width, canvas.height, true });
+
+                    Capture capture = {};
+                    capture.delay = pRequest->frameDelay;
+                    capture.OnCaptured = [fileName = pRequest->fileName](flecs::world& ecs, flecs::entity, Image const& image)
+                        {
+                            if (SavePPM(image, fileName.c_str()))
+                                LOGF(eINFO, "Captured frame %llu to %s.", static_cast<unsigned long long>(image.frame), fileName.c_str());
+
+                            Engine::Context* pEngineContext = ecs.has<Engine::Context>() ? ecs.get_mut<Engine::Context>() : nullptr;
+                            if (pEngineContext)
+                                pEngineContext->RequestExit();
+                        };
+                    canvasEnt.set<Capture>(capture);
+
+                    world.remove<FileCaptureRequest>();
+                }
+            );
+    }
+
+    void module::OnExit(flecs::world& ecs)
+    {
+        ecs.each([&ecs](StagingRing& ring)
+            {
+                RemoveStagingRing(ecs, ring);
+            });
+    }
+
+    bool SavePPM(Image const& image, char const* fileName)
+    {
+        uint32_t const bytesPerPixel = TinyImageFormat_BitSizeOfBlock(image.format) / 8;
+        if (bytesPerPixel != 4 || TinyImageFormat_ChannelBitWidth(image.format, TinyImageFormat_LC_Red) != 8)
+        {
+            LOGF(eERROR, "Can only save 8 bits per channel RGBA/BGRA images as PPM.");
+            return false;
+        }
+
+        FileStream stream = {};
+        if (!fsOpenStreamFromPath(RD_SCREENSHOTS, fileName, FM_WRITE, &stream))
+        {
+            LOGF(eERROR, "Could not open %s for writing.", fileName);
+            return false;
+        }
+
+        char header[64] = {};
+        int const headerSize = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", image.width, image.height);
+        bool isWritten = fsWriteToStream(&stream, header, headerSize) == static_cast<size_t>(headerSize);
+
+        bool const isBGR = image.format == TinyImageFormat_B8G8R8A8_UNORM || image.format == TinyImageFormat_B8G8R8A8_SRGB;
+        std::vector<uint8_t> row(static_cast<size_t>(image.width) * 3);
+        for (unsigned int y = 0; y < image.height && isWritten; ++y)
+        {
+            uint8_t const* pSrc = image.pixels.data() + static_cast<size_t>(y) * image.width * bytesPerPixel;
+            for (unsigned int x = 0; x < image.width; ++x)
+            {
+                row[x * 3 + 0] = pSrc[x * 4 + (isBGR ? 2 : 0)];
+                row[x * 3 + 1] = pSrc[x * 4 + 1];
+                row[x * 3 + 2] = pSrc[x * 4 + (isBGR ? 0 : 2)];
+            }
+            isWritten = fsWriteToStream(&stream, row.data(), row.size()) == row.size();
+        }
+
+        fsCloseStream(&stream);
+
+        if (!isWritten)
+            LOGF(eERROR, "Could not write %s.", fileName);
+        return isWritten;
+    }
+
+    void CaptureToFile(flecs::world& ecs, char const* fileName, unsigned int const frameDelay, bool const offscreen)
+    {
+        ecs.set<FileCaptureRequest>({ fileName, frameDelay, offscreen });
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <IGraphics.h>
+#include <flecs.h>
+#include "LifeCycledModule.h"
+
+// Reads back the content of canvases (windows or offscreen) to the CPU.
+// Copies are recorded at the end of the frame into a ring of staging buffers and only mapped once the GPU is guaranteed
+// to be done with them (see RHI::IsFrameComplete), so capturing never stalls the frame.
+
+namespace Readback
+{
+	// Pixels of a captured canvas.  Rows are tightly packed (width * bytes per pixel).
+	struct Image
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		TinyImageFormat format = TinyImageFormat_UNDEFINED;
+		std::vector<uint8_t> pixels;
+		uint64_t frame = 0; // frame the image was rendered on (see RHI::frameCount)
+	};
+
+	typedef std::function<void(flecs::world& ecs, flecs::entity canvasEnt, Image const& image)> OnCapturedFn;
+
+	// Add to an entity with a canvas to capture it.  Removed once all requested captures were delivered.
+	struct Capture
+	{
+		unsigned int interval = 1; // capture every N frames
+		unsigned int count = 1; // number of captures to take
+		bool continuous = false; // ignores count and never stops capturing
+		OnCapturedFn OnCaptured = nullptr; // called from the main thread when an image is ready
+		unsigned int delay = 0; // frames rendered before the first capture (eg. to let assets load)
+	};
+
+	class module : public LifeCycledModule
+	{
+	public:
+		module(flecs::world& ecs); // Ctor that loads the module
+		virtual void OnExit(flecs::world& ecs) override;
+	};
+
+	// Saves an 8 bits per channel image as a binary PPM in the screenshots directory (RD_SCREENSHOTS), alpha is dropped
+	bool SavePPM(Image const& image, char const* fileName);
+
+	// Captures a canvas to a PPM file (see SavePPM) once frameDelay frames were rendered, then requests the engine to exit.
+	// The main window gets captured, or an offscreen canvas of its size (apps render to it along with the window).
+	void CaptureToFile(flecs::world& ecs, char const* fileName, unsigned int const frameDelay, bool const offscreen);
+}
@@ -0,0 +1,548 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <ILog.h>
+
+#include "Engine.h"
+#include "RHI.h"
+#include "Window.h"
+#include "RenderGraph.h"
+
+namespace RenderGraph
+{
+    struct Resource
+    {
+        RenderTarget* pRenderTarget = nullptr;
+        ResourceState state = RESOURCE_STATE_UNDEFINED;
+        bool persistent = false;
+        bool isRegistered = false;
+    };
+
+    // The render graph context (singleton)
+    struct Context
+    {
+        // Declared passes (in declaration order) and the compiled execution order
+        std::vector<flecs::entity> declaredPasses;
+        std::vector<flecs::entity> orderedPasses;
+        std::unordered_map<flecs::entity_t, size_t> passOrder;
+        bool isDirty = true;
+
+        // Indices 0 and 1 are reserved for BACKBUFFER and SCENE_COLOR (resolved per pass)
+        std::vector<Resource> resources = { {}, {} };
+        std::vector<size_t> lastAccess; // per resource, order of the last pass that reads or writes it
+
+        // Frame state
+        std::unordered_map<RenderTarget*, ResourceState> backbufferStates;
+        std::unordered_set<RenderTarget*> writtenThisFrame;
+        std::vector<RenderTarget*> boundTargets;
+        RenderTarget* pBoundDepth = nullptr;
+        flecs::entity_t activePass = 0;
+    };
+
+    static void Compile(Context& context)
+    {
+        context.orderedPasses = context.declaredPasses;
+
+        // Passes are executed by phase, so that's the order we can count on.  Stable sort keeps declaration order within a phase.
+        std::stable_sort(context.orderedPasses.begin(), context.orderedPasses.end(), [](flecs::entity const& a, flecs::entity const& b)
+            {
+                return a.get<Pass>()->phase < b.get<Pass>()->phase;
+            });
+
+        context.passOrder.clear();
+        context.lastAccess.assign(context.resources.size(), 0);
+
+        for (size_t i = 0; i < context.orderedPasses.size(); ++i)
+        {
+            Pass const* pPass = context.orderedPasses[i].get<Pass>();
+            context.passOrder[context.orderedPasses[i].id()] = i;
+
+            for (ResourceId const id : pPass->reads)
+                if (id < context.lastAccess.size())
+                    context.lastAccess[id] = i;
+
+            for (ResourceId const id : pPass->writes)
+                if (id < context.lastAccess.size())
+                    context.lastAccess[id] = i;
+
+            if (pPass->depth < context.lastAccess.size())
+                context.lastAccess[pPass->depth] = i;
+        }
+
+        context.isDirty = false;
+    }
+
+    // Offscreen canvases have their target registered with the graph, so BACKBUFFER maps to it.
+    // SCENE_COLOR maps to the canvas' scene target if there's one, otherwise scene passes draw straight to the canvas.
+    static ResourceId ResolveId(ResourceId id, CanvasTarget const& canvasTarget)
+    {
+        if (id == SCENE_COLOR)
+            id = (canvasTarget.sceneResource != INVALID_RESOURCE) ? canvasTarget.sceneResource : BACKBUFFER;
+
+        return (id == BACKBUFFER && canvasTarget.resource != INVALID_RESOURCE) ? canvasTarget.resource : id;
+    }
+
+    static RenderTarget* Resolve(Context const& context, ResourceId const id, RenderTarget* pBackbuffer)
+    {
+        if (id == BACKBUFFER)
+            return pBackbuffer;
+
+        if (id >= context.resources.size() || !context.resources[id].isRegistered)
+            return nullptr;
+
+        return context.resources[id].pRenderTarget;
+    }
+
+    static ResourceState& StateOf(Context& context, ResourceId const id, RenderTarget* pRenderTarget)
+    {
+        if (id == BACKBUFFER)
+        {
+            // Backbuffers are handed over by the presentation engine in the present state
+            return context.backbufferStates.try_emplace(pRenderTarget, RESOURCE_STATE_PRESENT).first->second;
+        }
+
+        return context.resources[id].state;
+    }
+
+    static StoreActionType StoreAction(Context const& context, ResourceId const declaredId, ResourceId const id, size_t const passOrder)
+    {
+        if (id == BACKBUFFER || context.resources[id].persistent)
+            return STORE_ACTION_STORE;
+
+        // Nobody after us cares about the content, don't bother writing it back to memory.
+        // Passes refer to resources by their declared id (eg. SCENE_COLOR), so both need checking.
+        bool const readLater =
+            (declaredId < context.lastAccess.size() && context.lastAccess[declaredId] > passOrder) ||
+            (id < context.lastAccess.size() && context.lastAccess[id] > passOrder);
+
+        return readLater ? STORE_ACTION_STORE : STORE_ACTION_DONTCARE;
+    }
+
+    static void RemoveOffscreenTarget(flecs::world& ecs, CanvasTarget& canvasTarget)
+    {
+        auto pRHI = ecs.has<RHI::RHI>() ? ecs.get_mut<RHI::RHI>() : nullptr;
+        if (!pRHI || !canvasTarget.pOffscreenRT)
+            return;
+
+        waitQueueIdle(pRHI->pGfxQueue);
+
+        UnregisterResource(ecs, canvasTarget.resource);
+        removeRenderTarget(pRHI->pRenderer, canvasTarget.pOffscreenRT);
+
+        canvasTarget.pOffscreenRT = nullptr;
+        canvasTarget.pCurRT = nullptr;
+        canvasTarget.resource = INVALID_RESOURCE;
+    }
+
+    module::module(flecs::world& ecs)
+    {
+        ecs.import<Engine::module>();
+        ecs.import<RHI::module>();
+
+        ecs.module<module>();
+
+        ecs.component<Context>();
+        ecs.component<Pass>();
+        ecs.component<CanvasTarget>()
+            .on_remove([](flecs::entity e, CanvasTarget& canvasTarget)
+                {
+                    auto world = e.world();
+                    RemoveOffscreenTarget(world, canvasTarget);
+                }
+            );
+
+        // Create the context singleton
+        Context context = {};
+        ecs.set<Context>(context);
+
+        ecs.observer<Pass>("Render Graph Pass Declared")
+            .event(flecs::OnSet)
+            .each([](flecs::iter& it, size_t i, Pass& pass)
+                {
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    if (!pContext)
+                        return;
+
+                    flecs::entity const passEnt = it.entity(i);
+                    if (std::find(pContext->declaredPasses.begin(), pContext->declaredPasses.end(), passEnt) == pContext->declaredPasses.end())
+                        pContext->declaredPasses.push_back(passEnt);
+
+                    pContext->isDirty = true;
+                }
+            );
+
+        ecs.observer<Pass>("Render Graph Pass Removed")
+            .event(flecs::OnRemove)
+            .each([](flecs::iter& it, size_t i, Pass& pass)
+                {
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    if (!pContext)
+                        return;
+
+                    flecs::entity const passEnt = it.entity(i);
+                    pContext->declaredPasses.erase(std::remove(pContext->declaredPasses.begin(), pContext->declaredPasses.end(), passEnt), pContext->declaredPasses.end());
+                    pContext->isDirty = true;
+                }
+            );
+
+        // Offscreen canvases get a render target instead of a window, in the main window's format so pipelines can be shared.
+        // Targets are only created once that format is known (the main window's swapchain exists), and recreated when the canvas gets resized.
+        ecs.system<Engine::Canvas>("Offscreen Canvas Target Updater")
+            .kind(flecs::OnLoad)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas)
+                {
+                    if (!canvas.offscreen)
+                        return;
+
+                    auto world = it.world();
+                    auto pRHI = world.has<RHI::RHI>() ? world.get<RHI::RHI>() : nullptr;
+                    ASSERTMSG(pRHI, "RHI singleton doesn't exist.");
+                    if (!pRHI)
+                        return;
+
+                    flecs::entity canvasEnt = it.entity(i);
+                    CanvasTarget* pCanvasTarget = &canvasEnt.ensure<CanvasTarget>();
+
+                    // Nothing to do if the target already matches the canvas
+                    if (pCanvasTarget->pOffscreenRT &&
+                        pCanvasTarget->pOffscreenRT->mWidth == canvas.width &&
+                        pCanvasTarget->pOffscreenRT->mHeight == canvas.height)
+                        return;
+
+                    Window::SDLWindow const* pMainWindow = nullptr;
+                    if (world.count<Window::MainWindowTag>() == 0 || !Window::MainWindow(world, &pMainWindow) || !pMainWindow->pSwapChain)
+                        return;
+
+                    RemoveOffscreenTarget(world, *pCanvasTarget);
+
+                    RenderTargetDesc rtDesc = {};
+                    rtDesc.mArraySize = 1;
+                    rtDesc.mDepth = 1;
+                    rtDesc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+                    rtDesc.mFormat = pMainWindow->pSwapChain->ppRenderTargets[0]->mFormat;
+                    rtDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+                    rtDesc.mWidth = canvas.width;
+                    rtDesc.mHeight = canvas.height;
+                    rtDesc.mSampleCount = SAMPLE_COUNT_1;
+                    rtDesc.mSampleQuality = 0;
+                    rtDesc.pName = "Offscreen Canvas";
+                    addRenderTarget(pRHI->pRenderer, &rtDesc, &pCanvasTarget->pOffscreenRT);
+                    ASSERT(pCanvasTarget->pOffscreenRT);
+
+                    pCanvasTarget->pCurRT = pCanvasTarget->pOffscreenRT;
+                    pCanvasTarget->resource = RegisterResource(world, pCanvasTarget->pOffscreenRT, RESOURCE_STATE_SHADER_RESOURCE, true);
+
+                    LOGF(eINFO, "Offscreen target created for Canvas (%ux%u)", canvas.width, canvas.height);
+                }
+            );
+    }
+
+    void module::OnExit(flecs::world& ecs)
+    {
+        // Offscreen targets need to go before the renderer does
+        ecs.each([&ecs](CanvasTarget& canvasTarget)
+            {
+                RemoveOffscreenTarget(ecs, canvasTarget);
+            });
+    }
+
+    ResourceId RegisterResource(flecs::world& ecs, RenderTarget* pRenderTarget, ResourceState const currentState, bool const persistent)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        ASSERTMSG(pContext, "Render graph context doesn't exist.");
+        if (!pContext)
+            return INVALID_RESOURCE;
+
+        Resource resource = {};
+        resource.pRenderTarget = pRenderTarget;
+        resource.state = currentState;
+        resource.persistent = persistent;
+        resource.isRegistered = true;
+
+        // Reuse a free slot if possible
+        for (ResourceId id = SCENE_COLOR + 1; id < pContext->resources.size(); ++id)
+        {
+            if (!pContext->resources[id].isRegistered)
+            {
+                pContext->resources[id] = resource;
+                pContext->isDirty = true;
+                return id;
+            }
+        }
+
+        pContext->resources.push_back(resource);
+        pContext->isDirty = true;
+
+        return static_cast<ResourceId>(pContext->resources.size() - 1);
+    }
+
+    void UpdateResource(flecs::world& ecs, ResourceId const id, RenderTarget* pRenderTarget, ResourceState const currentState)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext)
+            return;
+
+        ASSERTMSG(id > SCENE_COLOR && id < pContext->resources.size() && pContext->resources[id].isRegistered, "Unknown render graph resource.");
+        ASSERTMSG(pContext->boundTargets.empty(), "Resources can't be updated while a pass is bound.");
+
+        pContext->writtenThisFrame.erase(pContext->resources[id].pRenderTarget);
+        pContext->resources[id].pRenderTarget = pRenderTarget;
+        pContext->resources[id].state = currentState;
+    }
+
+    void UnregisterResource(flecs::world& ecs, ResourceId const id)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext || id <= SCENE_COLOR || id >= pContext->resources.size())
+            return;
+
+        pContext->writtenThisFrame.erase(pContext->resources[id].pRenderTarget);
+        pContext->resources[id] = {};
+        pContext->isDirty = true;
+    }
+
+    bool BeginPass(flecs::world& ecs, Cmd* pCmd, flecs::entity const pass, CanvasTarget const& canvasTarget)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        Pass const* pPass = (pass.is_valid() && pass.has<Pass>()) ? pass.get<Pass>() : nullptr;
+
+        if (!pContext || !pPass || !pCmd)
+            return false;
+
+        ASSERTMSG(pContext->activePass == 0, "BeginPass() called without ending the previous pass.");
+        ASSERTMSG(pPass->writes.size() <= MAX_RENDER_TARGET_ATTACHMENTS, "Too many targets written by pass.");
+        ASSERTMSG(pPass->reads.size() <= MAX_RENDER_TARGET_ATTACHMENTS, "Too many resources read by pass.");
+
+        if (pContext->isDirty)
+            Compile(*pContext);
+
+        ASSERTMSG(pContext->passOrder.find(pass.id()) != pContext->passOrder.end(), "Pass wasn't declared to the render graph.");
+        size_t const passOrder = pContext->passOrder.at(pass.id());
+
+        // Resolve targets and figure out what needs to transition.  Tracked states are only updated once every resource resolved,
+        // a pass that can't begin must not leave states its barriers were never recorded for.
+        RenderTarget* targets[MAX_RENDER_TARGET_ATTACHMENTS] = {};
+        uint32_t const targetCount = static_cast<uint32_t>(pPass->writes.size());
+        RenderTargetBarrier barriers[MAX_RENDER_TARGET_ATTACHMENTS * 2 + 1] = {};
+        ResourceState* pBarrierStates[MAX_RENDER_TARGET_ATTACHMENTS * 2 + 1] = {};
+        uint32_t barrierCount = 0;
+
+        auto transition = [&barriers, &pBarrierStates, &barrierCount](RenderTarget* pRT, ResourceState* pState, ResourceState const newState)
+            {
+                // A resource can be transitioned twice by a pass (eg. read and written), it goes from the pending state then
+                ResourceState currentState = *pState;
+                for (uint32_t b = 0; b < barrierCount; ++b)
+                {
+                    if (pBarrierStates[b] == pState)
+                        currentState = barriers[b].mNewState;
+                }
+
+                if (currentState != newState)
+                {
+                    barriers[barrierCount] = { pRT, currentState, newState };
+                    pBarrierStates[barrierCount] = pState;
+                    ++barrierCount;
+                }
+            };
+
+        for (ResourceId const declaredId : pPass->reads)
+        {
+            ResourceId const id = ResolveId(declaredId, canvasTarget);
+            RenderTarget* pRT = Resolve(*pContext, id, canvasTarget.pCurRT);
+            if (!pRT)
+                return false;
+
+            transition(pRT, &StateOf(*pContext, id, pRT), RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        }
+
+        for (uint32_t t = 0; t < targetCount; ++t)
+        {
+            ResourceId const id = ResolveId(pPass->writes[t], canvasTarget);
+            RenderTarget* pRT = Resolve(*pContext, id, canvasTarget.pCurRT);
+            if (!pRT)
+                return false;
+
+            targets[t] = pRT;
+            transition(pRT, &StateOf(*pContext, id, pRT), RESOURCE_STATE_RENDER_TARGET);
+        }
+
+        RenderTarget* pDepth = nullptr;
+        if (pPass->depth != INVALID_RESOURCE)
+        {
+            ResourceId const id = ResolveId(pPass->depth, canvasTarget);
+            pDepth = Resolve(*pContext, id, canvasTarget.pCurRT);
+            if (!pDepth)
+                return false;
+
+            transition(pDepth, &StateOf(*pContext, id, pDepth), RESOURCE_STATE_DEPTH_WRITE);
+        }
+
+        // Same targets already bound and nothing to transition, keep on going in the same render pass
+        bool const merge = targetCount > 0 && barrierCount == 0 && targetCount == pContext->boundTargets.size() &&
+            std::equal(targets, targets + targetCount, pContext->boundTargets.begin()) && pDepth == pContext->pBoundDepth;
+
+        if (!merge)
+        {
+            Flush(ecs, pCmd);
+
+            if (barrierCount > 0)
+                cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, barrierCount, barriers);
+            for (uint32_t b = 0; b < barrierCount; ++b)
+                *pBarrierStates[b] = barriers[b].mNewState;
+
+            if (targetCount > 0)
+            {
+                BindRenderTargetsDesc bindRenderTargets = {};
+                bindRenderTargets.mRenderTargetCount = targetCount;
+
+                for (uint32_t t = 0; t < targetCount; ++t)
+                {
+                    BindRenderTargetDesc& bindDesc = bindRenderTargets.mRenderTargets[t];
+                    bindDesc.pRenderTarget = targets[t];
+                    bindDesc.mStoreAction = StoreAction(*pContext, pPass->writes[t], ResolveId(pPass->writes[t], canvasTarget), passOrder);
+
+                    if (pContext->writtenThisFrame.find(targets[t]) != pContext->writtenThisFrame.end())
+                    {
+                        bindDesc.mLoadAction = LOAD_ACTION_LOAD;
+                    }
+                    else if (pPass->clear)
+                    {
+                        bindDesc.mLoadAction = LOAD_ACTION_CLEAR;
+                        bindDesc.mClearValue = pPass->clearValue;
+                        bindDesc.mOverrideClearValue = true;
+                    }
+                    else
+                    {
+                        bindDesc.mLoadAction = LOAD_ACTION_DONTCARE;
+                    }
+                }
+
+                if (pDepth)
+                {
+                    BindDepthTargetDesc& bindDesc = bindRenderTargets.mDepthStencil;
+                    bindDesc.pDepthStencil = pDepth;
+                    bindDesc.mStoreAction = StoreAction(*pContext, pPass->depth, ResolveId(pPass->depth, canvasTarget), passOrder);
+                    bindDesc.mStoreActionStencil = STORE_ACTION_DONTCARE;
+                    bindDesc.mLoadActionStencil = LOAD_ACTION_DONTCARE;
+
+                    if (pContext->writtenThisFrame.find(pDepth) != pContext->writtenThisFrame.end())
+                    {
+                        bindDesc.mLoadAction = LOAD_ACTION_LOAD;
+                    }
+                    else if (pPass->clearDepth)
+                    {
+                        bindDesc.mLoadAction = LOAD_ACTION_CLEAR;
+                        bindDesc.mClearValue = pPass->depthClearValue;
+                        bindDesc.mOverrideClearValue = true;
+                    }
+                    else
+                    {
+                        bindDesc.mLoadAction = LOAD_ACTION_DONTCARE;
+                    }
+                }
+
+                cmdBindRenderTargets(pCmd, &bindRenderTargets);
+                pContext->boundTargets.assign(targets, targets + targetCount);
+                pContext->pBoundDepth = pDepth;
+            }
+        }
+
+        if (targetCount > 0)
+        {
+            // Scene targets are only partially rendered to (their resolution scales)
+            bool const isSceneTarget = canvasTarget.sceneResource != INVALID_RESOURCE && ResolveId(pPass->writes[0], canvasTarget) == canvasTarget.sceneResource;
+            unsigned int const width = isSceneTarget ? canvasTarget.sceneWidth : targets[0]->mWidth;
+            unsigned int const height = isSceneTarget ? canvasTarget.sceneHeight : targets[0]->mHeight;
+
+            cmdSetViewport(pCmd, 0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f);
+            cmdSetScissor(pCmd, 0, 0, width, height);
+        }
+
+        for (uint32_t t = 0; t < targetCount; ++t)
+            pContext->writtenThisFrame.insert(targets[t]);
+        if (pDepth)
+            pContext->writtenThisFrame.insert(pDepth);
+
+        pContext->activePass = pass.id();
+
+        return true;
+    }
+
+    void EndPass(flecs::world& ecs, Cmd* pCmd, flecs::entity const pass)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext)
+            return;
+
+        ASSERTMSG(pContext->activePass == pass.id(), "EndPass() called on a pass that isn't active.");
+
+        // Targets stay bound so the next pass can merge with us.  They get unbound once something else needs to happen.
+        pContext->activePass = 0;
+    }
+
+    void Flush(flecs::world& ecs, Cmd* pCmd)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext)
+            return;
+
+        if (!pContext->boundTargets.empty())
+        {
+            cmdBindRenderTargets(pCmd, nullptr);
+            pContext->boundTargets.clear();
+            pContext->pBoundDepth = nullptr;
+        }
+    }
+
+    bool Transition(flecs::world& ecs, Cmd* pCmd, ResourceId const resource, CanvasTarget const& canvasTarget, ResourceState const newState)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext)
+            return false;
+
+        ASSERTMSG(pContext->activePass == 0, "Can't transition resources while a pass is active.");
+
+        ResourceId const id = ResolveId(resource, canvasTarget);
+        RenderTarget* pRT = Resolve(*pContext, id, canvasTarget.pCurRT);
+        if (!pRT)
+            return false;
+
+        ResourceState& state = StateOf(*pContext, id, pRT);
+        if (state != newState)
+        {
+            Flush(ecs, pCmd);
+
+            RenderTargetBarrier barrier = { pRT, state, newState };
+            cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, 1, &barrier);
+            state = newState;
+        }
+
+        return true;
+    }
+
+    void EndFrame(flecs::world& ecs, Cmd* pCmd)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext)
+            return;
+
+        ASSERTMSG(pContext->activePass == 0, "Frame ended while a pass is still active.");
+
+        Flush(ecs, pCmd);
+
+        std::vector<RenderTargetBarrier> barriers;
+        for (auto const& backbufferState : pContext->backbufferStates)
+        {
+            if (backbufferState.second != RESOURCE_STATE_PRESENT)
+                barriers.push_back({ backbufferState.first, backbufferState.second, RESOURCE_STATE_PRESENT });
+        }
+
+        if (!barriers.empty())
+            cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        pContext->backbufferStates.clear();
+        pContext->writtenThisFrame.clear();
+        pContext->activePass = 0;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <IGraphics.h>
+#include <flecs.h>
+#include "LifeCycledModule.h"
+#include "Engine.h"
+
+// Small render graph that sits on top of the custom render phases.
+// Passes declare (once) what they read and write.  The graph orders them by phase (then declaration order) and,
+// while passes are being recorded, takes care of resource barriers, load/store actions and merging consecutive
+// passes that write the same targets into a single render pass (no redundant LOAD of the backbuffer on tilers).
+
+namespace RenderGraph
+{
+	// Identifies a resource known by the graph
+	typedef unsigned int ResourceId;
+
+	// Resolves to the render target of the canvas currently being drawn to (eg. the acquired swapchain image)
+	ResourceId const BACKBUFFER = 0;
+	// Resolves to the canvas' scene target when it has one (eg. dynamic resolution), BACKBUFFER otherwise
+	ResourceId const SCENE_COLOR = 1;
+	ResourceId const INVALID_RESOURCE = static_cast<ResourceId>(-1);
+
+	// Component describing a render pass.  Set it on an entity to register the pass.
+	struct Pass
+	{
+		Engine::eCustomPhase phase = Engine::SCENE_RENDER;
+		std::vector<ResourceId> reads;  // sampled as shader resources
+		std::vector<ResourceId> writes; // bound as render targets (in slot order)
+		ResourceId depth = INVALID_RESOURCE; // bound as depth target (read and written), optional
+
+		// If the pass is the first one to write a target during the frame, the target gets cleared with this value.
+		// Otherwise the target's content is undefined (passes that don't clear expect someone before them to have written it).
+		bool clear = false;
+		ClearValue clearValue = {};
+		// Same for the depth target
+		bool clearDepth = false;
+		ClearValue depthClearValue = {};
+	};
+
+	// What BACKBUFFER resolves to when drawing to a canvas.
+	// Windows point it to the acquired swapchain image, offscreen canvases own their target (registered with the graph).
+	struct CanvasTarget
+	{
+		RenderTarget* pCurRT = nullptr; // nullptr if there's nothing to draw to this frame
+		RenderTarget* pOffscreenRT = nullptr;
+		bool isAcquirePending = false; // window image gets acquired right before the first phase that writes it (see Window::Settings)
+		ResourceId resource = INVALID_RESOURCE;
+
+		// Scene target SCENE_COLOR resolves to.  Scene passes only render to the top left sceneWidth x sceneHeight area of it.
+		ResourceId sceneResource = INVALID_RESOURCE;
+		unsigned int sceneWidth = 0;
+		unsigned int sceneHeight = 0;
+	};
+
+	// Whether the canvas will have something to draw to this frame (passes that don't write BACKBUFFER can record before it's acquired)
+	inline bool HasTarget(CanvasTarget const& canvasTarget) { return canvasTarget.pCurRT || canvasTarget.isAcquirePending; }
+
+	class module : public LifeCycledModule
+	{
+	public:
+		module(flecs::world& ecs); // Ctor that loads the module
+		virtual void OnExit(flecs::world& ecs) override;
+	};
+
+	// Registers a render target with the graph so passes can read/write it.
+	// Persistent resources always have their content stored (eg. they are read back or sampled next frame).
+	ResourceId RegisterResource(flecs::world& ecs, RenderTarget* pRenderTarget, ResourceState const currentState, bool const persistent = false);
+	// Needs to be called when the render target of a registered resource is recreated (eg. resize)
+	void UpdateResource(flecs::world& ecs, ResourceId const id, RenderTarget* pRenderTarget, ResourceState const currentState);
+	void UnregisterResource(flecs::world& ecs, ResourceId const id);
+
+	// Starts recording a pass.  Binds the pass' targets (or merges with the currently bound ones) after issuing the required barriers.
+	// Returns false if the pass can't be recorded (eg. a target is missing).
+	bool BeginPass(flecs::world& ecs, Cmd* pCmd, flecs::entity const pass, CanvasTarget const& canvasTarget);
+	void EndPass(flecs::world& ecs, Cmd* pCmd, flecs::entity const pass);
+
+	// Unbinds whatever is bound.  Needs to be called before recording cmds that can't live inside a render pass (copies, compute, etc.)
+	void Flush(flecs::world& ecs, Cmd* pCmd);
+
+	// Moves a resource to a new state outside of passes (eg. to copy from it).  Returns false if the resource can't be resolved.
+	bool Transition(flecs::world& ecs, Cmd* pCmd, ResourceId const resource, CanvasTarget const& canvasTarget, ResourceState const newState);
+
+	// Flushes and transitions all backbuffers that were used to their present state
+	void EndFrame(flecs::world& ecs, Cmd* pCmd);
+}
@@ -2,10 +2,15 @@
 #include <SDL3/SDL_system.h>
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #include <ILog.h>
 
 #include "Engine.h"
+#include "Inputs.h"
 #include "RHI.h"
+#include "RenderGraph.h"
 #include "Window.h"
 
 #define DEBUG_PRESENTATION_CLEAR_COLOR_RED 0
@@ -26,7 +31,25 @@
 
 namespace Window
 {
-    struct MainWindowTag {}; // Tag to easily identify the main window entity
+    // Windows presented by a single frame (see Submit And Present)
+    static unsigned int const MAX_PRESENTING_WINDOWS = 8;
+
+    static DisplayMetrics QueryDisplayMetrics(SDL_Window* pWindow)
+    {
+        DisplayMetrics displayMetrics = {};
+
+        displayMetrics.displayId = SDL_GetDisplayForWindow(pWindow);
+        if (displayMetrics.displayId == 0)
+        {
+            LOGF(eERROR, "SDL_GetDisplayForWindow() failed.");
+        }
+        else
+        {
+            displayMetrics.contentScale = SDL_GetDisplayContentScale(displayMetrics.displayId);
+        }
+
+        return displayMetrics;
+    }
    
     void CreateWindowSwapchain(RHI::RHI* pRHI, SDLWindow& sdlWin, int const w, int const h)
     {
@@ -69,6 +92,73 @@ namespace Window
         ASSERT(sdlWin.pSwapChain);
     }
 
+    static void AcquireNextImg(flecs::world& ecs, RHI::RHI* pRHI, SDLWindow& sdlWin, RenderGraph::CanvasTarget& canvasTarget)
+    {
+        acquireNextImage(pRHI->pRenderer, sdlWin.pSwapChain, sdlWin.pImgAcqSemaphore, nullptr, &sdlWin.imageIndex);
+
+        sdlWin.pCurRT = (sdlWin.imageIndex == static_cast<unsigned int>(- 1)) ? nullptr : sdlWin.pSwapChain->ppRenderTargets[sdlWin.imageIndex];
+
+#if DEBUG_PRESENTATION_CLEAR_COLOR_RED // Clear cur RT a red color
+        if (sdlWin.pCurRT)
+        {
+            Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
+
+            // Late acquires can happen while the graph has a pass bound
+            RenderGraph::Flush(ecs, pCmd);
+
+            RenderTargetBarrier barriers[] = {
+                { sdlWin.pCurRT, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET },
+            };
+            cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, 1, barriers);
+
+            BindRenderTargetsDesc bindRenderTargets = {};
+            bindRenderTargets.mRenderTargetCount = 1;
+            bindRenderTargets.mRenderTargets[0] = { sdlWin.pCurRT, LOAD_ACTION_CLEAR };
+            cmdBindRenderTargets(pCmd, &bindRenderTargets);
+            cmdSetViewport(pCmd, 0.0f, 0.0f, static_cast<float>(sdlWin.pCurRT->mWidth), static_cast<float>(sdlWin.pCurRT->mHeight), 0.0f, 1.0f);
+            cmdSetScissor(pCmd, 0, 0, sdlWin.pCurRT->mWidth, sdlWin.pCurRT->mHeight);
+
+            cmdBindRenderTargets(pCmd, nullptr);
+
+            barriers[0] = { sdlWin.pCurRT, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_PRESENT };
+            cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, 1, barriers);
+        }
+#endif
+
+        // Passes draw to whatever image was acquired
+        canvasTarget.pCurRT = sdlWin.pCurRT;
+        canvasTarget.isAcquirePending = false;
+    }
+
+    void LatencyStats::AddSample(float const latencyMs)
+    {
+        if (samplesMs.size() < MAX_SAMPLES)
+            samplesMs.push_back(latencyMs);
+        else
+            samplesMs[nextSample] = latencyMs;
+
+        nextSample = (nextSample + 1) % MAX_SAMPLES;
+        totalSamples++;
+
+        if (totalSamples > PERCENTILES_INTERVAL && totalSamples % PERCENTILES_INTERVAL != 0)
+            return;
+
+        // Percentiles are selected in increasing order, each one only needs to look past the previous one
+        scratchMs.assign(samplesMs.begin(), samplesMs.end());
+        std::vector<float>::iterator first = scratchMs.begin();
+        auto percentile = [this, &first](float const p)
+            {
+                size_t const n = std::min(scratchMs.size() - 1, static_cast<size_t>(p * scratchMs.size()));
+                std::vector<float>::iterator const nth = scratchMs.begin() + n;
+                std::nth_element(first, nth, scratchMs.end());
+                first = nth;
+                return *nth;
+            };
+        p50Ms = percentile(0.5f);
+        p90Ms = percentile(0.9f);
+        p99Ms = percentile(0.99f);
+    }
+
     module::module(flecs::world& ecs)
     {
         ecs.import<Engine::module>();
@@ -76,6 +166,11 @@ namespace Window
 
         ecs.module<module>();
 
+        ecs.component<DisplayMetrics>();
+        ecs.component<Settings>();
+        ecs.add<Settings>();
+        ecs.component<LatencyStats>();
+        ecs.add<LatencyStats>();
         ecs.component<SDLWindow>()
             .on_add([](flecs::entity e, SDLWindow& sdlWin)
                 {
@@ -121,6 +216,11 @@ namespace Window
                     CreateWindowSwapchain(pRHI, sdlWin, bbwidth, bbheight);
 
                     addSemaphore(pRHI->pRenderer, &sdlWin.pImgAcqSemaphore);
+                    sdlWin.renderCompleteSemaphores.resize(pRHI->dataBufferCount, nullptr);
+                    for (Semaphore*& pSemaphore : sdlWin.renderCompleteSemaphores)
+                        addSemaphore(pRHI->pRenderer, &pSemaphore);
+
+                    // Hooks must not add or modify components, the canvas size and display metrics are published by "Window Metrics Publisher"
                 }
             )
             .on_remove([](flecs::entity e, SDLWindow& sdlWin)
@@ -133,6 +233,10 @@ namespace Window
                     removeSemaphore(pRHI->pRenderer, sdlWin.pImgAcqSemaphore);
                     sdlWin.pImgAcqSemaphore = nullptr;
 
+                    for (Semaphore* pSemaphore : sdlWin.renderCompleteSemaphores)
+                        removeSemaphore(pRHI->pRenderer, pSemaphore);
+                    sdlWin.renderCompleteSemaphores.clear();
+
                     removeSwapChain(pRHI->pRenderer, sdlWin.pSwapChain);
                     sdlWin.pSwapChain = nullptr;
 
@@ -145,6 +249,11 @@ namespace Window
             .event(flecs::OnSet)
             .each([](flecs::iter& it, size_t i, Engine::Canvas& canvas)
                 {
+                    // Offscreen canvases are handled by the render graph
+                    if (canvas.offscreen || it.entity(i).has<SDLWindow>())
+                        return;
+
+                    it.entity(i).add<RenderGraph::CanvasTarget>();
                     it.entity(i).add<SDLWindow>();
 
                     if (it.world().count<MainWindowTag>() == 0)
@@ -155,122 +264,223 @@ namespace Window
                 }
             );
        
+        // Runs once per new window.  Later size changes come from SDL events, the canvas needs to match the initial swapchain first.
+        auto windowMetricsPublisher = ecs.system<Engine::Canvas const, Window::SDLWindow const>("Window Metrics Publisher")
+            .without<DisplayMetrics>()
+            .kind(flecs::OnLoad)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+                {
+                    if (!sdlWin.pWindow || !sdlWin.pSwapChain)
+                        return;
+
+                    Engine::Canvas newCanvas = canvas;
+                    newCanvas.width = sdlWin.pSwapChain->ppRenderTargets[0]->mWidth;
+                    newCanvas.height = sdlWin.pSwapChain->ppRenderTargets[0]->mHeight;
+                    if (newCanvas.width != canvas.width || newCanvas.height != canvas.height)
+                        it.entity(i).set<Engine::Canvas>(newCanvas);
+
+                    it.entity(i).set<DisplayMetrics>(QueryDisplayMetrics(sdlWin.pWindow));
+                }
+            );
+
         auto swapchainResizer = ecs.system<Engine::Canvas, Window::SDLWindow>("Swapchain Resizer")
             .kind(flecs::OnLoad)
             .each([](flecs::iter& it, size_t i, Engine::Canvas& canvas, Window::SDLWindow& sdlWin)
                 {
-                    int bbwidth, bbheight;
-                    SDL_GetWindowSizeInPixels(sdlWin.pWindow, &bbwidth, &bbheight);
+                    if (!sdlWin.isResizePending)
+                        return;
 
-                    if ((canvas.width != bbwidth) ||
-                        (canvas.height != bbheight))
-                    {
-                        LOGF(eDEBUG, "Window was resized to %ix%i", bbwidth, bbheight);
+                    auto pRHI = it.world().has<RHI::RHI>() ? it.world().get_mut<RHI::RHI>() : nullptr;
+                    if (!pRHI)
+                        return;
 
-                        auto pRHI = it.world().get_mut<RHI::RHI>();
-                        if (pRHI)
-                        {
-                            waitQueueIdle(pRHI->pGfxQueue);
+                    // Coalesce bursts (eg. drag-resizing): the size needs to be stable for a frame.  Meanwhile, frames keep being presented
+                    // to the old swapchain (the compositor stretches them) so the window doesn't freeze while it's being dragged.
+                    if (pRHI->frameCount < sdlWin.resizeEventFrame + 2)
+                        return;
 
-                            removeSwapChain(pRHI->pRenderer, sdlWin.pSwapChain);
-                            sdlWin.pSwapChain = nullptr;
-                            CreateWindowSwapchain(pRHI, sdlWin, bbwidth, bbheight);
+                    sdlWin.isResizePending = false;
 
-                            // Update canvas size
-                            canvas.width = bbwidth;
-                            canvas.height = bbheight;
-                        }
+                    if (sdlWin.pendingWidth <= 0 || sdlWin.pendingHeight <= 0 ||
+                        (sdlWin.pSwapChain && canvas.width == static_cast<unsigned int>(sdlWin.pendingWidth) && canvas.height == static_cast<unsigned int>(sdlWin.pendingHeight)))
+                        return;
+
+                    LOGF(eDEBUG, "Window was resized to %ix%i", sdlWin.pendingWidth, sdlWin.pendingHeight);
+
+                    if (sdlWin.pSwapChain)
+                    {
+                        // Only the frames that presented to the old swapchain need to be done, not the whole queue.  The previous frame is
+                        // normally the last one, this waits on it once per settled resize instead of skipping presents.
+                        pRHI->WaitForFrame(sdlWin.lastPresentFrame);
+
+                        removeSwapChain(pRHI->pRenderer, sdlWin.pSwapChain);
+                        sdlWin.pSwapChain = nullptr;
+                        sdlWin.pCurRT = nullptr;
+                        CreateWindowSwapchain(pRHI, sdlWin, sdlWin.pendingWidth, sdlWin.pendingHeight);
                     }
+
+                    // Update canvas size
+                    canvas.width = sdlWin.pendingWidth;
+                    canvas.height = sdlWin.pendingHeight;
                 }
             );
 
-        auto acquireNextImg = ecs.system<Window::SDLWindow>("Acquire Next Img")
+        auto acquireNextImg = ecs.system<Window::SDLWindow, RenderGraph::CanvasTarget>("Acquire Next Img")
             .kind(flecs::PreUpdate)
-            .each([](flecs::iter& it, size_t i, Window::SDLWindow& sdlWin)
+            .each([](flecs::iter& it, size_t i, Window::SDLWindow& sdlWin, RenderGraph::CanvasTarget& canvasTarget)
                 {
-                    ASSERTMSG(i == 0, "More than one window not implemented.");
-
                     auto pRHI = it.world().get_mut<RHI::RHI>();
-                    if (pRHI && sdlWin.pSwapChain)
-                    {
-                        acquireNextImage(pRHI->pRenderer, sdlWin.pSwapChain, sdlWin.pImgAcqSemaphore, nullptr, &sdlWin.imageIndex);
+                    Settings const* pSettings = it.world().has<Settings>() ? it.world().get<Settings>() : nullptr;
 
-                        sdlWin.pCurRT = (sdlWin.imageIndex == static_cast<unsigned int>(- 1)) ? nullptr : sdlWin.pSwapChain->ppRenderTargets[sdlWin.imageIndex];
+                    // Nothing to draw to until acquired
+                    sdlWin.pCurRT = nullptr;
+                    canvasTarget.pCurRT = nullptr;
+                    canvasTarget.isAcquirePending = false;
 
-#if DEBUG_PRESENTATION_CLEAR_COLOR_RED // Clear cur RT a red color
-                        if (sdlWin.pCurRT)
-                        {
-                            Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
+                    // Pending resizes keep using the old swapchain until the replacement is created (see Swapchain Resizer)
+                    if (!pRHI || !sdlWin.pSwapChain)
+                        return;
 
-                            RenderTargetBarrier barriers[] = {
-                                { sdlWin.pCurRT, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET },
-                            };
-                            cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, 1, barriers);
+                    if (pSettings && pSettings->lateAcquire)
+                    {
+                        canvasTarget.isAcquirePending = true;
+                        return;
+                    }
 
-                            BindRenderTargetsDesc bindRenderTargets = {};
-                            bindRenderTargets.mRenderTargetCount = 1;
-                            bindRenderTargets.mRenderTargets[0] = { sdlWin.pCurRT, LOAD_ACTION_CLEAR };
-                            cmdBindRenderTargets(pCmd, &bindRenderTargets);
-                            cmdSetViewport(pCmd, 0.0f, 0.0f, static_cast<float>(sdlWin.pCurRT->mWidth), static_cast<float>(sdlWin.pCurRT->mHeight), 0.0f, 1.0f);
-                            cmdSetScissor(pCmd, 0, 0, sdlWin.pCurRT->mWidth, sdlWin.pCurRT->mHeight);
+                    auto world = it.world();
+                    AcquireNextImg(world, pRHI, sdlWin, canvasTarget);
+                }
+            );
 
-                            cmdBindRenderTargets(pCmd, nullptr);
+        // Late acquires have their own phases, right before the render phases that write the backbuffer.
+        // Canvases with a scene target (eg. dynamic resolution) record the scene offscreen and only acquire for the upscale.
+        auto lateAcquireNextImg = ecs.system<Window::SDLWindow, RenderGraph::CanvasTarget>("Late Acquire Next Img")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::ACQUIRE))
+            .each([](flecs::iter& it, size_t i, Window::SDLWindow& sdlWin, RenderGraph::CanvasTarget& canvasTarget)
+                {
+                    auto pRHI = it.world().get_mut<RHI::RHI>();
+                    if (!pRHI || !canvasTarget.isAcquirePending || canvasTarget.sceneResource != RenderGraph::INVALID_RESOURCE)
+                        return;
 
-                            barriers[0] = { sdlWin.pCurRT, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_PRESENT };
-                            cmdResourceBarrier(pCmd, 0, nullptr, 0, nullptr, 1, barriers);
-                        }
-#endif
+                    auto world = it.world();
+                    AcquireNextImg(world, pRHI, sdlWin, canvasTarget);
+                }
+            );
 
+        auto lateAcquireNextImgUpscale = ecs.system<Window::SDLWindow, RenderGraph::CanvasTarget>("Late Acquire Next Img For Upscale")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::UPSCALE_ACQUIRE))
+            .each([](flecs::iter& it, size_t i, Window::SDLWindow& sdlWin, RenderGraph::CanvasTarget& canvasTarget)
+                {
+                    auto pRHI = it.world().get_mut<RHI::RHI>();
+                    if (!pRHI || !canvasTarget.isAcquirePending)
+                        return;
 
-                    }
+                    auto world = it.world();
+                    AcquireNextImg(world, pRHI, sdlWin, canvasTarget);
                 }
             );
 
-        auto present = ecs.system<Window::SDLWindow>("Present")
+        // Every window's passes are recorded in the frame's cmd.  It gets submitted once, then all acquired swapchains are presented.
+        // Frames that don't present anything (offscreen canvases only, minimized windows, etc.) still need their cmds submitted.
+        flecs::query<Window::SDLWindow> windowQuery = ecs.query_builder<Window::SDLWindow>().cached().build();
+        auto submitAndPresent = ecs.system("Submit And Present")
             .kind(Engine::GetCustomPhaseEntity(ecs, Engine::PRESENT))
-            .each([](flecs::iter& it, size_t i, Window::SDLWindow const& sdlWin)
+            .run([windowQuery](flecs::iter& it)
                 {
-                    ASSERTMSG(i == 0, "More than one window not implemented.");
+                    auto pRHI = it.world().has<RHI::RHI>() ? it.world().get_mut<RHI::RHI>() : nullptr;
+                    if (!pRHI || pRHI->frameSubmitted)
+                        return;
 
-                    auto pRHI = it.world().get_mut<RHI::RHI>();
-                    if (pRHI && sdlWin.pCurRT)
-                    {
-                        Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
-                        endCmd(pCmd);
+                    // Fixed size so nothing gets allocated per frame
+                    SDLWindow* presentingWindows[MAX_PRESENTING_WINDOWS];
+                    unsigned int presentingWindowCount = 0;
+                    windowQuery.each([&presentingWindows, &presentingWindowCount](Window::SDLWindow& sdlWin)
+                        {
+                            if (!sdlWin.pCurRT || !sdlWin.pSwapChain)
+                                return;
 
-                        FlushResourceUpdateDesc flushUpdateDesc = {};
-                        flushUpdateDesc.mNodeIndex = 0;
-                        flushResourceUpdates(&flushUpdateDesc);
+                            ASSERTMSG(presentingWindowCount < MAX_PRESENTING_WINDOWS, "Too many windows presenting, raise MAX_PRESENTING_WINDOWS.");
+                            if (presentingWindowCount < MAX_PRESENTING_WINDOWS)
+                                presentingWindows[presentingWindowCount++] = &sdlWin;
+                        });
 
-                        Semaphore* waitSemaphores[2] = { flushUpdateDesc.pOutSubmittedSemaphore, sdlWin.pImgAcqSemaphore };
+                    Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
 
-                        QueueSubmitDesc submitDesc = {};
-                        submitDesc.mCmdCount = 1;
-                        submitDesc.mSignalSemaphoreCount = 1;
-                        submitDesc.mWaitSemaphoreCount = TF_ARRAY_COUNT(waitSemaphores);
-                        submitDesc.ppCmds = &pCmd;
-                        submitDesc.ppSignalSemaphores = &pRHI->curCmdRingElem.pSemaphore;
-                        submitDesc.ppWaitSemaphores = waitSemaphores;
-                        submitDesc.pSignalFence = pRHI->curCmdRingElem.pFence;
-                        queueSubmit(pRHI->pGfxQueue, &submitDesc);
+                    // Close any pending render pass and get the backbuffers ready for presentation
+                    auto world = it.world();
+                    RenderGraph::EndFrame(world, pCmd);
+
+                    endCmd(pCmd);
+
+                    FlushResourceUpdateDesc flushUpdateDesc = {};
+                    flushUpdateDesc.mNodeIndex = 0;
+                    flushResourceUpdates(&flushUpdateDesc);
+
+                    // Render complete semaphores are per frame in flight, the present of the previous frame might still be waiting on its own
+                    Semaphore* waitSemaphores[MAX_PRESENTING_WINDOWS + 1] = { flushUpdateDesc.pOutSubmittedSemaphore };
+                    Semaphore* signalSemaphores[MAX_PRESENTING_WINDOWS];
+                    for (unsigned int w = 0; w < presentingWindowCount; ++w)
+                    {
+                        waitSemaphores[w + 1] = presentingWindows[w]->pImgAcqSemaphore;
+                        signalSemaphores[w] = presentingWindows[w]->renderCompleteSemaphores[pRHI->frameIndex];
+                    }
+
+                    QueueSubmitDesc submitDesc = {};
+                    submitDesc.mCmdCount = 1;
+                    submitDesc.mSignalSemaphoreCount = presentingWindowCount;
+                    submitDesc.mWaitSemaphoreCount = presentingWindowCount + 1;
+                    submitDesc.ppCmds = &pCmd;
+                    submitDesc.ppSignalSemaphores = presentingWindowCount > 0 ? signalSemaphores : nullptr;
+                    submitDesc.ppWaitSemaphores = waitSemaphores;
+                    submitDesc.pSignalFence = pRHI->curCmdRingElem.pFence;
+                    queueSubmit(pRHI->pGfxQueue, &submitDesc);
+
+                    // The Forge presents one swapchain per call, they're all issued back to back after the submit
+                    for (unsigned int w = 0; w < presentingWindowCount; ++w)
+                    {
+                        SDLWindow* pSdlWin = presentingWindows[w];
 
                         QueuePresentDesc presentDesc = {};
-                        presentDesc.mIndex = (uint8_t)sdlWin.imageIndex;
+                        presentDesc.mIndex = (uint8_t)pSdlWin->imageIndex;
                         presentDesc.mWaitSemaphoreCount = 1;
-                        presentDesc.pSwapChain = sdlWin.pSwapChain;
-                        presentDesc.ppWaitSemaphores = &pRHI->curCmdRingElem.pSemaphore;
+                        presentDesc.pSwapChain = pSdlWin->pSwapChain;
+                        presentDesc.ppWaitSemaphores = &signalSemaphores[w];
                         presentDesc.mSubmitDone = true;
 
                         queuePresent(pRHI->pGfxQueue, &presentDesc);
+                        pSdlWin->lastPresentFrame = pRHI->frameCount;
+                    }
 
-                        pRHI->frameIndex = (pRHI->frameIndex + 1) % pRHI->dataBufferCount;
-
-                        it.world().modified<RHI::RHI>();
+                    // Sample the latency of frames that consumed inputs
+                    Inputs::InputSnapshot const* pSnapshot = it.world().has<Inputs::InputSnapshot>() ? it.world().get<Inputs::InputSnapshot>() : nullptr;
+                    LatencyStats* pLatencyStats = it.world().has<LatencyStats>() ? it.world().get_mut<LatencyStats>() : nullptr;
+                    if (pSnapshot && pSnapshot->newestEventNS && pLatencyStats && presentingWindowCount > 0)
+                    {
+                        Uint64 const nowNS = SDL_GetTicksNS();
+                        if (nowNS > pSnapshot->newestEventNS)
+                            pLatencyStats->AddSample(static_cast<float>(static_cast<double>(nowNS - pSnapshot->newestEventNS) / 1e6));
                     }
+
+                    pRHI->frameIndex = (pRHI->frameIndex + 1) % pRHI->dataBufferCount;
+                    pRHI->frameCount += 1;
+                    pRHI->frameSubmitted = true;
+
+                    it.world().modified<RHI::RHI>();
                 }
             );
     }
 
+    void module::OnExit(flecs::world& ecs)
+    {
+        LatencyStats const* pLatencyStats = ecs.has<LatencyStats>() ? ecs.get<LatencyStats>() : nullptr;
+        if (pLatencyStats && pLatencyStats->totalSamples > 0)
+        {
+            LOGF(eINFO, "Input to present latency over the last %u frames with inputs: p50 %.2fms, p90 %.2fms, p99 %.2fms (%llu samples in total).",
+                static_cast<unsigned int>(pLatencyStats->samplesMs.size()), pLatencyStats->p50Ms, pLatencyStats->p90Ms, pLatencyStats->p99Ms,
+                static_cast<unsigned long long>(pLatencyStats->totalSamples));
+        }
+    }
+
     void module::ProcessEvent(flecs::world& ecs, const SDL_Event* sdlEvent)
     {
         // Can't do anything without the RHI
@@ -280,6 +490,41 @@ namespace Window
 
         switch (sdlEvent->type)
         {
+            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+            {
+                // Only record the new size, the swapchain gets rebuilt once it stops changing (see Swapchain Resizer)
+                flecs::query<Window::SDLWindow> windowQuery = ecs.query_builder<Window::SDLWindow>().build();
+                windowQuery.each([pRHI, sdlEvent](flecs::iter& it, size_t i, Window::SDLWindow& sdlWin)
+                    {
+                        if (!sdlWin.pWindow || SDL_GetWindowID(sdlWin.pWindow) != sdlEvent->window.windowID)
+                            return;
+
+                        sdlWin.isResizePending = true;
+                        sdlWin.pendingWidth = sdlEvent->window.data1;
+                        sdlWin.pendingHeight = sdlEvent->window.data2;
+                        sdlWin.resizeEventFrame = pRHI->frameCount;
+                    });
+                break;
+            }
+            case SDL_EVENT_WINDOW_DISPLAY_SCALE_CHANGED:
+            case SDL_EVENT_WINDOW_DISPLAY_CHANGED:
+            {
+                // Only publish actual changes so observers don't rebuild anything for nothing
+                flecs::query<Window::SDLWindow const, Window::DisplayMetrics const> windowQuery = ecs.query_builder<Window::SDLWindow const, Window::DisplayMetrics const>().build();
+                windowQuery.each([sdlEvent](flecs::iter& it, size_t i, Window::SDLWindow const& sdlWin, Window::DisplayMetrics const& displayMetrics)
+                    {
+                        if (!sdlWin.pWindow || SDL_GetWindowID(sdlWin.pWindow) != sdlEvent->window.windowID)
+                            return;
+
+                        DisplayMetrics const newDisplayMetrics = QueryDisplayMetrics(sdlWin.pWindow);
+                        if (newDisplayMetrics.displayId != displayMetrics.displayId || newDisplayMetrics.contentScale != displayMetrics.contentScale)
+                        {
+                            LOGF(eDEBUG, "Window display changed (content scale: %f)", newDisplayMetrics.contentScale);
+                            it.entity(i).set<DisplayMetrics>(newDisplayMetrics);
+                        }
+                    });
+                break;
+            }
             case SDL_EVENT_WILL_ENTER_BACKGROUND:
             case SDL_EVENT_WINDOW_HIDDEN:
             case SDL_EVENT_WINDOW_MINIMIZED:
@@ -4,10 +4,15 @@
 #include <flecs.h>
 #include <IGraphics.h>
 #include <RingBuffer.h>
+#include <vector>
 #include "LifeCycledModule.h"
 
 namespace Window
 {
+	// Tag identifying the main window entity (the first window created).
+	// Features backed by a single context (UI, fonts, dynamic resolution) only run for it, other windows just get their passes drawn.
+	struct MainWindowTag {};
+
 	// An SDL window
 	struct SDLWindow
 	{
@@ -17,14 +22,59 @@ namespace Window
 #endif
 		SwapChain* pSwapChain = nullptr;
 		Semaphore* pImgAcqSemaphore = nullptr;
+		std::vector<Semaphore*> renderCompleteSemaphores; // one per frame in flight [RHI::frameIndex], signaled by the frame's submit and waited on by this window's present
 		unsigned int imageIndex = 0;
 		RenderTarget* pCurRT = nullptr;
+
+		// Resizes are driven by SDL events and coalesced: the swapchain is rebuilt once the size stopped changing
+		bool isResizePending = false;
+		int pendingWidth = 0;
+		int pendingHeight = 0;
+		uint64_t resizeEventFrame = 0; // frame the last size change was received on (see RHI::frameCount)
+		uint64_t lastPresentFrame = 0; // last frame that presented to the swapchain
+	};
+
+	// Metrics of the display a window is on.  Set in the OnLoad phase following the SDLWindow creation and updated from SDL display events only,
+	// observe OnSet to react to changes (eg. rebuilding fonts for a new content scale).
+	struct DisplayMetrics
+	{
+		SDL_DisplayID displayId = 0;
+		float contentScale = 1.f;
+	};
+
+	// Tweakables (singleton)
+	struct Settings
+	{
+		// Acquire swapchain images right before the first render phase that writes them instead of before the simulation.
+		// Acquiring blocks with vsync, this keeps it off the simulation and shortens the time between input sampling and present.
+		bool lateAcquire = true;
+	};
+
+	// Input to photon latency (singleton): time from the newest input event a frame consumed (see Inputs::InputSnapshot) to its present.
+	// The Forge doesn't report when presents reach the display, so samples stop at queuePresent returning.
+	struct LatencyStats
+	{
+		static unsigned int const MAX_SAMPLES = 256; // size of the rolling window
+		static unsigned int const PERCENTILES_INTERVAL = 16; // samples between percentile updates (once the first ones are in)
+
+		std::vector<float> samplesMs; // ring buffer of the latest samples
+		std::vector<float> scratchMs; // reused to select percentiles without allocating
+		unsigned int nextSample = 0;
+		uint64_t totalSamples = 0;
+
+		// Percentiles over the rolling window, updated every PERCENTILES_INTERVAL samples
+		float p50Ms = 0.f;
+		float p90Ms = 0.f;
+		float p99Ms = 0.f;
+
+		void AddSample(float const latencyMs);
 	};
 
 	class module : public LifeCycledModule
 	{
 	public:
 		module(flecs::world& ecs); // Ctor that loads the module
+		virtual void OnExit(flecs::world& ecs) override;
         virtual void ProcessEvent(flecs::world& ecs, const SDL_Event* sdlEvent) override;
 	};
 
@@ -0,0 +1,428 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <ILog.h>
+#include <IResourceLoader.h>
+
+#include "Low/Engine.h"
+#include "Low/RHI.h"
+#include "Low/RenderGraph.h"
+#include "Low/Window.h"
+#include "DynamicResolution.h"
+
+namespace DynamicResolution
+{
+    static uint64_t const NO_QUERY = static_cast<uint64_t>(-1);
+
+    // The dynamic resolution context (singleton)
+    struct Context
+    {
+        bool isInitialized = false;
+        bool hasFailed = false; // the upscale pass couldn't be created (eg. missing shaders), stays disabled
+
+        // Upscale pass (imgui's shaders draw a textured quad, which is all it takes)
+        Shader* pShader = nullptr;
+        Sampler* pSampler = nullptr;
+        RootSignature* pRootSignature = nullptr;
+        DescriptorSet* pDescriptorSetUniforms = nullptr; // one per frame in flight
+        DescriptorSet* pDescriptorSetTexture = nullptr;
+        std::vector<RHI::BufferRange> uniformBuffers; // quad projection, per frame in flight
+        RHI::BufferRange vertexBuffer;
+        RHI::BufferRange indexBuffer;
+        VertexLayout vertexLayout = {};
+        Pipeline* pPipeline = nullptr;
+        flecs::entity upscalePass;
+
+        // Scene target (sized for the max scale, only partially rendered to)
+        RenderTarget* pSceneRT = nullptr;
+        RenderGraph::ResourceId sceneResource = RenderGraph::INVALID_RESOURCE;
+
+        // Scene passes GPU timing (one begin/end pair per frame in flight)
+        QueryPool* pQueryPool = nullptr;
+        std::vector<uint64_t> queryFrames; // frame each query was recorded on (NO_QUERY if none is pending)
+        double timestampFrequency = 0.0;
+    };
+
+    // Vertex of the upscale quad, laid out like imgui's
+    struct QuadVertex
+    {
+        float x, y;
+        float u, v;
+        uint32_t color;
+    };
+
+    static bool AddUpscalePass(RHI::RHI const* pRHI, Window::SDLWindow const& sdlWin, Context& context)
+    {
+        // Resolves the scene target itself if it's multisampled (same sample count as the window)
+        char fragFileName[64] = {};
+        snprintf(fragFileName, sizeof(fragFileName), "imgui_SAMPLE_COUNT_%u.frag", static_cast<unsigned int>(sdlWin.pSwapChain->ppRenderTargets[0]->mSampleCount));
+
+        ShaderLoadDesc shaderDesc = {};
+        shaderDesc.mStages[0].pFileName = "imgui.vert";
+        shaderDesc.mStages[1].pFileName = fragFileName;
+        addShader(pRHI->pRenderer, &shaderDesc, &context.pShader);
+        if (!context.pShader)
+        {
+            LOGF(eERROR, "Could not load the upscale shaders, dynamic resolution stays disabled.");
+            return false;
+        }
+
+        SamplerDesc samplerDesc = { FILTER_LINEAR, FILTER_LINEAR, MIPMAP_MODE_NEAREST, ADDRESS_MODE_CLAMP_TO_EDGE, ADDRESS_MODE_CLAMP_TO_EDGE, ADDRESS_MODE_CLAMP_TO_EDGE };
+        addSampler(pRHI->pRenderer, &samplerDesc, &context.pSampler);
+
+        char const* samplerNames[] = { "uSampler" };
+        RootSignatureDesc rootDesc = {};
+        rootDesc.mShaderCount = 1;
+        rootDesc.ppShaders = &context.pShader;
+        rootDesc.mStaticSamplerCount = 1;
+        rootDesc.ppStaticSamplerNames = samplerNames;
+        rootDesc.ppStaticSamplers = &context.pSampler;
+        addRootSignature(pRHI->pRenderer, &rootDesc, &context.pRootSignature);
+
+        DescriptorSetDesc setDesc = { context.pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_BATCH, 1 };
+        addDescriptorSet(pRHI->pRenderer, &setDesc, &context.pDescriptorSetTexture);
+
+        // The projection maps the quad to the rendered portion of the scene target, which changes every frame
+        setDesc = { context.pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, pRHI->dataBufferCount };
+        addDescriptorSet(pRHI->pRenderer, &setDesc, &context.pDescriptorSetUniforms);
+        context.uniformBuffers.resize(pRHI->dataBufferCount);
+        for (uint32_t f = 0; f < pRHI->dataBufferCount; ++f)
+        {
+            context.uniformBuffers[f] = RHI::AddPooledBuffer(RHI::BUFFER_POOL_UNIFORMS, sizeof(float) * 16);
+
+            DescriptorDataRange range = { static_cast<uint32_t>(context.uniformBuffers[f].offset), static_cast<uint32_t>(context.uniformBuffers[f].size) };
+            DescriptorData params[1] = {};
+            params[0].pName = "uniformBlockVS";
+            params[0].ppBuffers = &context.uniformBuffers[f].pBuffer;
+            params[0].pRanges = &range;
+            updateDescriptorSet(pRHI->pRenderer, f, context.pDescriptorSetUniforms, 1, params);
+        }
+
+        // Unit quad covering the whole scene target, the projection does the rest
+        QuadVertex const vertices[4] = {
+            { 0.f, 0.f, 0.f, 0.f, 0xFFFFFFFF },
+            { 1.f, 0.f, 1.f, 0.f, 0xFFFFFFFF },
+            { 1.f, 1.f, 1.f, 1.f, 0xFFFFFFFF },
+            { 0.f, 1.f, 0.f, 1.f, 0xFFFFFFFF } };
+        uint16_t const indices[6] = { 0, 1, 2, 0, 2, 3 };
+        context.vertexBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_GEOMETRY, sizeof(vertices), vertices);
+        context.indexBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_GEOMETRY, sizeof(indices), indices);
+
+        VertexLayout& vertexLayout = context.vertexLayout;
+        vertexLayout.mBindingCount = 1;
+        vertexLayout.mBindings[0].mStride = sizeof(QuadVertex);
+        vertexLayout.mAttribCount = 3;
+        vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+        vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32_SFLOAT;
+        vertexLayout.mAttribs[0].mLocation = 0;
+        vertexLayout.mAttribs[0].mOffset = offsetof(QuadVertex, x);
+        vertexLayout.mAttribs[1].mSemantic = SEMANTIC_TEXCOORD0;
+        vertexLayout.mAttribs[1].mFormat = TinyImageFormat_R32G32_SFLOAT;
+        vertexLayout.mAttribs[1].mLocation = 1;
+        vertexLayout.mAttribs[1].mOffset = offsetof(QuadVertex, u);
+        vertexLayout.mAttribs[2].mSemantic = SEMANTIC_COLOR;
+        vertexLayout.mAttribs[2].mFormat = TinyImageFormat_R8G8B8A8_UNORM;
+        vertexLayout.mAttribs[2].mLocation = 2;
+        vertexLayout.mAttribs[2].mOffset = offsetof(QuadVertex, color);
+
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+        DepthStateDesc depthStateDesc = {};
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+        GraphicsPipelineDesc& pipelineSettings = desc.mGraphicsDesc;
+        pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineSettings.mRenderTargetCount = 1;
+        pipelineSettings.pDepthState = &depthStateDesc;
+        pipelineSettings.pColorFormats = &sdlWin.pSwapChain->ppRenderTargets[0]->mFormat;
+        pipelineSettings.mSampleCount = sdlWin.pSwapChain->ppRenderTargets[0]->mSampleCount;
+        pipelineSettings.mSampleQuality = sdlWin.pSwapChain->ppRenderTargets[0]->mSampleQuality;
+        pipelineSettings.pRootSignature = context.pRootSignature;
+        pipelineSettings.pShaderProgram = context.pShader;
+        pipelineSettings.pVertexLayout = &context.vertexLayout;
+        pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+        addPipeline(pRHI->pRenderer, &desc, &context.pPipeline);
+
+        QueryPoolDesc queryPoolDesc = {};
+        queryPoolDesc.mType = QUERY_TYPE_TIMESTAMP;
+        queryPoolDesc.mQueryCount = pRHI->dataBufferCount;
+        addQueryPool(pRHI->pRenderer, &queryPoolDesc, &context.pQueryPool);
+        context.queryFrames.assign(pRHI->dataBufferCount, NO_QUERY);
+
+        getTimestampFrequency(pRHI->pGfxQueue, &context.timestampFrequency);
+
+        waitForAllResourceLoads();
+        return true;
+    }
+
+    static void RemoveSceneTarget(flecs::world& ecs, RHI::RHI const* pRHI, Context& context)
+    {
+        if (!context.pSceneRT)
+            return;
+
+        // Only happens on resize, toggle or exit
+        waitQueueIdle(pRHI->pGfxQueue);
+
+        RenderGraph::UnregisterResource(ecs, context.sceneResource);
+        removeRenderTarget(pRHI->pRenderer, context.pSceneRT);
+
+        context.pSceneRT = nullptr;
+        context.sceneResource = RenderGraph::INVALID_RESOURCE;
+    }
+
+    static void AddSceneTarget(flecs::world& ecs, RHI::RHI const* pRHI, RenderTarget const* pBackbuffer, unsigned int const width, unsigned int const height, Context& context)
+    {
+        RenderTargetDesc rtDesc = {};
+        rtDesc.mArraySize = 1;
+        rtDesc.mDepth = 1;
+        rtDesc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+        rtDesc.mFormat = pBackbuffer->mFormat; // same as the window so scene pipelines don't care where they draw
+        rtDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        rtDesc.mWidth = width;
+        rtDesc.mHeight = height;
+        rtDesc.mSampleCount = pBackbuffer->mSampleCount;
+        rtDesc.mSampleQuality = pBackbuffer->mSampleQuality;
+        rtDesc.pName = "Dynamic Resolution Scene";
+        addRenderTarget(pRHI->pRenderer, &rtDesc, &context.pSceneRT);
+        ASSERT(context.pSceneRT);
+
+        context.sceneResource = RenderGraph::RegisterResource(ecs, context.pSceneRT, RESOURCE_STATE_SHADER_RESOURCE);
+
+        DescriptorData params[1] = {};
+        params[0].pName = "uTex";
+        params[0].ppTextures = &context.pSceneRT->pTexture;
+        updateDescriptorSet(pRHI->pRenderer, 0, context.pDescriptorSetTexture, 1, params);
+    }
+
+    static void UpdateScale(Settings const& settings, float const measuredMs, Stats& stats)
+    {
+        // Smooth out the noise of individual frames
+        stats.sceneGpuMs = (stats.sceneGpuMs > 0.f) ? (stats.sceneGpuMs + (measuredMs - stats.sceneGpuMs) * 0.1f) : measuredMs;
+
+        // Only react outside of a band around the budget so the resolution doesn't oscillate
+        float const budget = std::max(settings.targetSceneGpuMs, 0.1f);
+        if (stats.sceneGpuMs > budget || stats.sceneGpuMs < budget * 0.8f)
+        {
+            // GPU time is roughly proportional to the pixel count, which grows with the square of the scale
+            float const desiredScale = stats.scale * std::sqrt(budget / std::max(stats.sceneGpuMs, 0.01f));
+            stats.scale += (desiredScale - stats.scale) * 0.1f;
+        }
+
+        stats.scale = std::clamp(stats.scale, settings.minScale, settings.maxScale);
+    }
+
+    module::module(flecs::world& ecs)
+    {
+        ecs.import<Engine::module>();
+        ecs.import<RHI::module>();
+        ecs.import<RenderGraph::module>();
+        ecs.import<Window::module>();
+
+        ecs.module<module>();
+
+        ecs.component<Context>();
+        ecs.component<Settings>();
+        ecs.component<Stats>();
+
+        // Create the singletons
+        Context context = {};
+        ecs.set<Context>(context);
+        ecs.set<Settings>({});
+        ecs.set<Stats>({});
+
+        // A single scene target is managed, only the main window gets dynamic resolution.
+        // Nothing is created (and scene passes draw straight to the window) until it gets enabled.
+        ecs.system<Engine::Canvas, Window::SDLWindow>("Init Dynamic Resolution")
+            .with<Window::MainWindowTag>()
+            .kind(flecs::OnLoad)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+                {
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+                    Settings const* pSettings = it.world().has<Settings>() ? it.world().get<Settings>() : nullptr;
+
+                    if (!pContext || !pRHI || !pSettings || !pSettings->enabled || pContext->isInitialized || pContext->hasFailed || !sdlWin.pSwapChain)
+                        return;
+
+                    if (!AddUpscalePass(pRHI, sdlWin, *pContext))
+                    {
+                        pContext->hasFailed = true;
+                        return;
+                    }
+
+                    // Samples the scene target and writes every pixel of the window, so no clear needed
+                    RenderGraph::Pass upscalePass = {};
+                    upscalePass.phase = Engine::UPSCALE;
+                    upscalePass.reads = { RenderGraph::SCENE_COLOR };
+                    upscalePass.writes = { RenderGraph::BACKBUFFER };
+                    pContext->upscalePass = it.world().entity("UpscalePass").set<RenderGraph::Pass>(upscalePass);
+
+                    pContext->isInitialized = true;
+                }
+            );
+
+        // Picks this frame's scene resolution from the timings of the frame that last used the same cmd ring element
+        ecs.system<Engine::Canvas, Window::SDLWindow, RenderGraph::CanvasTarget>("Scene Resolution Updater")
+            .with<Window::MainWindowTag>()
+            .kind(flecs::PreUpdate)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin, RenderGraph::CanvasTarget& canvasTarget)
+                {
+                    auto world = it.world();
+                    Context* pContext = world.has<Context>() ? world.get_mut<Context>() : nullptr;
+                    RHI::RHI const* pRHI = world.has<RHI::RHI>() ? world.get<RHI::RHI>() : nullptr;
+                    Settings const* pSettings = world.has<Settings>() ? world.get<Settings>() : nullptr;
+                    Stats* pStats = world.has<Stats>() ? world.get_mut<Stats>() : nullptr;
+
+                    if (!pContext || !pContext->isInitialized || !pRHI || !pSettings || !pStats)
+                        return;
+
+                    // The query slot is about to be reused, read it back if the frame that recorded it is done
+                    uint64_t const queryFrame = pContext->queryFrames[pRHI->frameIndex];
+                    if (queryFrame != NO_QUERY && pRHI->IsFrameComplete(queryFrame))
+                    {
+                        QueryData queryData = {};
+                        getQueryData(pRHI->pRenderer, pContext->pQueryPool, pRHI->frameIndex, &queryData);
+                        if (queryData.mValid && pContext->timestampFrequency > 0.0)
+                        {
+                            double const ticks = static_cast<double>(queryData.mEndTimestamp - queryData.mBeginTimestamp);
+                            UpdateScale(*pSettings, static_cast<float>(ticks / pContext->timestampFrequency * 1000.0), *pStats);
+                        }
+                        pContext->queryFrames[pRHI->frameIndex] = NO_QUERY;
+                    }
+
+                    if (!pSettings->enabled || !sdlWin.pSwapChain)
+                    {
+                        if (!pSettings->enabled)
+                            RemoveSceneTarget(world, pRHI, *pContext);
+
+                        canvasTarget.sceneResource = RenderGraph::INVALID_RESOURCE;
+                        return;
+                    }
+
+                    // The scene target is sized for the max scale so scaling doesn't need to recreate it
+                    // (all swapchain images share the same size and format, the one for this frame might not be acquired yet)
+                    RenderTarget const* pBackbuffer = sdlWin.pSwapChain->ppRenderTargets[0];
+                    float const maxScale = std::max(pSettings->maxScale, pSettings->minScale);
+                    unsigned int const rtWidth = std::max(1u, static_cast<unsigned int>(std::ceil(pBackbuffer->mWidth * maxScale)));
+                    unsigned int const rtHeight = std::max(1u, static_cast<unsigned int>(std::ceil(pBackbuffer->mHeight * maxScale)));
+
+                    if (!pContext->pSceneRT || pContext->pSceneRT->mWidth != rtWidth || pContext->pSceneRT->mHeight != rtHeight)
+                    {
+                        RemoveSceneTarget(world, pRHI, *pContext);
+                        AddSceneTarget(world, pRHI, pBackbuffer, rtWidth, rtHeight, *pContext);
+                    }
+
+                    pStats->scale = std::clamp(pStats->scale, pSettings->minScale, maxScale);
+                    pStats->sceneWidth = std::clamp(static_cast<unsigned int>(std::lround(pBackbuffer->mWidth * pStats->scale)), 1u, rtWidth);
+                    pStats->sceneHeight = std::clamp(static_cast<unsigned int>(std::lround(pBackbuffer->mHeight * pStats->scale)), 1u, rtHeight);
+
+                    canvasTarget.sceneResource = pContext->sceneResource;
+                    canvasTarget.sceneWidth = pStats->sceneWidth;
+                    canvasTarget.sceneHeight = pStats->sceneHeight;
+                }
+            );
+
+        // Declared before any app module is imported so it's the first system of the scene phase
+        ecs.system<RenderGraph::CanvasTarget const>("Begin Scene Timing")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::SCENE_RENDER))
+            .each([](flecs::iter& it, size_t i, RenderGraph::CanvasTarget const& canvasTarget)
+                {
+                    Context const* pContext = it.world().has<Context>() ? it.world().get<Context>() : nullptr;
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+
+                    if (!pContext || !pContext->isInitialized || !pRHI || canvasTarget.sceneResource == RenderGraph::INVALID_RESOURCE)
+                        return;
+
+                    Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
+                    ASSERT(pCmd);
+
+                    QueryDesc queryDesc = { pRHI->frameIndex };
+                    cmdResetQuery(pCmd, pContext->pQueryPool, pRHI->frameIndex, 1);
+                    cmdBeginQuery(pCmd, pContext->pQueryPool, &queryDesc);
+                }
+            );
+
+        ecs.system<RenderGraph::CanvasTarget const>("Upscale Scene")
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::UPSCALE))
+            .each([](flecs::iter& it, size_t i, RenderGraph::CanvasTarget const& canvasTarget)
+                {
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+
+                    if (!pContext || !pContext->isInitialized || !pRHI || canvasTarget.sceneResource == RenderGraph::INVALID_RESOURCE || !canvasTarget.pCurRT)
+                        return;
+
+                    Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
+                    ASSERT(pCmd);
+
+                    auto world = it.world();
+
+                    // Scene passes are done, end the timing outside of any render pass
+                    RenderGraph::Flush(world, pCmd);
+                    QueryDesc queryDesc = { pRHI->frameIndex };
+                    cmdEndQuery(pCmd, pContext->pQueryPool, &queryDesc);
+                    cmdResolveQuery(pCmd, pContext->pQueryPool, pRHI->frameIndex, 1);
+                    pContext->queryFrames[pRHI->frameIndex] = pRHI->frameCount;
+
+                    if (RenderGraph::BeginPass(world, pCmd, pContext->upscalePass, canvasTarget))
+                    {
+                        cmdBeginDebugMarker(pCmd, 1, 0, 1, "DynamicResolution::Upscale");
+
+                        // Stretches the quad so only the rendered portion of the scene target covers the window (the rest gets clipped)
+                        float const scaleX = pContext->pSceneRT->mWidth / static_cast<float>(canvasTarget.sceneWidth);
+                        float const scaleY = pContext->pSceneRT->mHeight / static_cast<float>(canvasTarget.sceneHeight);
+                        float const projection[16] = { 2.f * scaleX, 0.f, 0.f, 0.f, 0.f, -2.f * scaleY, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, -1.f, 1.f, 0.f, 1.f };
+
+                        RHI::BufferRange const& uniformBuffer = pContext->uniformBuffers[pRHI->frameIndex];
+                        BufferUpdateDesc uniformUpdate = { uniformBuffer.pBuffer, uniformBuffer.offset, sizeof(projection) };
+                        beginUpdateResource(&uniformUpdate);
+                        memcpy(uniformUpdate.pMappedData, projection, sizeof(projection));
+                        endUpdateResource(&uniformUpdate);
+
+                        cmdBindPipeline(pCmd, pContext->pPipeline);
+                        cmdBindDescriptorSet(pCmd, pRHI->frameIndex, pContext->pDescriptorSetUniforms);
+                        cmdBindDescriptorSet(pCmd, 0, pContext->pDescriptorSetTexture);
+                        cmdBindVertexBuffer(pCmd, 1, &pContext->vertexBuffer.pBuffer, &pContext->vertexLayout.mBindings[0].mStride, &pContext->vertexBuffer.offset);
+                        cmdBindIndexBuffer(pCmd, pContext->indexBuffer.pBuffer, INDEX_TYPE_UINT16, pContext->indexBuffer.offset);
+                        cmdDrawIndexed(pCmd, 6, 0, 0);
+
+                        cmdEndDebugMarker(pCmd);
+
+                        RenderGraph::EndPass(world, pCmd, pContext->upscalePass);
+                    }
+                }
+            );
+    }
+
+    void module::OnExit(flecs::world& ecs)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        RHI::RHI const* pRHI = ecs.has<RHI::RHI>() ? ecs.get<RHI::RHI>() : nullptr;
+
+        if (!pContext || !pRHI || !pContext->isInitialized)
+            return;
+
+        waitQueueIdle(pRHI->pGfxQueue);
+
+        RemoveSceneTarget(ecs, pRHI, *pContext);
+        removeQueryPool(pRHI->pRenderer, pContext->pQueryPool);
+        removePipeline(pRHI->pRenderer, pContext->pPipeline);
+        RHI::RemovePooledBuffer(pContext->vertexBuffer);
+        RHI::RemovePooledBuffer(pContext->indexBuffer);
+        for (RHI::BufferRange& uniformBuffer : pContext->uniformBuffers)
+            RHI::RemovePooledBuffer(uniformBuffer);
+        pContext->uniformBuffers.clear();
+        removeDescriptorSet(pRHI->pRenderer, pContext->pDescriptorSetTexture);
+        removeDescriptorSet(pRHI->pRenderer, pContext->pDescriptorSetUniforms);
+        removeRootSignature(pRHI->pRenderer, pContext->pRootSignature);
+        removeSampler(pRHI->pRenderer, pContext->pSampler);
+        removeShader(pRHI->pRenderer, pContext->pShader);
+
+        pContext->isInitialized = false;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <flecs.h>
+#include "LifeCycledModule.h"
+
+// Implemented features:
+// - [X] Scene passes render to a scene target (RenderGraph::SCENE_COLOR) instead of the window
+// - [X] Scene resolution scales between bounds based on the measured GPU time of the scene passes
+// - [X] Scene target gets upscaled into the window before fonts and UI (which stay at native resolution)
+
+namespace DynamicResolution
+{
+	// Tweakables (singleton)
+	struct Settings
+	{
+		bool enabled = true; // the upscale pass is created the first time it gets enabled, turning it off makes scene passes draw straight to the window
+		float minScale = 0.5f; // of the native resolution (per axis)
+		float maxScale = 1.f;
+		float targetSceneGpuMs = 10.f; // GPU time budget for the scene passes (leaves room for fonts, UI and presentation)
+	};
+
+	// Current state (singleton)
+	struct Stats
+	{
+		float scale = 1.f;
+		float sceneGpuMs = 0.f; // smoothed
+		unsigned int sceneWidth = 0;
+		unsigned int sceneHeight = 0;
+	};
+
+	class module : public LifeCycledModule
+	{
+	public:
+		module(flecs::world& ecs); // Ctor that loads the module
+		virtual void OnExit(flecs::world& ecs) override;
+	};
+}
@@ -1,191 +1,2103 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <compare>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <imgui.h>
+#include <imgui_internal.h> // ImTextCharFromUtf8
+
+// stb_truetype as bundled with imgui rasterizes blurred glyphs (static, imgui has its own copy)
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <imstb_truetype.h>
 
 #include <ILog.h>
-#include <IFont.h>
+#include <IFileSystem.h>
+#include <IGraphics.h>
+#include <IResourceLoader.h>
 
 #include <SDL3/SDL_video.h>
 
-#include "Low/Engine.h"
-#include "Low/RHI.h"
-#include "Low/Window.h"
-#include "FontRendering.h"
+#include "Low/Engine.h"
+#include "Low/RHI.h"
+#include "Low/RenderGraph.h"
+#include "Low/Window.h"
+#include "FontRendering.h"
+
+namespace FontRendering
+{
+    // Font files not used for that long get released (checked every FONT_USAGE_CHECK_FRAMES), along with the least recently used ones while
+    // loaded files take more than FONT_FILES_MEMORY_BUDGET.  The default font is never released.
+    static float const FONT_RELEASE_SECONDS = 30.f;
+    static size_t const FONT_FILES_MEMORY_BUDGET = 16u * 1024u * 1024u;
+    static uint64_t const FONT_USAGE_CHECK_FRAMES = 60;
+
+    // Max glyphs drawn per frame (quads share a static index buffer, 16 bits indices)
+    static uint32_t const MAX_GLYPHS = 16u * 1024u;
+
+    // Glyph atlas pages, fonts spill over to another page once one gets bigger than MAX_ATLAS_PAGE_SIZE
+    static uint32_t const MAX_ATLAS_PAGES = 8;
+    static int const MAX_ATLAS_PAGE_SIZE = 2048;
+
+    // Blurred bitmap glyphs are rasterized with their blur (its radius in pixels).  Each radius is a font of its own in the atlas.
+    static unsigned int const MAX_BLUR_RADIUS = 16;
+
+    // Max world text labels and glyphs drawn per frame, and the pixel size world text gets rasterized at (it's then scaled to its world size).
+    // Each label has its own constant buffer view in the uniform buffer, WORLD_UNIFORM_STRIDE apart (D3D12 needs them 256 bytes aligned).
+    static uint32_t const MAX_WORLD_LABELS = 1024;
+    static uint32_t const MAX_WORLD_GLYPHS = 16u * 1024u;
+    static uint32_t const WORLD_UNIFORM_STRIDE = 256;
+    static unsigned int const WORLD_TEXT_PIXEL_SIZE = 32;
+    static TinyImageFormat const WORLD_TEXT_DEPTH_FORMAT = TinyImageFormat_D32_SFLOAT;
+
+    // Vertex of a glyph quad.  Same layout as imgui's, its shaders are used to draw them.
+    struct GlyphVertex
+    {
+        float x = 0.f;
+        float y = 0.f;
+        float u = 0.f;
+        float v = 0.f;
+        uint32_t color = 0;
+    };
+
+    // Interned strings behind TextHandle (process wide, see TextPool::Get).
+    // Entries live in chunks that are never moved, each published once with its text (immutable until freed): reading a handle's text doesn't
+    // lock.  Handles hold a reference to their entry, strings are freed along with the last handle and their ids reused.
+    class TextPool
+    {
+    public:
+        // Numbers below this get their handle cached by value (eg. scores, counters), their strings are kept once used
+        static int64_t const SMALL_NUMBER_COUNT = 1024;
+
+        static TextPool& Get()
+        {
+            // Never destroyed, handles could be released by static destructors
+            static TextPool* pPool = new TextPool();
+            return *pPool;
+        }
+
+        // Returns the id of the string with a reference added for the caller
+        uint32_t Intern(std::string_view const text)
+        {
+            if (text.empty())
+                return 0;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto const it = ids.find(text);
+            if (it != ids.end())
+            {
+                // Could be at 0 with its release waiting for the lock, it won't be freed then (see Release)
+                GetEntry(it->second).refCount.fetch_add(1, std::memory_order_relaxed);
+                return it->second;
+            }
+
+            uint32_t id = 0;
+            if (!freeIds.empty())
+            {
+                id = freeIds.back();
+                freeIds.pop_back();
+            }
+            else
+            {
+                if (nextId == MAX_CHUNKS * CHUNK_SIZE)
+                {
+                    LOGF(eERROR, "Text pool is full (%u strings), text is dropped.", nextId);
+                    return 0;
+                }
+
+                id = nextId++;
+                if (!chunks[id / CHUNK_SIZE].load(std::memory_order_relaxed))
+                    chunks[id / CHUNK_SIZE].store(new Entry[CHUNK_SIZE], std::memory_order_release);
+            }
+
+            char* pText = new char[text.size() + 1];
+            memcpy(pText, text.data(), text.size());
+            pText[text.size()] = '\0';
+
+            Entry& entry = GetEntry(id);
+            entry.size = static_cast<uint32_t>(text.size());
+            entry.refCount.store(1, std::memory_order_relaxed);
+            entry.pText.store(pText, std::memory_order_release);
+            ids.emplace(std::string_view(pText, text.size()), id);
+            return id;
+        }
+
+        // Only for ids the caller holds a reference to
+        std::string_view View(uint32_t const id) const
+        {
+            Entry const& entry = GetEntry(id);
+            return std::string_view(entry.pText.load(std::memory_order_acquire), entry.size);
+        }
+
+        void AddRef(uint32_t const id)
+        {
+            if (id != 0)
+                GetEntry(id).refCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void Release(uint32_t const id)
+        {
+            if (id == 0 || GetEntry(id).refCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+
+            // Interned again (or already freed by a release that got the lock first) meanwhile, nothing to do
+            std::lock_guard<std::mutex> lock(mutex);
+            Entry& entry = GetEntry(id);
+            char const* pText = entry.pText.load(std::memory_order_relaxed);
+            if (!pText || entry.refCount.load(std::memory_order_acquire) != 0)
+                return;
+
+            ids.erase(std::string_view(pText, entry.size));
+            entry.pText.store(nullptr, std::memory_order_relaxed);
+            delete[] pText;
+            freeIds.push_back(id);
+        }
+
+        std::atomic<uint32_t> smallNumbers[SMALL_NUMBER_COUNT] = {}; // 0 until the number's first use, holds a reference to its string
+
+    private:
+        static constexpr uint32_t CHUNK_SIZE = 4096;
+        static constexpr uint32_t MAX_CHUNKS = 256;
+
+        struct Entry
+        {
+            std::atomic<char const*> pText = nullptr; // null terminated, published last
+            uint32_t size = 0;
+            std::atomic<uint32_t> refCount = 0;
+        };
+
+        TextPool()
+        {
+            // Id 0 is the empty string, never referenced
+            chunks[0].store(new Entry[CHUNK_SIZE], std::memory_order_relaxed);
+            GetEntry(0).pText.store("", std::memory_order_relaxed);
+            nextId = 1;
+        }
+
+        Entry& GetEntry(uint32_t const id) const
+        {
+            return chunks[id / CHUNK_SIZE].load(std::memory_order_acquire)[id % CHUNK_SIZE];
+        }
+
+        std::atomic<Entry*> chunks[MAX_CHUNKS] = {};
+
+        // Interning state
+        std::mutex mutex;
+        uint32_t nextId = 0;
+        std::vector<uint32_t> freeIds;
+        std::unordered_map<std::string_view, uint32_t> ids;
+    };
+
+    // Root constants of fontstash's shaders, set per world text label
+    struct WorldTextConstants
+    {
+        float color[4];
+        float scaleBias[2]; // glyph positions are scaled by it, the label's transform already converts font pixels to world units
+    };
+
+    // Glyph quads a FontText was laid out to (added along with FontText).
+    // Quads are relative to the text's top left corner and colorless: moving or recoloring text doesn't need a new layout.
+    // Until text can be laid out again (eg. its new font size isn't rasterized yet), the previous quads keep being drawn as long as their page
+    // wasn't rebuilt.
+    struct GlyphLayout
+    {
+        // What the quads were laid out from
+        TextHandle text;
+        FontId font = DEFAULT_FONT;
+        float fontSize = 0.f;
+        float fontSpacing = 0.f;
+        float fontBlur = 0.f;
+        uint64_t atlasVersion = 0; // quads hold atlas UVs, they're redone when the atlas gets rebuilt
+        uint32_t page = 0; // atlas page the quads sample
+        uint64_t pageTextureVersion = 0; // version of the page's texture the UVs are for (see AtlasPage::textureVersion)
+
+        std::vector<GlyphVertex> vertices; // 4 per glyph
+        // Bounds of the quads, for culling without going through them
+        float minX = 0.f;
+        float minY = 0.f;
+        float maxX = 0.f;
+        float maxY = 0.f;
+
+        // Text is a FontText or a WorldText
+        template<typename Text>
+        bool IsUpToDate(Text const& source, uint64_t const curAtlasVersion) const
+        {
+            return atlasVersion == curAtlasVersion && font == source.font && fontSize == source.fontSize &&
+                fontSpacing == source.fontSpacing && fontBlur == source.fontBlur && text == source.text;
+        }
+    };
+
+    // Glyph quads a WorldText was laid out to (added along with WorldText).
+    // Quads stay in font pixels, centered on the label's origin and sitting on it.  They're scaled to world units when drawn.
+    struct WorldGlyphLayout : GlyphLayout
+    {
+        float lineHeight = 0.f; // font pixels a line spans (WorldText::fontSize in world units)
+    };
+
+    // Bounded LRU cache of text measurements.
+    // Entries live in a fixed array linked by indices (most recently used first) so the cache can be copied along with the context.
+    class MeasureCache
+    {
+    public:
+        static uint32_t const CAPACITY = 256;
+
+        struct Key
+        {
+            TextHandle text;
+            FontId font = DEFAULT_FONT;
+            float fontSize = 0.f;
+            float fontSpacing = 0.f;
+            float fontBlur = 0.f;
+            float contentScale = 0.f;
+
+            bool operator==(Key const& other) const
+            {
+                return text == other.text && font == other.font && fontSize == other.fontSize && fontSpacing == other.fontSpacing &&
+                    fontBlur == other.fontBlur && contentScale == other.contentScale;
+            }
+        };
+
+        static Key MakeKey(FontText const& fontText, float const contentScale)
+        {
+            Key key = {};
+            key.text = fontText.text;
+            key.font = fontText.font;
+            key.fontSize = fontText.fontSize;
+            key.fontSpacing = fontText.fontSpacing;
+            key.fontBlur = fontText.fontBlur;
+            key.contentScale = contentScale;
+            return key;
+        }
+
+        bool Find(Key const& key, float& xOut, float& yOut)
+        {
+            auto const it = indices.find(key);
+            if (it == indices.end())
+                return false;
+
+            MoveToFront(it->second);
+            xOut = entries[it->second].x;
+            yOut = entries[it->second].y;
+            return true;
+        }
+
+        void Add(Key const& key, float const x, float const y)
+        {
+            uint32_t index = INVALID_INDEX;
+
+            auto const it = indices.find(key);
+            if (it != indices.end()) // already measured, replace it
+            {
+                index = it->second;
+                MoveToFront(index);
+            }
+            else
+            {
+                if (entries.size() < CAPACITY)
+                {
+                    index = static_cast<uint32_t>(entries.size());
+                    entries.emplace_back();
+                }
+                else // evict the least recently used
+                {
+                    index = tail;
+                    Unlink(index);
+                    indices.erase(entries[index].key);
+                }
+
+                Link(index);
+                indices[key] = index;
+            }
+
+            Entry& entry = entries[index];
+            entry.key = key;
+            entry.x = x;
+            entry.y = y;
+        }
+
+    private:
+        static uint32_t const INVALID_INDEX = static_cast<uint32_t>(-1);
+
+        struct KeyHasher
+        {
+            size_t operator()(Key const& key) const
+            {
+                size_t hash = static_cast<size_t>(key.text.Id());
+                for (size_t const value : { static_cast<size_t>(key.font), std::hash<float>()(key.fontSize), std::hash<float>()(key.fontSpacing),
+                    std::hash<float>()(key.fontBlur), std::hash<float>()(key.contentScale) })
+                {
+                    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+                }
+                return hash;
+            }
+        };
+
+        struct Entry
+        {
+            Key key;
+            float x = 0.f;
+            float y = 0.f;
+            uint32_t prev = INVALID_INDEX;
+            uint32_t next = INVALID_INDEX;
+        };
+
+        void Link(uint32_t const index)
+        {
+            entries[index].prev = INVALID_INDEX;
+            entries[index].next = head;
+            if (head != INVALID_INDEX)
+                entries[head].prev = index;
+            head = index;
+            if (tail == INVALID_INDEX)
+                tail = index;
+        }
+
+        void Unlink(uint32_t const index)
+        {
+            Entry& entry = entries[index];
+            if (entry.prev != INVALID_INDEX)
+                entries[entry.prev].next = entry.next;
+            else
+                head = entry.next;
+            if (entry.next != INVALID_INDEX)
+                entries[entry.next].prev = entry.prev;
+            else
+                tail = entry.prev;
+        }
+
+        void MoveToFront(uint32_t const index)
+        {
+            if (head == index)
+                return;
+            Unlink(index);
+            Link(index);
+        }
+
+        std::vector<Entry> entries;
+        std::unordered_map<Key, uint32_t, KeyHasher> indices;
+        uint32_t head = INVALID_INDEX;
+        uint32_t tail = INVALID_INDEX;
+    };
+
+    enum eFontFileState
+    {
+        FONT_FILE_UNLOADED,
+        FONT_FILE_LOADING,
+        FONT_FILE_LOADED,
+        FONT_FILE_FAILED
+    };
+
+    // Contents of a font file of the manifest.  Shared with the loader thread, data can only be accessed once loaded.
+    struct FontFile
+    {
+        std::string fileName;
+        std::atomic<int> state = FONT_FILE_UNLOADED;
+        std::vector<uint8_t> data;
+    };
+
+    struct RegisteredFont
+    {
+        std::string name;
+        std::shared_ptr<FontFile> pFile;
+        float lastUsedTime = 0.f; // see Context::time
+        bool isBuiltin = false; // imgui's built-in font, no file and never released
+    };
+
+    static bool ReadFontFile(char const* pFileName, std::vector<uint8_t>& dataOut)
+    {
+        FileStream stream = {};
+        if (!fsOpenStreamFromPath(RD_FONTS, pFileName, FM_READ, &stream))
+        {
+            LOGF(eERROR, "Could not open font file %s.", pFileName);
+            return false;
+        }
+
+        ssize_t const size = fsGetStreamFileSize(&stream);
+        dataOut.resize(size > 0 ? static_cast<size_t>(size) : 0);
+        size_t const readSize = fsReadFromStream(&stream, dataOut.data(), dataOut.size());
+        fsCloseStream(&stream);
+
+        return !dataOut.empty() && readSize == dataOut.size();
+    }
+
+    // Loads the file of a font that was just set to loading
+    static void LoadFontFile(FontFile& file)
+    {
+        ASSERT(FONT_FILE_LOADING == file.state.load(std::memory_order_acquire));
+
+        bool const isLoaded = ReadFontFile(file.fileName.c_str(), file.data);
+        if (!isLoaded)
+            file.data.clear();
+
+        file.state.store(isLoaded ? FONT_FILE_LOADED : FONT_FILE_FAILED, std::memory_order_release);
+    }
+
+    // Worker thread loading font files on their first use, so it doesn't stall the frame
+    class FontFileLoader
+    {
+    public:
+        FontFileLoader()
+        {
+            worker = std::thread([this]() { Work(); });
+        }
+
+        ~FontFileLoader()
+        {
+            Stop();
+        }
+
+        // Waits for the file being loaded (if any), queued ones are dropped
+        void Stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isExiting = true;
+            }
+            condition.notify_all();
+
+            if (worker.joinable())
+                worker.join();
+        }
+
+        void Enqueue(std::shared_ptr<FontFile> const& pFile)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(pFile);
+            }
+            condition.notify_one();
+        }
+
+    private:
+        void Work()
+        {
+            while (true)
+            {
+                std::shared_ptr<FontFile> pFile;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [this]() { return isExiting || !jobs.empty(); });
+
+                    // Nobody blocks on queued font files, they're dropped on exit
+                    if (isExiting)
+                        return;
+
+                    pFile = jobs.front();
+                    jobs.pop_front();
+                }
+
+                LoadFontFile(*pFile);
+            }
+        }
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::shared_ptr<FontFile>> jobs;
+        bool isExiting = false;
+    };
+
+    // Returns true if the font file is loaded, otherwise queues it to be (if it wasn't already)
+    static bool RequestFontFile(FontFileLoader* pLoader, std::shared_ptr<FontFile> const& pFile)
+    {
+        int state = pFile->state.load(std::memory_order_acquire);
+        if (FONT_FILE_UNLOADED == state && pLoader && pFile->state.compare_exchange_strong(state, FONT_FILE_LOADING))
+            pLoader->Enqueue(pFile);
+
+        return FONT_FILE_LOADED == pFile->state.load(std::memory_order_acquire);
+    }
+
+    // A font rasterized at a given pixel size and blur radius, for FontText (and the UI) or WorldText
+    struct FontSize
+    {
+        FontId font = DEFAULT_FONT;
+        unsigned int pixelSize = 0;
+        unsigned int blur = 0;
+        bool isWorld = false;
+
+        auto operator<=>(FontSize const&) const = default;
+    };
+
+    struct LoadedFont
+    {
+        ImFont* pFont = nullptr;
+        uint32_t page = 0;
+    };
+
+    // A glyph atlas texture and the fonts rasterized in it
+    struct AtlasPage
+    {
+        ImFontAtlas* pAtlas = nullptr;
+        Texture* pTexture = nullptr;
+        std::vector<FontSize> fonts;
+        bool isWorld = false; // holds world text fonts, uploaded with their coverage in red for fontstash's shader instead of imgui's RGBA
+        bool isFull = false;  // fonts spilled over from it, new ones go to another page
+        bool isDirty = false; // fonts were added or removed, needs to be rebuilt
+        uint64_t textureVersion = 0; // bumped every time the texture gets replaced (glyph UVs into it change along with it)
+    };
+
+    // Atlas page texture replaced by a rebuild, released once the frames that could sample it are done
+    struct RetiredTexture
+    {
+        Texture* pTexture = nullptr;
+        uint64_t frame = 0; // last frame the texture could have been used on
+    };
+
+    // World text in view this frame
+    struct WorldLabel
+    {
+        float distance = 0.f; // from the camera
+        WorldText const* pText = nullptr;
+        WorldGlyphLayout const* pLayout = nullptr;
+    };
+
+    // Glyph programs, each drawing a kind of atlas page glyphs
+    enum eGlyphProgram
+    {
+        GLYPH_PROGRAM_BITMAP,
+        GLYPH_PROGRAM_WORLD,
+        GLYPH_PROGRAM_COUNT
+    };
+
+    struct GlyphProgramDesc
+    {
+        char const* pVertFileName;
+        char const* pFragFileName;
+        char const* pTextureName;
+        char const* pSamplerName;
+        bool isWorld; // glyphs placed in the world (depth tested, a draw per label with its transform and color) instead of 2D quads
+    };
+
+    static GlyphProgramDesc const GLYPH_PROGRAM_DESCS[GLYPH_PROGRAM_COUNT] = {
+        { "imgui.vert", "imgui_SAMPLE_COUNT_1.frag", "uTex", "uSampler", false }, // glyph quads are textured and colored 2D quads, imgui's shaders draw them just fine
+        { "fontstash3D.vert", "fontstash.frag", "uTex0", "uSampler0", true }, // The-Forge's fontstash shaders, glyph coverage is sampled from red
+    };
+
+    // A glyph shader with its own root signature, descriptor sets and pipeline.  Programs are added the first time glyphs need them,
+    // one that can't be (eg. its shaders aren't compiled) doesn't take the others down.
+    struct GlyphProgram
+    {
+        Shader* pShader = nullptr;
+        RootSignature* pRootSignature = nullptr;
+        DescriptorSet* pDescriptorSetUniforms = nullptr; // 2D programs only, the identity projection
+        DescriptorSet* pDescriptorSetTexture = nullptr; // a set per atlas page per frame in flight [frameIndex * MAX_ATLAS_PAGES + page]
+        std::vector<uint64_t> boundTextureVersions; // page texture version each of the sets above was last updated with
+        uint32_t rootConstantIndex = 0; // world programs only (see WorldTextConstants)
+        RHI::PipelineHandle pipeline;
+        bool isAdded = false;
+        bool hasFailed = false; // not tried again
+    };
+
+    // The font rendering context (singleton)
+    struct Context
+    {
+        bool isInitialized = false;
+        unsigned int width = 0;
+        unsigned int height = 0;
+        float contentScale = 1.f;
+        flecs::query<FontText const, GlyphLayout const, FontTextClipRect const*> fontTextQuery;
+        flecs::query<FontText const, GlyphLayout> layoutQuery; // change detected on FontText only
+        uint64_t laidOutAtlasVersion = 0; // atlas version all layouts were last redone for
+        flecs::entity renderPass;
+
+        // Fonts of the manifest, read at init.  Their files get loaded on first use and released once unused for a while.
+        std::unordered_map<FontId, RegisteredFont> fonts;
+        FontId defaultFont = DEFAULT_FONT;
+        std::shared_ptr<FontFileLoader> pFileLoader; // started at init, stopped on exit
+        uint64_t frame = 0; // frames since init
+        float time = 0.f; // seconds the world progressed since init, font usage is tracked in it
+
+        // Glyph atlas.  Fonts get rasterized in it at the sizes text uses them, new sizes are queued and the pages they go to rebuilt before drawing.
+        std::vector<AtlasPage> atlasPages;
+        uint64_t atlasVersion = 1;
+        std::map<FontSize, LoadedFont> loadedFonts;
+        std::set<FontSize> fontsToLoad; // also queued from measurements (and the UI)
+        std::set<FontSize> fontsToDrop; // rasterized at a previous content scale, dropped along with the rasterization of their replacements
+        uint64_t fontsToDropFrame = 0; // frame they were queued on
+        MeasureCache measureCache;
+        AtlasPage baseAtlas; // imgui's own atlas (see SharedAtlas), built once at init
+        std::vector<RetiredTexture> retiredTextures;
+
+        // Glyph programs (see eGlyphProgram), created for the canvas color format
+        GlyphProgram programs[GLYPH_PROGRAM_COUNT];
+        TinyImageFormat colorFormat = TinyImageFormat_UNDEFINED;
+        Sampler* pSampler = nullptr;
+        RHI::BufferRange uniformBuffer; // identity projection, quads are written in clip space
+        VertexLayout vertexLayout = {};
+
+        // Glyph quads are streamed every frame, each frame in flight has its own region of the vertex buffer
+        Buffer* pVertexBuffer = nullptr;
+        RHI::BufferRange indexBuffer; // static quad indices
+        uint32_t frameVertexCount = 0; // vertices written in the current frame's region
+        uint64_t frameVertexCountFrame = 0; // frame frameVertexCount counts for (several canvases can draw text in a frame)
+        std::vector<std::vector<GlyphVertex>> pageVertices; // quads to draw, grouped by atlas page (kept to reuse allocations)
+
+        // World text, seen from the camera.  Quads of every label are streamed in font pixels, each label's transform (its plane and
+        // the camera's view projection) goes in its uniforms.  Each frame in flight has its own region of both buffers.
+        flecs::query<WorldText const, WorldGlyphLayout const> worldTextQuery;
+        flecs::query<WorldText const, WorldGlyphLayout> worldLayoutQuery; // change detected on WorldText only
+        uint64_t worldLaidOutAtlasVersion = 0;
+        flecs::entity worldRenderPass;
+        Buffer* pWorldVertexBuffer = nullptr;
+        Buffer* pWorldUniformBuffer = nullptr;
+        VertexLayout worldVertexLayout = {};
+        RenderTarget* pDepthTarget = nullptr; // added (sized as the canvas) once there's world text
+        RenderGraph::ResourceId depthResource = RenderGraph::INVALID_RESOURCE;
+        std::vector<WorldLabel> worldLabels; // sorted back to front (kept to reuse allocations)
+    };
+
+    // Registers the fonts listed in the manifest, one per line: <name> <file> (# starts a comment)
+    static void ReadFontManifest(Context& context)
+    {
+        std::vector<uint8_t> manifest;
+        if (!ReadFontFile("Fonts.manifest", manifest))
+            return;
+
+        std::string_view text(reinterpret_cast<char const*>(manifest.data()), manifest.size());
+        while (!text.empty())
+        {
+            size_t const lineEnd = text.find('\n');
+            std::string_view line = text.substr(0, lineEnd);
+            text = lineEnd == std::string_view::npos ? std::string_view() : text.substr(lineEnd + 1);
+
+            line = line.substr(0, line.find('#'));
+
+            char const* pWhitespaces = " \t\r";
+            size_t const nameBegin = line.find_first_not_of(pWhitespaces);
+            if (nameBegin == std::string_view::npos)
+                continue;
+
+            size_t const nameEnd = line.find_first_of(pWhitespaces, nameBegin);
+            size_t const fileBegin = nameEnd == std::string_view::npos ? std::string_view::npos : line.find_first_not_of(pWhitespaces, nameEnd);
+            if (fileBegin == std::string_view::npos)
+            {
+                LOGF(eWARNING, "Font manifest line without a file: %.*s", static_cast<int>(line.size()), line.data());
+                continue;
+            }
+
+            size_t const fileEnd = line.find_last_not_of(pWhitespaces) + 1;
+            std::string_view const name = line.substr(nameBegin, nameEnd - nameBegin);
+            FontId const fontId = MakeFontId(name);
+
+            if (DEFAULT_FONT == fontId || context.fonts.find(fontId) != context.fonts.end())
+            {
+                LOGF(eWARNING, "Font %.*s is listed more than once in the manifest (or its name hash collides).", static_cast<int>(name.size()), name.data());
+                continue;
+            }
+
+            RegisteredFont& font = context.fonts[fontId];
+            font.name = name;
+            font.pFile = std::make_shared<FontFile>();
+            font.pFile->fileName = line.substr(fileBegin, fileEnd - fileBegin);
+
+            if (DEFAULT_FONT == context.defaultFont)
+                context.defaultFont = fontId;
+        }
+    }
+
+    // Registers imgui's built-in font (it doesn't have a file)
+    static void RegisterBuiltinFont(Context& context)
+    {
+        RegisteredFont& font = context.fonts[BUILTIN_FONT];
+        font.name = "ProggyClean";
+        font.pFile = std::make_shared<FontFile>();
+        font.pFile->state.store(FONT_FILE_LOADED, std::memory_order_release);
+        font.isBuiltin = true;
+    }
+
+    static FontId ResolveFont(Context const& context, FontId const font)
+    {
+        return DEFAULT_FONT == font ? context.defaultFont : font;
+    }
+
+    // Drops the rasterized fonts matching the predicate, the atlas pages they were in get rebuilt
+    template<typename Predicate>
+    static void DropRasterizedFonts(Context& context, Predicate const& predicate)
+    {
+        for (auto it = context.loadedFonts.begin(); it != context.loadedFonts.end();)
+        {
+            if (predicate(it->first))
+                it = context.loadedFonts.erase(it);
+            else
+                ++it;
+        }
+
+        for (auto it = context.fontsToLoad.begin(); it != context.fontsToLoad.end();)
+        {
+            if (predicate(*it))
+                it = context.fontsToLoad.erase(it);
+            else
+                ++it;
+        }
+
+        for (AtlasPage& page : context.atlasPages)
+        {
+            auto const removedIt = std::remove_if(page.fonts.begin(), page.fonts.end(), predicate);
+            if (removedIt != page.fonts.end())
+            {
+                page.fonts.erase(removedIt, page.fonts.end());
+                page.isDirty = true;
+                page.isFull = false;
+            }
+        }
+    }
+
+    // Releases a font's file and its rasterized sizes
+    static void ReleaseFont(Context& context, FontId const fontId)
+    {
+        DropRasterizedFonts(context, [fontId](FontSize const& fontSize) { return fontSize.font == fontId; });
+
+        RegisteredFont& font = context.fonts.at(fontId);
+        font.pFile->data.clear();
+        font.pFile->data.shrink_to_fit();
+        font.pFile->state.store(FONT_FILE_UNLOADED, std::memory_order_release);
+
+        LOGF(eINFO, "Released font %s.", font.name.c_str());
+    }
+
+    static unsigned int PixelSize(float const fontSize, float const contentScale)
+    {
+        return std::max(1u, static_cast<unsigned int>(fontSize * contentScale + 0.5f));
+    }
+
+    // Blur radius a bitmap font gets rasterized with, for a blur in pixels.  imgui's built-in font doesn't blur (it has no font file).
+    static unsigned int BlurRadius(Context const& context, FontId const font, float const blur)
+    {
+        if (blur <= 0.f || BUILTIN_FONT == ResolveFont(context, font))
+            return 0;
+
+        return std::min(MAX_BLUR_RADIUS, static_cast<unsigned int>(blur + 0.5f));
+    }
+
+    // Returns a rasterized font (and its atlas page), or queues it to be (once its file is loaded) and returns nullptr.
+    // The key's font gets resolved (see ResolveFont).
+    static ImFont* FindFont(Context& context, FontSize key, uint32_t* pPageOut = nullptr)
+    {
+        key.font = ResolveFont(context, key.font);
+        auto const registeredIt = context.fonts.find(key.font);
+        if (registeredIt == context.fonts.end())
+            return nullptr;
+
+        registeredIt->second.lastUsedTime = context.time;
+
+        auto const loadedIt = context.loadedFonts.find(key);
+        if (loadedIt != context.loadedFonts.end())
+        {
+            // Still used at the current content scale (same pixel size)
+            if (!context.fontsToDrop.empty())
+                context.fontsToDrop.erase(key);
+
+            if (pPageOut)
+                *pPageOut = loadedIt->second.page;
+            return loadedIt->second.pFont;
+        }
+
+        if (RequestFontFile(context.pFileLoader.get(), registeredIt->second.pFile))
+            context.fontsToLoad.insert(key);
+        return nullptr;
+    }
+
+    // Returns the rasterized font of a text, see above
+    static ImFont* FindFont(Context& context, FontText const& fontText, uint32_t* pPageOut = nullptr)
+    {
+        return FindFont(context, { fontText.font, PixelSize(fontText.fontSize, context.contentScale), BlurRadius(context, fontText.font, fontText.fontBlur * context.contentScale) }, pPageOut);
+    }
+
+    // Returns the rasterized font of a world text, see above.  World text isn't affected by the content scale, its blur is in world units
+    // like its font size.
+    static ImFont* FindFont(Context& context, WorldText const& worldText, uint32_t* pPageOut = nullptr)
+    {
+        float const blur = worldText.fontSize > 0.f ? worldText.fontBlur * WORLD_TEXT_PIXEL_SIZE / worldText.fontSize : 0.f;
+        return FindFont(context, { worldText.font, WORLD_TEXT_PIXEL_SIZE, BlurRadius(context, worldText.font, blur), true }, pPageOut);
+    }
+
+    // Lays out the glyph quads of a text, in pixels from its top left corner (glyphs scaled by scale, spacing isn't)
+    static float LayoutGlyphs(ImFont& font, float const scale, std::string_view const text, float const spacing, std::vector<GlyphVertex>* pVerticesOut)
+    {
+        if (pVerticesOut)
+            pVerticesOut->clear();
+
+        float x = 0.f;
+        char const* pText = text.data();
+        char const* pEnd = pText + text.size();
+        while (pText < pEnd)
+        {
+            unsigned int c = 0;
+            pText += ImTextCharFromUtf8(&c, pText, pEnd);
+            if (c == 0)
+                break;
+
+            ImFontGlyph const* pGlyph = font.FindGlyph(static_cast<ImWchar>(c));
+            if (!pGlyph)
+                continue;
+
+            if (pVerticesOut && pGlyph->Visible)
+            {
+                pVerticesOut->push_back({ x + pGlyph->X0 * scale, pGlyph->Y0 * scale, pGlyph->U0, pGlyph->V0 });
+                pVerticesOut->push_back({ x + pGlyph->X1 * scale, pGlyph->Y0 * scale, pGlyph->U1, pGlyph->V0 });
+                pVerticesOut->push_back({ x + pGlyph->X1 * scale, pGlyph->Y1 * scale, pGlyph->U1, pGlyph->V1 });
+                pVerticesOut->push_back({ x + pGlyph->X0 * scale, pGlyph->Y1 * scale, pGlyph->U0, pGlyph->V1 });
+            }
+
+            x += pGlyph->AdvanceX * scale + spacing;
+        }
+
+        return x;
+    }
+
+    // Quads of layouts whose page got rebuilt since don't point to their glyphs anymore
+    static bool IsLayoutDrawable(Context const& context, GlyphLayout const& layout)
+    {
+        return !layout.vertices.empty() && layout.page < context.atlasPages.size() && context.atlasPages[layout.page].textureVersion == layout.pageTextureVersion;
+    }
+
+    static void ComputeLayoutBounds(GlyphLayout& layout)
+    {
+        layout.minX = layout.minY = layout.maxX = layout.maxY = 0.f;
+        if (layout.vertices.empty())
+            return;
+
+        layout.minX = layout.maxX = layout.vertices[0].x;
+        layout.minY = layout.maxY = layout.vertices[0].y;
+        for (GlyphVertex const& vertex : layout.vertices)
+        {
+            layout.minX = std::min(layout.minX, vertex.x);
+            layout.minY = std::min(layout.minY, vertex.y);
+            layout.maxX = std::max(layout.maxX, vertex.x);
+            layout.maxY = std::max(layout.maxY, vertex.y);
+        }
+    }
+
+    // Cuts a glyph quad (as laid out: top left, top right, bottom right, bottom left) to a rect, its UVs along with it.
+    // Returns false if nothing is left of it.
+    static bool ClipGlyphQuad(GlyphVertex* pQuad, float const minX, float const minY, float const maxX, float const maxY)
+    {
+        float const x0 = std::max(pQuad[0].x, minX);
+        float const x1 = std::min(pQuad[1].x, maxX);
+        float const y0 = std::max(pQuad[0].y, minY);
+        float const y1 = std::min(pQuad[2].y, maxY);
+        if (x0 >= x1 || y0 >= y1)
+            return false;
+
+        float const width = pQuad[1].x - pQuad[0].x;
+        float const height = pQuad[2].y - pQuad[0].y;
+        float const du = width > 0.f ? (pQuad[1].u - pQuad[0].u) / width : 0.f;
+        float const dv = height > 0.f ? (pQuad[2].v - pQuad[0].v) / height : 0.f;
+        float const u0 = pQuad[0].u + (x0 - pQuad[0].x) * du;
+        float const u1 = pQuad[0].u + (x1 - pQuad[0].x) * du;
+        float const v0 = pQuad[0].v + (y0 - pQuad[0].y) * dv;
+        float const v1 = pQuad[0].v + (y1 - pQuad[0].y) * dv;
+
+        pQuad[0].x = x0; pQuad[0].y = y0; pQuad[0].u = u0; pQuad[0].v = v0;
+        pQuad[1].x = x1; pQuad[1].y = y0; pQuad[1].u = u1; pQuad[1].v = v0;
+        pQuad[2].x = x1; pQuad[2].y = y1; pQuad[2].u = u1; pQuad[2].v = v1;
+        pQuad[3].x = x0; pQuad[3].y = y1; pQuad[3].u = u0; pQuad[3].v = v1;
+        return true;
+    }
+
+    // Glyph rasterized here rather than by imgui, to be copied to its atlas rect once the atlas is built
+    struct CustomGlyph
+    {
+        int rectId = -1;
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels; // alpha
+    };
+
+    // Box blurs count lines of length pixels (step apart within a line, lines are stride apart)
+    static void BoxBlurLines(unsigned char* pPixels, int const count, int const length, int const step, int const stride, int const radius, std::vector<unsigned char>& line)
+    {
+        int const window = 2 * radius + 1;
+        line.resize(length);
+        for (int l = 0; l < count; ++l)
+        {
+            unsigned char* pLine = pPixels + l * stride;
+            for (int i = 0; i < length; ++i)
+                line[i] = pLine[i * step];
+
+            int sum = 0;
+            for (int i = 0; i <= std::min(radius, length - 1); ++i)
+                sum += line[i];
+
+            for (int i = 0; i < length; ++i)
+            {
+                pLine[i * step] = static_cast<unsigned char>(sum / window);
+                if (i + radius + 1 < length)
+                    sum += line[i + radius + 1];
+                if (i - radius >= 0)
+                    sum -= line[i - radius];
+            }
+        }
+    }
+
+    // Adds a font whose glyphs (imgui's default Latin range) are rasterized here and blurred, as custom glyphs of an atlas font.
+    // imgui rasterizes the font itself for its metrics only (and the space character).
+    // Two box blur passes per axis approximate a gaussian, spreading glyphs by twice the blur radius (which they're padded by).
+    static ImFont* AddBlurredFont(ImFontAtlas& atlas, std::vector<uint8_t>& fontFile, float const pixelSize, int const blur, std::vector<CustomGlyph>& glyphsOut)
+    {
+        static ImWchar const METRICS_ONLY_RANGE[] = { 0x20, 0x20, 0 };
+
+        ImFontConfig config = {};
+        config.FontDataOwnedByAtlas = false;
+        config.GlyphRanges = METRICS_ONLY_RANGE;
+        ImFont* pFont = atlas.AddFontFromMemoryTTF(fontFile.data(), static_cast<int>(fontFile.size()), pixelSize, &config);
+        if (!pFont)
+            return nullptr;
+
+        stbtt_fontinfo fontInfo = {};
+        if (!stbtt_InitFont(&fontInfo, fontFile.data(), stbtt_GetFontOffsetForIndex(fontFile.data(), 0)))
+            return pFont;
+
+        // Same scale and baseline as imgui's rasterizer
+        float const scale = stbtt_ScaleForPixelHeight(&fontInfo, pixelSize);
+        int ascent = 0;
+        int descent = 0;
+        int lineGap = 0;
+        stbtt_GetFontVMetrics(&fontInfo, &ascent, &descent, &lineGap);
+        float const baseline = std::floor(ascent * scale + 1.f);
+
+        int const padding = 2 * blur;
+        std::vector<unsigned char> line;
+        for (ImWchar const* pRange = atlas.GetGlyphRangesDefault(); pRange[0]; pRange += 2)
+        {
+            for (unsigned int c = std::max<unsigned int>(pRange[0], 0x21); c <= pRange[1]; ++c)
+            {
+                if (stbtt_FindGlyphIndex(&fontInfo, c) == 0)
+                    continue;
+
+                int x0 = 0;
+                int y0 = 0;
+                int x1 = 0;
+                int y1 = 0;
+                stbtt_GetCodepointBitmapBox(&fontInfo, c, scale, scale, &x0, &y0, &x1, &y1);
+                if (x1 <= x0 || y1 <= y0)
+                    continue;
+
+                CustomGlyph glyph = {};
+                glyph.width = x1 - x0 + 2 * padding;
+                glyph.height = y1 - y0 + 2 * padding;
+                glyph.pixels.assign(glyph.width * glyph.height, 0);
+                stbtt_MakeCodepointBitmap(&fontInfo, glyph.pixels.data() + padding * glyph.width + padding, x1 - x0, y1 - y0, glyph.width, scale, scale, c);
+
+                for (int pass = 0; pass < 2; ++pass)
+                {
+                    BoxBlurLines(glyph.pixels.data(), glyph.height, glyph.width, 1, glyph.width, blur, line);
+                    BoxBlurLines(glyph.pixels.data(), glyph.width, glyph.height, glyph.width, 1, blur, line);
+                }
+
+                int advance = 0;
+                int leftSideBearing = 0;
+                stbtt_GetCodepointHMetrics(&fontInfo, c, &advance, &leftSideBearing);
+
+                glyph.rectId = atlas.AddCustomRectFontGlyph(pFont, static_cast<ImWchar>(c), glyph.width, glyph.height, advance * scale,
+                    ImVec2(static_cast<float>(x0 - padding), baseline + y0 - padding));
+                glyphsOut.push_back(std::move(glyph));
+            }
+        }
+
+        return pFont;
+    }
+
+    static void BuildAtlasPage(Context& context, uint32_t const pageIndex)
+    {
+        AtlasPage& page = context.atlasPages[pageIndex];
+        ImFontAtlas& atlas = *page.pAtlas;
+        atlas.Clear();
+
+        std::vector<CustomGlyph> customGlyphs;
+
+        for (FontSize const& fontSize : page.fonts)
+        {
+            std::vector<uint8_t>& fontFile = context.fonts.at(fontSize.font).pFile->data;
+
+            LoadedFont& loadedFont = context.loadedFonts[fontSize];
+            if (BUILTIN_FONT == fontSize.font)
+            {
+                ImFontConfig config = {};
+                config.SizePixels = static_cast<float>(fontSize.pixelSize);
+                loadedFont.pFont = atlas.AddFontDefault(&config);
+            }
+            else if (fontSize.blur > 0)
+            {
+                loadedFont.pFont = AddBlurredFont(atlas, fontFile, static_cast<float>(fontSize.pixelSize), static_cast<int>(fontSize.blur), customGlyphs);
+            }
+            else
+            {
+                ImFontConfig config = {};
+                config.FontDataOwnedByAtlas = false;
+                config.PixelSnapH = true;
+                loadedFont.pFont = atlas.AddFontFromMemoryTTF(fontFile.data(), static_cast<int>(fontFile.size()), static_cast<float>(fontSize.pixelSize), &config);
+            }
+            loadedFont.page = pageIndex;
+            ASSERT(loadedFont.pFont);
+        }
+
+        atlas.Build();
+
+        // Custom glyphs go where imgui packed their rects (the atlas is converted to RGBA when uploaded, their pixels end up in alpha)
+        unsigned char* pAlpha = nullptr;
+        int width = 0;
+        int height = 0;
+        if (!customGlyphs.empty())
+            atlas.GetTexDataAsAlpha8(&pAlpha, &width, &height);
+
+        for (CustomGlyph const& glyph : customGlyphs)
+        {
+            ImFontAtlasCustomRect const* pRect = atlas.GetCustomRectByIndex(glyph.rectId);
+            for (int y = 0; y < glyph.height; ++y)
+                memcpy(pAlpha + (pRect->Y + y) * width + pRect->X, glyph.pixels.data() + y * glyph.width, glyph.width);
+        }
+    }
+
+    // Creates the page's texture from the atlas pixels (a previous one needs to be retired first).
+    // The texture is the atlas' TexID, for the UI to bind it when drawing with its fonts.  World text pages only need coverage.
+    static void UploadAtlas(AtlasPage& page)
+    {
+        ASSERT(!page.pTexture);
+
+        int width = 0;
+        int height = 0;
+        unsigned char* pPixels = nullptr;
+        if (page.isWorld)
+            page.pAtlas->GetTexDataAsAlpha8(&pPixels, &width, &height);
+        else
+            page.pAtlas->GetTexDataAsRGBA32(&pPixels, &width, &height);
+
+        SyncToken token = {};
+        TextureDesc textureDesc = {};
+        textureDesc.mArraySize = 1;
+        textureDesc.mDepth = 1;
+        textureDesc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+        textureDesc.mFormat = page.isWorld ? TinyImageFormat_R8_UNORM : TinyImageFormat_R8G8B8A8_UNORM;
+        textureDesc.mHeight = height;
+        textureDesc.mMipLevels = 1;
+        textureDesc.mSampleCount = SAMPLE_COUNT_1;
+        textureDesc.mStartState = RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+        textureDesc.mWidth = width;
+        textureDesc.pName = "Glyph Atlas Page";
+        TextureLoadDesc loadDesc = {};
+        loadDesc.pDesc = &textureDesc;
+        loadDesc.ppTexture = &page.pTexture;
+        addResource(&loadDesc, &token);
+        waitForToken(&token);
+
+        TextureUpdateDesc updateDesc = { page.pTexture, 0, 1, 0, 1, RESOURCE_STATE_PIXEL_SHADER_RESOURCE };
+        beginUpdateResource(&updateDesc);
+        TextureSubresourceUpdate subresource = updateDesc.getSubresourceUpdateDesc(0, 0);
+        for (uint32_t r = 0; r < subresource.mRowCount; ++r)
+            memcpy(subresource.pMappedData + r * subresource.mDstRowStride, pPixels + r * subresource.mSrcRowStride, subresource.mSrcRowStride);
+        endUpdateResource(&updateDesc);
+
+        // The texture was uploaded, the CPU copy isn't needed anymore
+        page.pAtlas->ClearTexData();
+        page.pAtlas->SetTexID(static_cast<ImTextureID>(page.pTexture));
+        page.textureVersion++;
+    }
+
+    // Replaces a page's texture.  Frames in flight (and the UI's draw data of the current one) can still sample the previous texture,
+    // it's released once they're done (see ReleaseRetiredTextures).
+    static void UploadAtlasPage(Context& context, RHI::RHI const& rhi, uint32_t const pageIndex)
+    {
+        AtlasPage& page = context.atlasPages[pageIndex];
+        if (page.pTexture)
+        {
+            context.retiredTextures.push_back({ page.pTexture, rhi.frameCount });
+            page.pTexture = nullptr;
+        }
+
+        UploadAtlas(page);
+    }
+
+    static void ReleaseRetiredTextures(Context& context, RHI::RHI const& rhi)
+    {
+        for (size_t r = 0; r < context.retiredTextures.size();)
+        {
+            if (rhi.IsFrameComplete(context.retiredTextures[r].frame))
+            {
+                removeResource(context.retiredTextures[r].pTexture);
+                context.retiredTextures[r] = context.retiredTextures.back();
+                context.retiredTextures.pop_back();
+            }
+            else
+            {
+                ++r;
+            }
+        }
+    }
+
+    // Adds a glyph program the first time it's needed.  Returns false if it couldn't be, it isn't tried again then.
+    static bool AddGlyphProgram(Context& context, RHI::RHI const& rhi, eGlyphProgram const programIndex)
+    {
+        GlyphProgram& program = context.programs[programIndex];
+        if (program.isAdded || program.hasFailed)
+            return program.isAdded;
+
+        GlyphProgramDesc const& programDesc = GLYPH_PROGRAM_DESCS[programIndex];
+        ShaderLoadDesc shaderDesc = {};
+        shaderDesc.mStages[0].pFileName = programDesc.pVertFileName;
+        shaderDesc.mStages[1].pFileName = programDesc.pFragFileName;
+        addShader(rhi.pRenderer, &shaderDesc, &program.pShader);
+        if (!program.pShader)
+        {
+            LOGF(eERROR, "Could not load the glyph shaders %s and %s, glyphs drawn with them are disabled.", programDesc.pVertFileName, programDesc.pFragFileName);
+            program.hasFailed = true;
+            return false;
+        }
+
+        char const* pStaticSamplerNames[] = { programDesc.pSamplerName };
+        RootSignatureDesc rootDesc = { &program.pShader, 1 };
+        rootDesc.mStaticSamplerCount = 1;
+        rootDesc.ppStaticSamplerNames = pStaticSamplerNames;
+        rootDesc.ppStaticSamplers = &context.pSampler;
+        addRootSignature(rhi.pRenderer, &rootDesc, &program.pRootSignature);
+
+        // fontstash's texture has no update frequency of its own, it shares its set with the label's uniforms (a root constant buffer view
+        // given when binding it)
+        DescriptorUpdateFrequency const textureFrequency = programDesc.isWorld ? DESCRIPTOR_UPDATE_FREQ_NONE : DESCRIPTOR_UPDATE_FREQ_PER_BATCH;
+        DescriptorSetDesc setDesc = { program.pRootSignature, textureFrequency, MAX_ATLAS_PAGES * rhi.dataBufferCount };
+        addDescriptorSet(rhi.pRenderer, &setDesc, &program.pDescriptorSetTexture);
+        program.boundTextureVersions.assign(MAX_ATLAS_PAGES * rhi.dataBufferCount, 0);
+
+        if (programDesc.isWorld)
+        {
+            program.rootConstantIndex = getDescriptorIndexFromName(program.pRootSignature, "uRootConstants");
+        }
+        else
+        {
+            Buffer* pBuffer = context.uniformBuffer.pBuffer;
+            DescriptorDataRange range = { static_cast<uint32_t>(context.uniformBuffer.offset), static_cast<uint32_t>(context.uniformBuffer.size) };
+            DescriptorData params[1] = {};
+            params[0].pName = "uniformBlockVS";
+            params[0].ppBuffers = &pBuffer;
+            params[0].pRanges = &range;
+            setDesc = { program.pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1 };
+            addDescriptorSet(rhi.pRenderer, &setDesc, &program.pDescriptorSetUniforms);
+            updateDescriptorSet(rhi.pRenderer, 0, program.pDescriptorSetUniforms, 1, params);
+        }
+
+        BlendStateDesc blendStateDesc = {};
+        blendStateDesc.mSrcFactors[0] = BC_SRC_ALPHA;
+        blendStateDesc.mDstFactors[0] = BC_ONE_MINUS_SRC_ALPHA;
+        blendStateDesc.mSrcAlphaFactors[0] = BC_SRC_ALPHA;
+        blendStateDesc.mDstAlphaFactors[0] = BC_ONE_MINUS_SRC_ALPHA;
+        blendStateDesc.mColorWriteMasks[0] = COLOR_MASK_ALL;
+        blendStateDesc.mRenderTargetMask = BLEND_STATE_TARGET_ALL;
+
+        DepthStateDesc depthStateDesc = {};
+
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+        GraphicsPipelineDesc& pipelineDesc = desc.mGraphicsDesc;
+        pipelineDesc.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineDesc.mRenderTargetCount = 1;
+        pipelineDesc.pColorFormats = &context.colorFormat;
+        pipelineDesc.mSampleCount = SAMPLE_COUNT_1;
+        pipelineDesc.pBlendState = &blendStateDesc;
+        pipelineDesc.pDepthState = &depthStateDesc;
+        pipelineDesc.pRasterizerState = &rasterizerStateDesc;
+        pipelineDesc.pRootSignature = program.pRootSignature;
+        pipelineDesc.pShaderProgram = program.pShader;
+        if (programDesc.isWorld)
+        {
+            // Labels hide the ones behind them
+            depthStateDesc.mDepthTest = true;
+            depthStateDesc.mDepthWrite = true;
+            depthStateDesc.mDepthFunc = CMP_LEQUAL;
+            pipelineDesc.mDepthStencilFormat = WORLD_TEXT_DEPTH_FORMAT;
+            pipelineDesc.pVertexLayout = &context.worldVertexLayout;
+        }
+        else
+        {
+            pipelineDesc.pVertexLayout = &context.vertexLayout;
+        }
+        program.pipeline = RHI::AddPipelineAsync(rhi.pRenderer, desc);
+
+        program.isAdded = true;
+        return true;
+    }
+
+    static void RemoveGlyphProgram(RHI::RHI const& rhi, GlyphProgram& program)
+    {
+        if (program.isAdded)
+        {
+            RHI::RemovePipelineAsync(rhi.pRenderer, program.pipeline);
+            removeDescriptorSet(rhi.pRenderer, program.pDescriptorSetTexture);
+            if (program.pDescriptorSetUniforms)
+                removeDescriptorSet(rhi.pRenderer, program.pDescriptorSetUniforms);
+            removeRootSignature(rhi.pRenderer, program.pRootSignature);
+            removeShader(rhi.pRenderer, program.pShader);
+        }
+
+        program = {};
+    }
+
+    // Returns the pipeline of a program, nullptr if it isn't added or compiled yet
+    static Pipeline* GetGlyphPipeline(Context const& context, eGlyphProgram const programIndex)
+    {
+        GlyphProgram const& program = context.programs[programIndex];
+        return program.isAdded ? RHI::GetPipeline(program.pipeline) : nullptr;
+    }
+
+    // Adds what glyph programs share (sampler, uniforms, vertex buffers and layouts) and the bitmap program, which every text can fall back to
+    static void AddGlyphResources(RHI::RHI const& rhi, TinyImageFormat const colorFormat, Context& context)
+    {
+        context.colorFormat = colorFormat;
+
+        SamplerDesc samplerDesc = { FILTER_LINEAR, FILTER_LINEAR, MIPMAP_MODE_NEAREST, ADDRESS_MODE_CLAMP_TO_EDGE, ADDRESS_MODE_CLAMP_TO_EDGE, ADDRESS_MODE_CLAMP_TO_EDGE };
+        addSampler(rhi.pRenderer, &samplerDesc, &context.pSampler);
+
+        float const identity[16] = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+        context.uniformBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_UNIFORMS, sizeof(identity), identity);
+
+        BufferLoadDesc vbDesc = {};
+        vbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
+        vbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        vbDesc.mDesc.mSize = sizeof(GlyphVertex) * 4 * MAX_GLYPHS * rhi.dataBufferCount;
+        vbDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        vbDesc.mDesc.pName = "Glyph Vertex Buffer";
+        vbDesc.ppBuffer = &context.pVertexBuffer;
+        addResource(&vbDesc, nullptr);
+
+        std::vector<uint16_t> indices(6 * MAX_GLYPHS);
+        for (uint32_t g = 0; g < MAX_GLYPHS; ++g)
+        {
+            uint16_t const firstVertex = static_cast<uint16_t>(g * 4);
+            uint16_t const quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+            for (uint32_t i = 0; i < 6; ++i)
+                indices[g * 6 + i] = firstVertex + quadIndices[i];
+        }
+        context.indexBuffer = RHI::AddPooledBuffer(RHI::BUFFER_POOL_GEOMETRY, indices.size() * sizeof(uint16_t), indices.data());
+
+        VertexLayout& vertexLayout = context.vertexLayout;
+        vertexLayout.mBindingCount = 1;
+        vertexLayout.mBindings[0].mStride = sizeof(GlyphVertex);
+        vertexLayout.mAttribCount = 3;
+        vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+        vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32_SFLOAT;
+        vertexLayout.mAttribs[0].mLocation = 0;
+        vertexLayout.mAttribs[0].mOffset = offsetof(GlyphVertex, x);
+        vertexLayout.mAttribs[1].mSemantic = SEMANTIC_TEXCOORD0;
+        vertexLayout.mAttribs[1].mFormat = TinyImageFormat_R32G32_SFLOAT;
+        vertexLayout.mAttribs[1].mLocation = 1;
+        vertexLayout.mAttribs[1].mOffset = offsetof(GlyphVertex, u);
+        vertexLayout.mAttribs[2].mSemantic = SEMANTIC_COLOR;
+        vertexLayout.mAttribs[2].mFormat = TinyImageFormat_R8G8B8A8_UNORM;
+        vertexLayout.mAttribs[2].mLocation = 2;
+        vertexLayout.mAttribs[2].mOffset = offsetof(GlyphVertex, color);
+
+        AddGlyphProgram(context, rhi, GLYPH_PROGRAM_BITMAP);
+    }
+
+    // Adds the world text buffers, once there's world text
+    static void AddWorldTextResources(RHI::RHI const& rhi, Context& context)
+    {
+        BufferLoadDesc vbDesc = {};
+        vbDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
+        vbDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        vbDesc.mDesc.mSize = sizeof(GlyphVertex) * 4 * MAX_WORLD_GLYPHS * rhi.dataBufferCount;
+        vbDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        vbDesc.mDesc.pName = "World Glyph Vertex Buffer";
+        vbDesc.ppBuffer = &context.pWorldVertexBuffer;
+        addResource(&vbDesc, nullptr);
+
+        BufferLoadDesc ubDesc = {};
+        ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        ubDesc.mDesc.mSize = WORLD_UNIFORM_STRIDE * MAX_WORLD_LABELS * rhi.dataBufferCount;
+        ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        ubDesc.mDesc.pName = "World Text Uniform Buffer";
+        ubDesc.ppBuffer = &context.pWorldUniformBuffer;
+        addResource(&ubDesc, nullptr);
+
+        // Laid out quads as they are, without their color (it's a root constant)
+        VertexLayout& worldVertexLayout = context.worldVertexLayout;
+        worldVertexLayout.mBindingCount = 1;
+        worldVertexLayout.mBindings[0].mStride = sizeof(GlyphVertex);
+        worldVertexLayout.mAttribCount = 2;
+        worldVertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+        worldVertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32_SFLOAT;
+        worldVertexLayout.mAttribs[0].mLocation = 0;
+        worldVertexLayout.mAttribs[0].mOffset = offsetof(GlyphVertex, x);
+        worldVertexLayout.mAttribs[1].mSemantic = SEMANTIC_TEXCOORD0;
+        worldVertexLayout.mAttribs[1].mFormat = TinyImageFormat_R32G32_SFLOAT;
+        worldVertexLayout.mAttribs[1].mLocation = 1;
+        worldVertexLayout.mAttribs[1].mOffset = offsetof(GlyphVertex, u);
+    }
+
+    static void RemoveGlyphResources(RHI::RHI const& rhi, Context& context)
+    {
+        for (GlyphProgram& program : context.programs)
+            RemoveGlyphProgram(rhi, program);
+
+        RHI::RemovePooledBuffer(context.uniformBuffer);
+        RHI::RemovePooledBuffer(context.indexBuffer);
+        removeResource(context.pVertexBuffer);
+        removeSampler(rhi.pRenderer, context.pSampler);
+
+        if (context.pWorldVertexBuffer)
+        {
+            removeResource(context.pWorldVertexBuffer);
+            removeResource(context.pWorldUniformBuffer);
+            context.pWorldVertexBuffer = nullptr;
+            context.pWorldUniformBuffer = nullptr;
+        }
+    }
+
+    // Returns the set holding an atlas page's texture for a program.  Each frame in flight has its own set per page, only updated when its
+    // page got a new texture since: sets of frames still in flight are never written to.
+    static uint32_t GetAtlasPageSet(Context& context, eGlyphProgram const programIndex, RHI::RHI const& rhi, uint32_t const pageIndex)
+    {
+        GlyphProgram& program = context.programs[programIndex];
+        AtlasPage& page = context.atlasPages[pageIndex];
+        uint32_t const setIndex = rhi.frameIndex * MAX_ATLAS_PAGES + pageIndex;
+        if (program.boundTextureVersions[setIndex] != page.textureVersion)
+        {
+            DescriptorData params[1] = {};
+            params[0].pName = GLYPH_PROGRAM_DESCS[programIndex].pTextureName;
+            params[0].ppTextures = &page.pTexture;
+            updateDescriptorSet(rhi.pRenderer, setIndex, program.pDescriptorSetTexture, 1, params);
+            program.boundTextureVersions[setIndex] = page.textureVersion;
+        }
+
+        return setIndex;
+    }
+
+    // Returns the first page at or after firstPage of the right kind that has room for more fonts (adding one if needed),
+    // MAX_ATLAS_PAGES if they're all full
+    static uint32_t FindAtlasPageWithRoom(Context& context, uint32_t const firstPage, bool const isWorld)
+    {
+        for (uint32_t p = firstPage; p < context.atlasPages.size(); ++p)
+        {
+            if (!context.atlasPages[p].isFull && context.atlasPages[p].isWorld == isWorld)
+                return p;
+        }
+
+        if (context.atlasPages.size() == MAX_ATLAS_PAGES)
+            return MAX_ATLAS_PAGES;
+
+        AtlasPage page = {};
+        page.pAtlas = IM_NEW(ImFontAtlas)();
+        page.isWorld = isWorld;
+        context.atlasPages.push_back(page);
+        return static_cast<uint32_t>(context.atlasPages.size() - 1);
+    }
+
+    // Rasterizes the queued fonts.  Only the pages they go to (or released fonts were in) get rebuilt and their previous texture retired,
+    // layouts are redone after.
+    static void RebuildAtlas(Context& context, RHI::RHI const& rhi)
+    {
+        for (FontSize const& fontSize : context.fontsToLoad)
+        {
+            uint32_t pageIndex = FindAtlasPageWithRoom(context, 0, fontSize.isWorld);
+            if (pageIndex == MAX_ATLAS_PAGES)
+            {
+                LOGF(eWARNING, "All glyph atlas pages are full, consider increasing MAX_ATLAS_PAGES.");
+
+                // Overfill the last page of the same kind
+                auto const pageIt = std::find_if(context.atlasPages.rbegin(), context.atlasPages.rend(),
+                    [&fontSize](AtlasPage const& page) { return page.isWorld == fontSize.isWorld; });
+                if (pageIt == context.atlasPages.rend())
+                    continue;
+                pageIndex = static_cast<uint32_t>(context.atlasPages.rend() - pageIt - 1);
+            }
+
+            context.atlasPages[pageIndex].fonts.push_back(fontSize);
+            context.atlasPages[pageIndex].isDirty = true;
+            context.loadedFonts[fontSize] = { nullptr, pageIndex };
+        }
+        context.fontsToLoad.clear();
+
+        // Pages can get added while going through them (fonts spilling over)
+        for (uint32_t p = 0; p < context.atlasPages.size(); ++p)
+        {
+            if (!context.atlasPages[p].isDirty)
+                continue;
+
+            // Only had released fonts, nothing samples it anymore (its texture gets replaced once fonts are added back)
+            if (context.atlasPages[p].fonts.empty())
+            {
+                context.atlasPages[p].pAtlas->Clear();
+                context.atlasPages[p].isDirty = false;
+                continue;
+            }
+
+            BuildAtlasPage(context, p);
+
+            // Too big, move its last fonts to a following page until it fits
+            while ((context.atlasPages[p].pAtlas->TexWidth > MAX_ATLAS_PAGE_SIZE || context.atlasPages[p].pAtlas->TexHeight > MAX_ATLAS_PAGE_SIZE) &&
+                context.atlasPages[p].fonts.size() > 1)
+            {
+                uint32_t const nextPage = FindAtlasPageWithRoom(context, p + 1, context.atlasPages[p].isWorld);
+                if (nextPage == MAX_ATLAS_PAGES)
+                {
+                    LOGF(eWARNING, "All glyph atlas pages are full, consider increasing MAX_ATLAS_PAGES.");
+                    break;
+                }
+
+                FontSize const spilledFont = context.atlasPages[p].fonts.back();
+                context.atlasPages[p].fonts.pop_back();
+                context.atlasPages[p].isFull = true;
+                context.atlasPages[nextPage].fonts.push_back(spilledFont);
+                context.atlasPages[nextPage].isDirty = true;
+                context.loadedFonts[spilledFont].page = nextPage;
+
+                BuildAtlasPage(context, p);
+            }
+
+            UploadAtlasPage(context, rhi, p);
+            context.atlasPages[p].isDirty = false;
+        }
+
+        context.atlasVersion++;
+    }
+
+    static void SetWorldPassDepth(Context& context, RenderGraph::ResourceId const depthResource)
+    {
+        RenderGraph::Pass* pPass = context.worldRenderPass.get_mut<RenderGraph::Pass>();
+        pPass->depth = depthResource;
+        context.worldRenderPass.modified<RenderGraph::Pass>();
+    }
+
+    static void RemoveDepthTarget(flecs::world& ecs, RHI::RHI const& rhi, Context& context)
+    {
+        if (!context.pDepthTarget)
+            return;
+
+        // Only happens on resize or exit
+        waitQueueIdle(rhi.pGfxQueue);
+
+        SetWorldPassDepth(context, RenderGraph::INVALID_RESOURCE);
+        RenderGraph::UnregisterResource(ecs, context.depthResource);
+        removeRenderTarget(rhi.pRenderer, context.pDepthTarget);
+
+        context.pDepthTarget = nullptr;
+        context.depthResource = RenderGraph::INVALID_RESOURCE;
+    }
+
+    static void AddDepthTarget(flecs::world& ecs, RHI::RHI const& rhi, unsigned int const width, unsigned int const height, Context& context)
+    {
+        RenderTargetDesc rtDesc = {};
+        rtDesc.mArraySize = 1;
+        rtDesc.mDepth = 1;
+        rtDesc.mFormat = WORLD_TEXT_DEPTH_FORMAT;
+        rtDesc.mStartState = RESOURCE_STATE_DEPTH_WRITE;
+        rtDesc.mClearValue.depth = 1.f;
+        rtDesc.mWidth = width;
+        rtDesc.mHeight = height;
+        rtDesc.mSampleCount = SAMPLE_COUNT_1;
+        rtDesc.mSampleQuality = 0;
+        rtDesc.pName = "World Text Depth";
+        addRenderTarget(rhi.pRenderer, &rtDesc, &context.pDepthTarget);
+        ASSERT(context.pDepthTarget);
+
+        context.depthResource = RenderGraph::RegisterResource(ecs, context.pDepthTarget, RESOURCE_STATE_DEPTH_WRITE);
+        SetWorldPassDepth(context, context.depthResource);
+    }
+
+    module::module(flecs::world& ecs)
+    {
+        ecs.import<Engine::module>();
+        ecs.import<RHI::module>();
+        ecs.import<RenderGraph::module>();
+        ecs.import<Window::module>();
+
+        ecs.module<module>();
+
+        ecs.component<Context>();
+        ecs.component<FontText>();
+        ecs.component<FontTextClipRect>();
+        ecs.component<GlyphLayout>();
+        ecs.component<WorldText>();
+        ecs.component<WorldGlyphLayout>();
+
+        // Text is drawn on top of whatever the scene rendered
+        RenderGraph::Pass renderPass = {};
+        renderPass.phase = Engine::FONTS_RENDER;
+        renderPass.writes = { RenderGraph::BACKBUFFER };
+
+        // World text comes first (screen text goes over it), depth is only shared among labels
+        RenderGraph::Pass worldRenderPass = renderPass;
+        worldRenderPass.clearDepth = true;
+        worldRenderPass.depthClearValue.depth = 1.f;
+
+        // Create the context singleton
+        Context context = {};
+        context.fontTextQuery = ecs.query_builder<FontText const, GlyphLayout const, FontTextClipRect const*>().cached().build();
+        context.layoutQuery = ecs.query_builder<FontText const, GlyphLayout>().term_at(1).out().detect_changes().cached().build();
+        context.worldTextQuery = ecs.query_builder<WorldText const, WorldGlyphLayout const>().cached().build();
+        context.worldLayoutQuery = ecs.query_builder<WorldText const, WorldGlyphLayout>().term_at(1).out().detect_changes().cached().build();
+        context.worldRenderPass = ecs.entity("WorldTextRenderPass").set<RenderGraph::Pass>(worldRenderPass);
+        context.renderPass = ecs.entity("FontsRenderPass").set<RenderGraph::Pass>(renderPass);
+        ecs.set<Context>(context);
+
+        // Every text gets its layout cached
+        ecs.observer<FontText>("Font Text Layout Adder")
+            .event(flecs::OnAdd)
+            .each([](flecs::entity e, FontText&)
+                {
+                    e.add<GlyphLayout>();
+                });
+
+        ecs.observer<WorldText>("World Text Layout Adder")
+            .event(flecs::OnAdd)
+            .each([](flecs::entity e, WorldText&)
+                {
+                    e.add<WorldGlyphLayout>();
+                });
+
+        // The font system is a single context, it's only used for the main window
+        auto fontSysInitializer = ecs.system<Engine::Canvas, Window::SDLWindow>("Init Font System")
+            .with<Window::MainWindowTag>()
+            .kind(flecs::OnLoad)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+                {
+                    if (!it.world().has<Context>())
+                        return;
+
+                    Context* pContext = it.world().get_mut<Context>();
+                    if (pContext->isInitialized)
+                        return;
+
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+
+                    if (!pRHI)
+                        return;
+
+                    if (!sdlWin.pSwapChain)
+                        return;
+
+                    Window::DisplayMetrics const* pDisplayMetrics = it.entity(i).has<Window::DisplayMetrics>() ? it.entity(i).get<Window::DisplayMetrics>() : nullptr;
+                    pContext->contentScale = pDisplayMetrics ? pDisplayMetrics->contentScale : 1.f;
+
+                    // Only the manifest is read, font files are loaded when first used
+                    RegisterBuiltinFont(*pContext);
+                    ReadFontManifest(*pContext);
+                    if (DEFAULT_FONT == pContext->defaultFont) // nothing in the manifest
+                        pContext->defaultFont = BUILTIN_FONT;
+                    pContext->pFileLoader = std::make_shared<FontFileLoader>();
+
+                    AddGlyphResources(*pRHI, sdlWin.pSwapChain->ppRenderTargets[0]->mFormat, *pContext);
+
+                    // imgui's context needs an atlas to start frames with, every font the UI draws with comes from the pages
+                    pContext->baseAtlas.pAtlas = IM_NEW(ImFontAtlas)();
+                    pContext->baseAtlas.pAtlas->AddFontDefault();
+                    pContext->baseAtlas.pAtlas->Build();
+                    UploadAtlas(pContext->baseAtlas);
+
+                    pContext->width = canvas.width;
+                    pContext->height = canvas.height;
+                    pContext->isInitialized = true;
+
+                    // Ensure we notify modifications for following systems in the same phase that'll use the context
+                    it.world().modified<Context>();
+                }
+            );
+
+        auto fontSysResizer = ecs.system<Engine::Canvas, Window::SDLWindow>("Font System Resizer")
+            .with<Window::MainWindowTag>()
+            .kind(flecs::OnLoad)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+                {
+                    if (!it.world().has<Context>())
+                        return;
+
+                    Context* pContext = it.world().get_mut<Context>();
+                    if (!pContext->isInitialized)
+                        return;
+
+                    // Quads are converted to clip space when drawn, the size is only tracked
+                    pContext->width = canvas.width;
+                    pContext->height = canvas.height;
+
+                    // World text gets its program and a depth target the size of the canvas, once there's some.  Without its program
+                    // (eg. its shaders aren't compiled) world text isn't drawn.
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+                    if (!pRHI || canvas.width == 0 || canvas.height == 0 || !pContext->worldTextQuery.is_true())
+                        return;
+
+                    if (!pContext->pWorldVertexBuffer)
+                        AddWorldTextResources(*pRHI, *pContext);
+                    if (!AddGlyphProgram(*pContext, *pRHI, GLYPH_PROGRAM_WORLD))
+                        return;
+
+                    if (!pContext->pDepthTarget || pContext->pDepthTarget->mWidth != canvas.width || pContext->pDepthTarget->mHeight != canvas.height)
+                    {
+                        auto world = it.world();
+                        RemoveDepthTarget(world, *pRHI, *pContext);
+                        AddDepthTarget(world, *pRHI, canvas.width, canvas.height, *pContext);
+                    }
+                }
+            );
+
+        // Content scale changes are published by the window module (see Window::DisplayMetrics).
+        // Fonts get rasterized at their new pixel sizes as text requests them.  The ones at the old scale are only dropped when their
+        // replacements get rasterized, text keeps being drawn with them meanwhile.
+        auto fontSysRescaler = ecs.observer<Window::DisplayMetrics>("Font System Rescaler")
+            .with<Window::MainWindowTag>()
+            .event(flecs::OnSet)
+            .each([](flecs::iter& it, size_t i, Window::DisplayMetrics const& displayMetrics)
+                {
+                    if (!it.world().has<Context>())
+                        return;
+
+                    Context* pContext = it.world().get_mut<Context>();
+                    if (!pContext->isInitialized || pContext->contentScale == displayMetrics.contentScale)
+                        return;
+
+                    pContext->contentScale = displayMetrics.contentScale;
+
+                    // Measurements are cached per scale, fonts still used at the new one (same pixel size) are kept (see FindFont).
+                    // World text isn't affected by the content scale.
+                    for (auto const& loadedFont : pContext->loadedFonts)
+                    {
+                        if (!loadedFont.first.isWorld)
+                            pContext->fontsToDrop.insert(loadedFont.first);
+                    }
+                    pContext->fontsToDropFrame = pContext->frame;
+                    std::erase_if(pContext->fontsToLoad, [](FontSize const& fontSize) { return !fontSize.isWorld; });
+                    pContext->atlasVersion++;
+                }
+            );
+
+        // Lays out text whose FontText changed (tables are skipped unless something wrote to them, entities unless what's laid out differs).
+        // Everything is laid out again when the atlas changes.
+        auto fontTextLayout = ecs.system("Font Text Layout")
+            .kind(flecs::OnStore)
+            .run([](flecs::iter& it)
+                {
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    if (!pContext || !pContext->isInitialized)
+                        return;
+
+                    bool const isFullLayout = pContext->laidOutAtlasVersion != pContext->atlasVersion;
+                    pContext->laidOutAtlasVersion = pContext->atlasVersion;
+
+                    pContext->layoutQuery.run([pContext, isFullLayout](flecs::iter& it)
+                        {
+                            while (it.next())
+                            {
+                                if (!isFullLayout && !it.changed())
+                                {
+                                    it.skip();
+                                    continue;
+                                }
+
+                                auto fontTexts = it.field<FontText const>(0);
+                                auto layouts = it.field<GlyphLayout>(1);
+
+                                for (size_t j : it)
+                                {
+                                    FontText const& fontText = fontTexts[j];
+                                    GlyphLayout& layout = layouts[j];
+
+                                    if (layout.IsUpToDate(fontText, pContext->atlasVersion))
+                                        continue;
 
-namespace FontRendering
-{
-    // The font rendering context (singleton)
-    struct Context
-    {
-        bool isInitialized = false;
-        unsigned int width = 0;
-        unsigned int height = 0;
-        float contentScale = 1.f;
-        std::unordered_map<eAvailableFonts, unsigned int> fontNameToIdMap;
-        flecs::query<FontText const> fontTextQuery;
-    };
+                                    uint32_t page = 0;
+                                    ImFont* pFont = FindFont(*pContext, fontText, &page);
+                                    if (!pFont) // queued, laid out once rasterized (the previous quads are kept meanwhile)
+                                        continue;
 
-    module::module(flecs::world& ecs)
-    {
-        ecs.import<Engine::module>();
-        ecs.import<RHI::module>();
-        ecs.import<Window::module>();
-        
-        ecs.module<module>();
+                                    LayoutGlyphs(*pFont, 1.f, fontText.text.View(), fontText.fontSpacing * pContext->contentScale, &layout.vertices);
+                                    ComputeLayoutBounds(layout);
 
-        ecs.component<Context>();
-        ecs.component<FontText>();
+                                    layout.text = fontText.text;
+                                    layout.font = fontText.font;
+                                    layout.fontSize = fontText.fontSize;
+                                    layout.fontSpacing = fontText.fontSpacing;
+                                    layout.fontBlur = fontText.fontBlur;
+                                    layout.atlasVersion = pContext->atlasVersion;
+                                    layout.page = page;
+                                    layout.pageTextureVersion = pContext->atlasPages[page].textureVersion;
+                                }
+                            }
+                        });
+                }
+            );
 
-        // Create the context singleton
-        Context context = {};
-        context.fontTextQuery = ecs.query_builder<FontText const>().cached().build();
-        ecs.set<Context>(context);
-        
-        auto fontSysInitializer = ecs.system<Engine::Canvas, Window::SDLWindow>("Init Font System")
-            .kind(flecs::OnLoad)
-            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+        // Lays out world text whose WorldText changed, same as above.
+        // Glyphs are laid out in font pixels (bitmap fonts are rasterized at WORLD_TEXT_PIXEL_SIZE), they're scaled to the text's world size when drawn.
+        auto worldTextLayout = ecs.system("World Text Layout")
+            .kind(flecs::OnStore)
+            .run([](flecs::iter& it)
                 {
-                    ASSERTMSG(i == 0, "Only 1 window is supported.");
-
-                    if (!it.world().has<Context>())
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    if (!pContext || !pContext->isInitialized)
                         return;
 
-                    Context* pContext = it.world().get_mut<Context>();
-                    if (pContext->isInitialized)
-                        return;
+                    bool const isFullLayout = pContext->worldLaidOutAtlasVersion != pContext->atlasVersion;
+                    pContext->worldLaidOutAtlasVersion = pContext->atlasVersion;
 
-                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+                    pContext->worldLayoutQuery.run([pContext, isFullLayout](flecs::iter& it)
+                        {
+                            while (it.next())
+                            {
+                                if (!isFullLayout && !it.changed())
+                                {
+                                    it.skip();
+                                    continue;
+                                }
 
-                    if (!pRHI)
+                                auto worldTexts = it.field<WorldText const>(0);
+                                auto layouts = it.field<WorldGlyphLayout>(1);
+
+                                for (size_t j : it)
+                                {
+                                    WorldText const& worldText = worldTexts[j];
+                                    WorldGlyphLayout& layout = layouts[j];
+
+                                    if (layout.IsUpToDate(worldText, pContext->atlasVersion))
+                                        continue;
+
+                                    uint32_t page = 0;
+                                    ImFont* pFont = FindFont(*pContext, worldText, &page);
+                                    if (!pFont) // queued, laid out once rasterized (the previous quads are kept meanwhile)
+                                        continue;
+
+                                    // Spacing is in world units, like the font size
+                                    float const spacing = worldText.fontSize > 0.f ? worldText.fontSpacing * pFont->FontSize / worldText.fontSize : 0.f;
+                                    float const width = LayoutGlyphs(*pFont, 1.f, worldText.text.View(), spacing, &layout.vertices);
+
+                                    // Centered on the origin, sitting on it
+                                    for (GlyphVertex& vertex : layout.vertices)
+                                    {
+                                        vertex.x -= width * 0.5f;
+                                        vertex.y -= pFont->FontSize;
+                                    }
+                                    ComputeLayoutBounds(layout);
+
+                                    layout.text = worldText.text;
+                                    layout.font = worldText.font;
+                                    layout.fontSize = worldText.fontSize;
+                                    layout.fontSpacing = worldText.fontSpacing;
+                                    layout.fontBlur = worldText.fontBlur;
+                                    layout.atlasVersion = pContext->atlasVersion;
+                                    layout.page = page;
+                                    layout.pageTextureVersion = pContext->atlasPages[page].textureVersion;
+                                    layout.lineHeight = pFont->FontSize;
+                                }
+                            }
+                        });
+                }
+            );
+
+        // Releases font files that weren't used for a while.
+        // Fonts are used when text gets laid out or measured (or the UI asks for them), texts still alive keep their font used.
+        auto fontReleaser = ecs.system("Font Releaser")
+            .kind(flecs::OnLoad)
+            .run([](flecs::iter& it)
+                {
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    if (!pContext || !pContext->isInitialized)
                         return;
 
-                    if (!sdlWin.pSwapChain)
+                    pContext->frame++;
+                    pContext->time += it.delta_time();
+                    if (pContext->frame % FONT_USAGE_CHECK_FRAMES != 0)
                         return;
 
-                    pContext->contentScale = 1.f;
+                    pContext->fontTextQuery.each([pContext](FontText const& fontText, GlyphLayout const&, FontTextClipRect const*)
+                        {
+                            auto const registeredIt = pContext->fonts.find(ResolveFont(*pContext, fontText.font));
+                            if (registeredIt != pContext->fonts.end())
+                                registeredIt->second.lastUsedTime = pContext->time;
+                        });
 
-                    SDL_DisplayID const dispId = SDL_GetDisplayForWindow(sdlWin.pWindow);
-                    if (dispId == 0)
-                    {
-                        LOGF(eERROR, "SDL_GetDisplayForWindow() failed.");
-                    }
-                    else
-                    {
-                        pContext->contentScale = SDL_GetDisplayContentScale(dispId);
-                    }
+                    pContext->worldTextQuery.each([pContext](WorldText const& worldText, WorldGlyphLayout const&)
+                        {
+                            auto const registeredIt = pContext->fonts.find(ResolveFont(*pContext, worldText.font));
+                            if (registeredIt != pContext->fonts.end())
+                                registeredIt->second.lastUsedTime = pContext->time;
+                        });
 
-                    FontSystemDesc fontSystemDesc = {};
-                    fontSystemDesc.mColorFormat = sdlWin.pSwapChain->ppRenderTargets[0]->mFormat;
-                    fontSystemDesc.mWidth = canvas.width;
-                    fontSystemDesc.mHeight = canvas.height;
-                    fontSystemDesc.mContentScale = pContext->contentScale;
-                    fontSystemDesc.pRenderer = pRHI->pRenderer;
-                    if (!initFontSystem(&fontSystemDesc))
+                    // Loaded files that can be released, least recently used first (the ones used since the last check are kept)
+                    std::vector<std::pair<float, FontId>> releasable;
+                    size_t loadedSize = 0;
+                    for (auto const& registeredFont : pContext->fonts)
                     {
-                        ASSERTMSG(eERROR, "Failed to init TF font system.");
-                        return;
+                        FontFile const& file = *registeredFont.second.pFile;
+                        if (registeredFont.second.isBuiltin || FONT_FILE_LOADED != file.state.load(std::memory_order_acquire))
+                            continue;
+
+                        loadedSize += file.data.size();
+                        if (registeredFont.first != pContext->defaultFont && registeredFont.second.lastUsedTime < pContext->time)
+                            releasable.push_back({ registeredFont.second.lastUsedTime, registeredFont.first });
                     }
+                    std::sort(releasable.begin(), releasable.end());
 
-                    resizeFontSystem(canvas.width, canvas.height, pContext->contentScale);
-
-                    // Define available font names to asset files and create context singleton
-                    std::unordered_map<eAvailableFonts, std::string> availableFontToAssetName;
-                    availableFontToAssetName[COMIC_RELIEF] = "ComicRelief.ttf";
-                    availableFontToAssetName[COMIC_RELIEF_BOLD] = "ComicRelief-Bold.ttf";
-                    availableFontToAssetName[CRIMSON_BOLD] = "Crimson-Bold.ttf";
-                    availableFontToAssetName[CRIMSON_BOLD_ITALIC] = "Crimson-BoldItalic.ttf";
-                    availableFontToAssetName[CRIMSON_ITALIC] = "Crimson-Italic.ttf";
-                    availableFontToAssetName[CRIMSON_ROMAN] = "Crimson-Roman.ttf";
-                    availableFontToAssetName[CROMSON_SEMI_BOLD] = "Crimson-Semibold.ttf";
-                    availableFontToAssetName[CRIMSON_SEMI_BOLD_ITALIC] = "Crimson-SemiboldItalic.ttf";
-                    availableFontToAssetName[HERMENEUS_ONE] = "HermeneusOne.ttf";
-                    availableFontToAssetName[INCONSOLATA_LGC] = "Inconsolata-LGC.otf";
-                    availableFontToAssetName[INCONSOLATA_LGC_BOLD] = "Inconsolata-LGC-Bold.otf";
-                    availableFontToAssetName[INCONSOLATA_LGC_BOLD_ITALIC] = "Inconsolata-LGC-BoldItalic.otf";
-                    availableFontToAssetName[INCONSOLATA_LGC_ITALIC] = "Inconsolata-LGC-Italic.otf";
-                    availableFontToAssetName[TITILLIUM_TEXT_BOLD] = "TitilliumText-Bold.otf";
-
-                    unsigned int fontIds[NUM_AVAILABLE_FONTS] = {};
-
-                    FontDesc fontDescs[NUM_AVAILABLE_FONTS] = {};
-                    for (unsigned int i = 0; i < NUM_AVAILABLE_FONTS; ++i)
+                    for (std::pair<float, FontId> const& font : releasable)
                     {
-                        // Use the asset path for the name (not sure what the name is used for exactly)
-                        fontDescs[i].pFontName = availableFontToAssetName[static_cast<eAvailableFonts>(i)].c_str();
-                        fontDescs[i].pFontPath = availableFontToAssetName[static_cast<eAvailableFonts>(i)].c_str();
+                        bool const isUnused = pContext->time - font.first > FONT_RELEASE_SECONDS;
+                        if (!isUnused && loadedSize <= FONT_FILES_MEMORY_BUDGET)
+                            break;
+
+                        loadedSize -= pContext->fonts.at(font.second).pFile->data.size();
+                        ReleaseFont(*pContext, font.second);
                     }
+                }
+            );
+
+        // Rasterizes fonts queued by layouts, measurements and the UI (and drops released ones), text using them gets laid out this frame.
+        // Done before the UI starts its frame (its systems come after), imgui keeps the fonts and textures it got until it's drawn.
+        auto fontAtlasBuilder = ecs.system("Font Atlas Builder")
+            .kind(flecs::OnLoad)
+            .run([](flecs::iter& it)
+                {
+                    Context* pContext = it.world().has<Context>() ? it.world().get_mut<Context>() : nullptr;
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+
+                    if (!pContext || !pContext->isInitialized || !pRHI)
+                        return;
 
-                    fntDefineFonts(fontDescs, NUM_AVAILABLE_FONTS, &fontIds[0]);
+                    ReleaseRetiredTextures(*pContext, *pRHI);
 
-                    for (unsigned int i = 0; i < NUM_AVAILABLE_FONTS; ++i)
+                    // Fonts of the previous content scale go in the same rebuild as their replacements.  Texts get laid out again at the new
+                    // scale the frame after it changed, nothing being queued by then means they were all replaced already.
+                    if (!pContext->fontsToDrop.empty() && (!pContext->fontsToLoad.empty() || pContext->frame > pContext->fontsToDropFrame + 1))
                     {
-                        pContext->fontNameToIdMap[static_cast<eAvailableFonts>(i)] = fontIds[i];
+                        std::set<FontSize> const fontsToDrop = std::move(pContext->fontsToDrop);
+                        pContext->fontsToDrop.clear();
+                        DropRasterizedFonts(*pContext, [&fontsToDrop](FontSize const& fontSize) { return fontsToDrop.count(fontSize) != 0; });
                     }
 
-                    pContext->width = canvas.width;
-                    pContext->height = canvas.height;
-                    pContext->isInitialized = true;
+                    bool const hasDirtyPage = std::any_of(pContext->atlasPages.begin(), pContext->atlasPages.end(), [](AtlasPage const& page) { return page.isDirty; });
+                    if (pContext->fontsToLoad.empty() && !hasDirtyPage)
+                        return;
 
-                    // Ensure we notify modifications for following systems in the same phase that'll use the context
-                    it.world().modified<Context>();
+                    RebuildAtlas(*pContext, *pRHI);
                 }
             );
-       
-        auto fontSysResizer = ecs.system<Engine::Canvas, Window::SDLWindow>("Font System Resizer")
-            .kind(flecs::OnLoad)
-            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
-                {
-                    ASSERTMSG(i == 0, "Only 1 window is supported.");
 
-                    if (!it.world().has<Context>())
+        // Draws all world text in one pass, from the camera.  Labels further than their max distance or out of the view frustum are culled,
+        // the others sorted back to front and their quads appended to the frame's vertex buffer region, with one draw per label (fontstash's
+        // shaders take a transform and color per draw).
+        auto worldTextRenderer = ecs.system<Engine::Canvas, RenderGraph::CanvasTarget>("World Text Renderer")
+            .with<Window::MainWindowTag>()
+            .kind(Engine::GetCustomPhaseEntity(ecs, Engine::FONTS_RENDER))
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, RenderGraph::CanvasTarget const& canvasTarget)
+                {
+                    if (!it.world().has<Context>() || !it.world().has<Engine::Camera>())
                         return;
 
                     Context* pContext = it.world().get_mut<Context>();
-                    if (!pContext->isInitialized)
+                    if (!pContext->isInitialized || pContext->atlasPages.empty() || !pContext->pDepthTarget)
+                        return;
+
+                    RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
+
+                    if (!pRHI)
+                        return;
+
+                    if (!canvasTarget.pCurRT || canvas.width == 0 || canvas.height == 0)
+                        return;
+
+                    // The depth target catches up with the canvas size next frame
+                    if (pContext->pDepthTarget->mWidth != canvasTarget.pCurRT->mWidth || pContext->pDepthTarget->mHeight != canvasTarget.pCurRT->mHeight)
+                        return;
+
+                    Pipeline* pPipeline = GetGlyphPipeline(*pContext, GLYPH_PROGRAM_WORLD);
+                    if (!pPipeline)
                         return;
 
-                    bool needsResize = false;
+                    Engine::Camera const& camera = *it.world().get<Engine::Camera>();
+                    glm::mat4 const viewProjection = camera.projection * camera.view;
+                    glm::mat4 const cameraWorld = glm::inverse(camera.view);
+                    glm::vec3 const cameraPosition = glm::vec3(cameraWorld[3]);
+                    glm::vec3 const cameraRight = glm::vec3(cameraWorld[0]);
+                    glm::vec3 const cameraUp = glm::vec3(cameraWorld[1]);
+
+                    // Frustum planes from the view projection rows (depth in [0, 1]), pointing inwards
+                    glm::vec4 rows[4];
+                    for (int r = 0; r < 4; ++r)
+                        rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+                    glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+                    for (glm::vec4& plane : planes)
+                        plane /= std::max(glm::length(glm::vec3(plane)), 1e-6f);
+
+                    pContext->worldLabels.clear();
+                    pContext->worldTextQuery.run([pContext, &cameraPosition, &planes](flecs::iter& it)
+                        {
+                            while (it.next())
+                            {
+                                auto worldTexts = it.field<WorldText const>(0);
+                                auto layouts = it.field<WorldGlyphLayout const>(1);
+
+                                for (size_t j : it)
+                                {
+                                    WorldText const& worldText = worldTexts[j];
+                                    WorldGlyphLayout const& layout = layouts[j];
+
+                                    if (!IsLayoutDrawable(*pContext, layout) || layout.lineHeight <= 0.f)
+                                        continue;
+
+                                    glm::vec3 const origin = glm::vec3(worldText.transform[3]);
+                                    float const distance = glm::length(origin - cameraPosition);
+                                    if (distance > worldText.maxDistance)
+                                        continue;
+
+                                    // Culled as a sphere around the origin enclosing its glyphs (whichever way it faces)
+                                    float const worldPerPixel = worldText.fontSize / layout.lineHeight;
+                                    float const extentX = std::max(std::abs(layout.minX), std::abs(layout.maxX)) * worldPerPixel * glm::length(glm::vec3(worldText.transform[0]));
+                                    float const extentY = std::max(std::abs(layout.minY), std::abs(layout.maxY)) * worldPerPixel * glm::length(glm::vec3(worldText.transform[1]));
+                                    float const radius = std::sqrt(extentX * extentX + extentY * extentY);
 
-                    if (!(pContext->width == canvas.width && pContext->height == canvas.height))
+                                    bool const isInView = std::all_of(std::begin(planes), std::end(planes),
+                                        [&origin, radius](glm::vec4 const& plane) { return glm::dot(glm::vec3(plane), origin) + plane.w >= -radius; });
+                                    if (!isInView)
+                                        continue;
+
+                                    pContext->worldLabels.push_back({ distance, &worldText, &layout });
+                                }
+                            }
+                        });
+
+                    if (pContext->worldLabels.empty())
+                        return;
+
+                    // Back to front, so blended glyph edges go over the labels behind them.  Only the nearest labels are drawn past MAX_WORLD_LABELS.
+                    std::sort(pContext->worldLabels.begin(), pContext->worldLabels.end(), [](WorldLabel const& a, WorldLabel const& b) { return a.distance > b.distance; });
+                    if (pContext->worldLabels.size() > MAX_WORLD_LABELS)
                     {
-                        pContext->width = canvas.width;
-                        pContext->height = canvas.height;
-                        needsResize = true;
+                        LOGF(eWARNING, "Too many world text labels to draw this frame, consider increasing MAX_WORLD_LABELS.");
+                        pContext->worldLabels.erase(pContext->worldLabels.begin(), pContext->worldLabels.end() - MAX_WORLD_LABELS);
                     }
 
-                    // Did content scale change?
-                    float contentScale = 1.f;
+                    uint32_t vertexCount = 0;
+                    for (WorldLabel const& label : pContext->worldLabels)
+                        vertexCount += static_cast<uint32_t>(label.pLayout->vertices.size());
+
+                    if (vertexCount == 0)
+                        return;
 
-                    SDL_DisplayID const dispId = SDL_GetDisplayForWindow(sdlWin.pWindow);
-                    if (dispId == 0)
+                    if (vertexCount > 4 * MAX_WORLD_GLYPHS)
                     {
-                        LOGF(eERROR, "SDL_GetDisplayForWindow() failed.");
+                        LOGF(eWARNING, "Too many world text glyphs to draw this frame, consider increasing MAX_WORLD_GLYPHS.");
+                        return;
                     }
-                    else
+
+                    // Single upload of the quads, labels back to back
+                    uint32_t const firstVertex = pRHI->frameIndex * 4 * MAX_WORLD_GLYPHS;
+                    BufferUpdateDesc update = { pContext->pWorldVertexBuffer, firstVertex * sizeof(GlyphVertex), vertexCount * sizeof(GlyphVertex) };
+                    beginUpdateResource(&update);
+                    GlyphVertex* pDst = static_cast<GlyphVertex*>(update.pMappedData);
+                    for (WorldLabel const& label : pContext->worldLabels)
                     {
-                        contentScale = SDL_GetDisplayContentScale(dispId);
+                        memcpy(pDst, label.pLayout->vertices.data(), label.pLayout->vertices.size() * sizeof(GlyphVertex));
+                        pDst += label.pLayout->vertices.size();
                     }
+                    endUpdateResource(&update);
 
-                    if (pContext->contentScale != contentScale)
+                    // Labels' transforms: font pixels to their plane in the world, then the camera's view projection.
+                    // fontstash3D.vert gives glyph positions a z of 1, the third column stays empty.
+                    uint32_t const firstUniform = pRHI->frameIndex * MAX_WORLD_LABELS;
+                    uint32_t const labelCount = static_cast<uint32_t>(pContext->worldLabels.size());
+                    BufferUpdateDesc uniformUpdate = { pContext->pWorldUniformBuffer, firstUniform * WORLD_UNIFORM_STRIDE, labelCount * WORLD_UNIFORM_STRIDE };
+                    beginUpdateResource(&uniformUpdate);
+                    for (uint32_t l = 0; l < labelCount; ++l)
                     {
-                        pContext->contentScale = contentScale;
-                        needsResize = true;
+                        WorldText const& worldText = *pContext->worldLabels[l].pText;
+                        WorldGlyphLayout const& layout = *pContext->worldLabels[l].pLayout;
+
+                        // Billboards face the camera, keeping only their scale
+                        float const worldPerPixel = worldText.fontSize / layout.lineHeight;
+                        glm::vec3 right = glm::vec3(worldText.transform[0]);
+                        glm::vec3 down = -glm::vec3(worldText.transform[1]);
+                        if (worldText.isBillboard)
+                        {
+                            right = cameraRight * glm::length(right);
+                            down = -cameraUp * glm::length(down);
+                        }
+                        right *= worldPerPixel;
+                        down *= worldPerPixel;
+
+                        glm::mat4 const labelToWorld = glm::mat4(glm::vec4(right, 0.f), glm::vec4(down, 0.f), glm::vec4(0.f), worldText.transform[3]);
+                        glm::mat4 const mvp = viewProjection * labelToWorld;
+                        memcpy(static_cast<uint8_t*>(uniformUpdate.pMappedData) + l * WORLD_UNIFORM_STRIDE, &mvp, sizeof(mvp));
                     }
+                    endUpdateResource(&uniformUpdate);
 
-                    if (needsResize)
-                        resizeFontSystem(pContext->width, pContext->height, pContext->contentScale);
-                }
-            );
+                    Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
+                    ASSERT(pCmd);
+
+                    auto world = it.world();
+                    if (!RenderGraph::BeginPass(world, pCmd, pContext->worldRenderPass, canvasTarget))
+                        return;
+
+                    cmdBeginDebugMarker(pCmd, 1, 0, 1, "FontRendering::RenderWorld");
+
+                    GlyphProgram const& program = pContext->programs[GLYPH_PROGRAM_WORLD];
+                    uint32_t const stride = sizeof(GlyphVertex);
+                    uint64_t const vertexOffset = 0;
+                    cmdBindPipeline(pCmd, pPipeline);
+                    cmdBindVertexBuffer(pCmd, 1, &pContext->pWorldVertexBuffer, &stride, &vertexOffset);
+                    cmdBindIndexBuffer(pCmd, pContext->indexBuffer.pBuffer, INDEX_TYPE_UINT16, pContext->indexBuffer.offset);
+
+                    // A draw per label, with its page, transform and color
+                    uint32_t labelFirstVertex = firstVertex;
+                    for (uint32_t l = 0; l < labelCount; ++l)
+                    {
+                        WorldText const& worldText = *pContext->worldLabels[l].pText;
+                        WorldGlyphLayout const& layout = *pContext->worldLabels[l].pLayout;
+                        uint32_t const labelVertexCount = static_cast<uint32_t>(layout.vertices.size());
+                        if (labelVertexCount == 0)
+                            continue;
 
-        auto fontRenderer = ecs.system<Engine::Canvas, Window::SDLWindow>("Font Renderer")
+                        DescriptorDataRange range = { (firstUniform + l) * WORLD_UNIFORM_STRIDE, static_cast<uint32_t>(sizeof(glm::mat4)) };
+                        DescriptorData params[1] = {};
+                        params[0].pName = "uniformBlock_rootcbv";
+                        params[0].ppBuffers = &pContext->pWorldUniformBuffer;
+                        params[0].pRanges = &range;
+                        cmdBindDescriptorSetWithRootCbvs(pCmd, GetAtlasPageSet(*pContext, GLYPH_PROGRAM_WORLD, *pRHI, layout.page), program.pDescriptorSetTexture, 1, params);
+
+                        // WorldText colors are 0xAABBGGRR
+                        WorldTextConstants constants = {};
+                        for (uint32_t c = 0; c < 4; ++c)
+                            constants.color[c] = ((worldText.color >> (c * 8)) & 0xFF) / 255.f;
+                        constants.scaleBias[0] = 1.f;
+                        constants.scaleBias[1] = 1.f;
+                        cmdBindPushConstants(pCmd, program.pRootSignature, program.rootConstantIndex, &constants);
+
+                        cmdDrawIndexed(pCmd, labelVertexCount / 4 * 6, 0, labelFirstVertex);
+                        labelFirstVertex += labelVertexCount;
+                    }
+
+                    cmdEndDebugMarker(pCmd);
+                    RenderGraph::EndPass(world, pCmd, pContext->worldRenderPass);
+                });
+
+        // Draws every text in one go: quads of all texts are appended to the frame's vertex buffer region grouped by atlas page, with one draw per page.
+        // Text outside of the canvas (or its clip rect) is culled with its layout bounds, before going through its quads.
+        auto fontRenderer = ecs.system<Engine::Canvas, RenderGraph::CanvasTarget>("Font Renderer")
             .kind(Engine::GetCustomPhaseEntity(ecs, Engine::FONTS_RENDER))
-            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, RenderGraph::CanvasTarget const& canvasTarget)
                 {
-                    ASSERTMSG(i == 0, "Drawing to more than one window not implemented.");
+                    // Text is laid out for the main window, other windows don't get any (offscreen canvases do)
+                    if (it.entity(i).has<Window::SDLWindow>() && !it.entity(i).has<Window::MainWindowTag>())
+                        return;
 
                     if (!it.world().has<Context>())
                         return;
 
-                    Context const* pContext = it.world().get<Context>();
-                    if (!pContext->isInitialized)
+                    Context* pContext = it.world().get_mut<Context>();
+                    if (!pContext->isInitialized || pContext->atlasPages.empty())
                         return;
 
                     RHI::RHI const* pRHI = it.world().has<RHI::RHI>() ? it.world().get<RHI::RHI>() : nullptr;
@@ -193,73 +2105,199 @@ namespace FontRendering
                     if (!pRHI)
                         return;
 
-                    if (!sdlWin.pCurRT)
+                    if (!canvasTarget.pCurRT || canvas.width == 0 || canvas.height == 0)
                         return;
 
-                    Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
-                    ASSERT(pCmd);
+                    // Nothing is drawn until the pipeline is compiled
+                    Pipeline* pPipeline = GetGlyphPipeline(*pContext, GLYPH_PROGRAM_BITMAP);
+                    if (!pPipeline)
+                        return;
+
+                    // Quads are moved to the text's position and converted to clip space as they're gathered
+                    float const toClipX = 2.f / canvas.width;
+                    float const toClipY = -2.f / canvas.height;
 
+                    pContext->pageVertices.resize(pContext->atlasPages.size());
+                    for (std::vector<GlyphVertex>& vertices : pContext->pageVertices)
+                        vertices.clear();
 
-                    unsigned int runIterations = 0;
+                    float const canvasWidth = static_cast<float>(canvas.width);
+                    float const canvasHeight = static_cast<float>(canvas.height);
 
-                    pContext->fontTextQuery.run([pContext, pRHI, pCmd, &runIterations, sdlWin, canvas](flecs::iter& it)
+                    pContext->fontTextQuery.run([pContext, toClipX, toClipY, canvasWidth, canvasHeight](flecs::iter& it)
                         {
                             while (it.next())
                             {
-
                                 auto fontTexts = it.field<FontText const>(0);
+                                auto layouts = it.field<GlyphLayout const>(1);
+                                bool const hasClipRects = it.is_set(2);
 
                                 for (size_t j : it)
                                 {
-                                    if (runIterations == 0) // on first iteration, setup the render pass
+                                    FontText const& fontText = fontTexts[j];
+                                    GlyphLayout const& layout = layouts[j];
+
+                                    if (!IsLayoutDrawable(*pContext, layout))
+                                        continue;
+
+                                    float clipMinX = 0.f;
+                                    float clipMinY = 0.f;
+                                    float clipMaxX = canvasWidth;
+                                    float clipMaxY = canvasHeight;
+                                    if (hasClipRects)
                                     {
-                                        cmdBeginDebugMarker(pCmd, 1, 0, 1, "FontRendering::Render");
-
-                                        BindRenderTargetsDesc bindRenderTargets = {};
-                                        bindRenderTargets.mRenderTargetCount = 1;
-                                        bindRenderTargets.mRenderTargets[0] = { sdlWin.pCurRT, LOAD_ACTION_LOAD };
-                                        cmdBindRenderTargets(pCmd, &bindRenderTargets);
-                                        cmdSetViewport(pCmd, 0.0f, 0.0f, (float)canvas.width, (float)canvas.height, 0.0f, 1.0f);
-                                        cmdSetScissor(pCmd, 0, 0, canvas.width, canvas.height);
+                                        FontTextClipRect const& clipRect = it.field<FontTextClipRect const>(2)[j];
+                                        clipMinX = std::max(clipMinX, clipRect.posX);
+                                        clipMinY = std::max(clipMinY, clipRect.posY);
+                                        clipMaxX = std::min(clipMaxX, clipRect.posX + clipRect.width);
+                                        clipMaxY = std::min(clipMaxY, clipRect.posY + clipRect.height);
                                     }
 
-                                    // Validate incoming data
-                                    if (pContext->fontNameToIdMap.find(fontTexts[j].font) == pContext->fontNameToIdMap.end())
+                                    float const minX = layout.minX + fontText.posX;
+                                    float const minY = layout.minY + fontText.posY;
+                                    float const maxX = layout.maxX + fontText.posX;
+                                    float const maxY = layout.maxY + fontText.posY;
+                                    if (maxX <= clipMinX || minX >= clipMaxX || maxY <= clipMinY || minY >= clipMaxY)
+                                        continue;
+
+                                    // Only glyphs of text straddling a clip rect edge need cutting (the canvas' edges are left to the rasterizer)
+                                    bool const needsClipping = hasClipRects && (minX < clipMinX || minY < clipMinY || maxX > clipMaxX || maxY > clipMaxY);
+
+                                    // FontText colors are 0xAABBGGRR, same as the vertex color layout
+                                    std::vector<GlyphVertex>& vertices = pContext->pageVertices[layout.page];
+                                    if (!needsClipping)
                                     {
-                                        LOGF(eWARNING, "Could not find font ID for entity FontText component.");
-                                        return;
+                                        for (GlyphVertex const& vertex : layout.vertices)
+                                            vertices.push_back({ (vertex.x + fontText.posX) * toClipX - 1.f, (vertex.y + fontText.posY) * toClipY + 1.f, vertex.u, vertex.v, fontText.color });
+                                        continue;
                                     }
 
-                                    FontDrawDesc desc = {};
-                                    desc.mFontBlur = fontTexts[j].fontBlur;
-                                    desc.mFontColor = fontTexts[j].color;
-                                    desc.mFontID = pContext->fontNameToIdMap.at(fontTexts[j].font);
-                                    desc.mFontSize = fontTexts[j].fontSize;
-                                    desc.mFontSpacing = fontTexts[j].fontSpacing;
-                                    desc.pText = fontTexts[j].text.c_str();
+                                    for (size_t v = 0; v + 4 <= layout.vertices.size(); v += 4)
+                                    {
+                                        GlyphVertex quad[4];
+                                        for (uint32_t q = 0; q < 4; ++q)
+                                        {
+                                            quad[q] = layout.vertices[v + q];
+                                            quad[q].x += fontText.posX;
+                                            quad[q].y += fontText.posY;
+                                        }
 
-                                    cmdDrawTextWithFont(pCmd, { fontTexts[j].posX, fontTexts[j].posY }, &desc);
+                                        if (!ClipGlyphQuad(quad, clipMinX, clipMinY, clipMaxX, clipMaxY))
+                                            continue;
 
-                                    runIterations += 1;
+                                        for (GlyphVertex const& vertex : quad)
+                                            vertices.push_back({ vertex.x * toClipX - 1.f, vertex.y * toClipY + 1.f, vertex.u, vertex.v, fontText.color });
+                                    }
                                 }
                             }
                         });
 
-                    if (runIterations > 0) // need to clean things up if anything was ran
+                    uint32_t vertexCount = 0;
+                    for (std::vector<GlyphVertex> const& vertices : pContext->pageVertices)
+                        vertexCount += static_cast<uint32_t>(vertices.size());
+
+                    if (vertexCount == 0)
+                        return;
+
+                    if (pContext->frameVertexCountFrame != pRHI->frameCount)
+                    {
+                        pContext->frameVertexCountFrame = pRHI->frameCount;
+                        pContext->frameVertexCount = 0;
+                    }
+
+                    if (pContext->frameVertexCount + vertexCount > 4 * MAX_GLYPHS)
+                    {
+                        LOGF(eWARNING, "Too many glyphs to draw this frame, consider increasing MAX_GLYPHS.");
+                        return;
+                    }
+
+                    // Single upload, pages back to back
+                    uint32_t const firstVertex = pRHI->frameIndex * 4 * MAX_GLYPHS + pContext->frameVertexCount;
+                    BufferUpdateDesc update = { pContext->pVertexBuffer, firstVertex * sizeof(GlyphVertex), vertexCount * sizeof(GlyphVertex) };
+                    beginUpdateResource(&update);
+                    GlyphVertex* pDst = static_cast<GlyphVertex*>(update.pMappedData);
+                    for (std::vector<GlyphVertex> const& vertices : pContext->pageVertices)
+                    {
+                        memcpy(pDst, vertices.data(), vertices.size() * sizeof(GlyphVertex));
+                        pDst += vertices.size();
+                    }
+                    endUpdateResource(&update);
+
+                    pContext->frameVertexCount += vertexCount;
+
+                    Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
+                    ASSERT(pCmd);
+
+                    auto world = it.world();
+                    if (!RenderGraph::BeginPass(world, pCmd, pContext->renderPass, canvasTarget))
+                        return;
+
+                    cmdBeginDebugMarker(pCmd, 1, 0, 1, "FontRendering::Render");
+
+                    GlyphProgram& program = pContext->programs[GLYPH_PROGRAM_BITMAP];
+                    uint32_t const stride = sizeof(GlyphVertex);
+                    uint64_t const vertexOffset = 0;
+                    cmdBindPipeline(pCmd, pPipeline);
+                    cmdBindDescriptorSet(pCmd, 0, program.pDescriptorSetUniforms);
+                    cmdBindVertexBuffer(pCmd, 1, &pContext->pVertexBuffer, &stride, &vertexOffset);
+                    cmdBindIndexBuffer(pCmd, pContext->indexBuffer.pBuffer, INDEX_TYPE_UINT16, pContext->indexBuffer.offset);
+
+                    uint32_t pageFirstVertex = firstVertex;
+                    for (uint32_t p = 0; p < pContext->pageVertices.size(); ++p)
                     {
-                        cmdBindRenderTargets(pCmd, nullptr);
-                        cmdEndDebugMarker(pCmd);
+                        uint32_t const pageVertexCount = static_cast<uint32_t>(pContext->pageVertices[p].size());
+                        if (pageVertexCount == 0)
+                            continue;
+
+                        cmdBindDescriptorSet(pCmd, GetAtlasPageSet(*pContext, GLYPH_PROGRAM_BITMAP, *pRHI, p), program.pDescriptorSetTexture);
+                        cmdDrawIndexed(pCmd, pageVertexCount / 4 * 6, 0, pageFirstVertex);
+                        pageFirstVertex += pageVertexCount;
                     }
+
+                    cmdEndDebugMarker(pCmd);
+                    RenderGraph::EndPass(world, pCmd, pContext->renderPass);
                 });
     }
 
     void module::OnExit(flecs::world& ecs)
     {
         RHI::RHI const* pRHI = ecs.has<RHI::RHI>() ? ecs.get<RHI::RHI>() : nullptr;
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+
+        // The loader thread could still be reading a font file
+        if (pContext && pContext->pFileLoader)
+        {
+            pContext->pFileLoader->Stop();
+            pContext->pFileLoader.reset();
+        }
 
         if (pRHI && pRHI->pRenderer)
         {
-            exitFontSystem();
+            if (pContext && pContext->isInitialized)
+            {
+                waitQueueIdle(pRHI->pGfxQueue);
+
+                RemoveDepthTarget(ecs, *pRHI, *pContext);
+                RemoveGlyphResources(*pRHI, *pContext);
+
+                for (AtlasPage& page : pContext->atlasPages)
+                {
+                    if (page.pTexture)
+                        removeResource(page.pTexture);
+                    IM_DELETE(page.pAtlas);
+                }
+                pContext->atlasPages.clear();
+
+                for (RetiredTexture const& retired : pContext->retiredTextures)
+                    removeResource(retired.pTexture);
+                pContext->retiredTextures.clear();
+
+                if (pContext->baseAtlas.pTexture)
+                    removeResource(pContext->baseAtlas.pTexture);
+                IM_DELETE(pContext->baseAtlas.pAtlas);
+                pContext->baseAtlas = {};
+                pContext->isInitialized = false;
+            }
         }
         else
         {
@@ -267,44 +2305,172 @@ namespace FontRendering
         }
     }
 
-    void MeasureText(flecs::world const& ecs, FontText const& fontText, float& xOut, float& yOut)
+    // Measures text with another rasterized size of its font (eg. right after a content scale or font size change), leaves the size as is
+    // if there's none
+    static void EstimateText(Context const& context, FontText const& fontText, float& xOut, float& yOut)
+    {
+        FontId const fontId = ResolveFont(context, fontText.font);
+        for (auto it = context.loadedFonts.lower_bound({ fontId, 0, 0 }); it != context.loadedFonts.end() && it->first.font == fontId; ++it)
+        {
+            ImFont* pFont = it->second.pFont;
+            if (!pFont || pFont->FontSize <= 0.f)
+                continue;
+
+            float const scale = fontText.fontSize * context.contentScale / pFont->FontSize;
+            xOut = LayoutGlyphs(*pFont, scale, fontText.text.View(), fontText.fontSpacing * context.contentScale, nullptr);
+            yOut = pFont->FontSize * scale;
+            return;
+        }
+    }
+
+    static void MeasureText(Context& context, FontText const& fontText, float& xOut, float& yOut)
     {
         xOut = 0.f;
         yOut = 0.f;
 
-        if (!ecs.has<Context>())
+        MeasureCache::Key const key = MeasureCache::MakeKey(fontText, context.contentScale);
+        if (context.measureCache.Find(key, xOut, yOut))
             return;
 
-        Context const* pContext = ecs.get<Context>();
-        if (!pContext->isInitialized)
+        // Measured the same way text gets laid out, estimated until the font is rasterized (not cached until then)
+        ImFont* pFont = FindFont(context, fontText);
+        if (!pFont)
+        {
+            EstimateText(context, fontText, xOut, yOut);
+            return;
+        }
+
+        xOut = LayoutGlyphs(*pFont, 1.f, fontText.text.View(), fontText.fontSpacing * context.contentScale, nullptr);
+        yOut = pFont->FontSize;
+        context.measureCache.Add(key, xOut, yOut);
+    }
+
+    void MeasureText(flecs::world& ecs, FontText const& fontText, float& xOut, float& yOut)
+    {
+        xOut = 0.f;
+        yOut = 0.f;
+
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext || !pContext->isInitialized)
             return;
 
-        FontDrawDesc desc = {};
-        desc.mFontBlur = fontText.fontBlur;
-        desc.mFontColor = fontText.color;
-        desc.mFontID = pContext->fontNameToIdMap.at(fontText.font);
-        desc.mFontSize = fontText.fontSize;
-        desc.mFontSpacing = fontText.fontSpacing;
-        desc.pText = fontText.text.c_str();
+        MeasureText(*pContext, fontText, xOut, yOut);
+    }
+
+    void MeasureTexts(flecs::world& ecs, FontText const* pFontTexts, unsigned int const count, float* pXOut, float* pYOut)
+    {
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        bool const isReady = pContext && pContext->isInitialized;
+
+        for (unsigned int t = 0; t < count; ++t)
+        {
+            if (isReady)
+            {
+                MeasureText(*pContext, pFontTexts[t], pXOut[t], pYOut[t]);
+            }
+            else
+            {
+                pXOut[t] = 0.f;
+                pYOut[t] = 0.f;
+            }
+        }
+    }
 
-        auto sizes = fntMeasureFontText(fontText.text.c_str(), &desc);
+    bool HasFont(flecs::world& ecs, FontId const font)
+    {
+        Context const* pContext = ecs.has<Context>() ? ecs.get<Context>() : nullptr;
+        if (!pContext || !pContext->isInitialized)
+            return false;
 
-        xOut = sizes.x;
-        yOut = sizes.y;
+        return pContext->fonts.find(ResolveFont(*pContext, font)) != pContext->fonts.end();
     }
 
-    uint32_t InternalId(flecs::world& ecs, eAvailableFonts const font)
+    ImFont* GetOrAddAtlasFont(flecs::world& ecs, FontId const font, unsigned int const pixelSize)
     {
-        if (!ecs.has<Context>())
-            return 0;
+        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        if (!pContext || !pContext->isInitialized)
+            return nullptr;
 
-        Context const* pContext = ecs.get<Context>();
-        if (!pContext->isInitialized)
-            return 0;
+        return FindFont(*pContext, { font, std::max(1u, pixelSize) });
+    }
+
+    ImFontAtlas* SharedAtlas(flecs::world& ecs)
+    {
+        Context const* pContext = ecs.has<Context>() ? ecs.get<Context>() : nullptr;
+        if (!pContext || !pContext->isInitialized)
+            return nullptr;
+
+        return pContext->baseAtlas.pAtlas;
+    }
+
+    TextHandle::TextHandle(std::string_view const text)
+        : id(TextPool::Get().Intern(text))
+    {
+    }
+
+    TextHandle::TextHandle(TextHandle const& other)
+        : id(other.id)
+    {
+        TextPool::Get().AddRef(id);
+    }
+
+    TextHandle& TextHandle::operator=(TextHandle const& other)
+    {
+        if (id != other.id)
+        {
+            TextPool::Get().AddRef(other.id);
+            TextPool::Get().Release(id);
+            id = other.id;
+        }
+        return *this;
+    }
 
-        // All available fonts should be loaded at init time
-        ASSERT(pContext->fontNameToIdMap.find(font) != pContext->fontNameToIdMap.end());
+    TextHandle& TextHandle::operator=(TextHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            TextPool::Get().Release(id);
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    }
+
+    TextHandle::~TextHandle()
+    {
+        TextPool::Get().Release(id);
+    }
+
+    TextHandle TextHandle::FromNumber(int64_t const value)
+    {
+        TextPool& pool = TextPool::Get();
+        bool const isSmall = value >= 0 && value < TextPool::SMALL_NUMBER_COUNT;
+
+        TextHandle handle;
+        if (isSmall)
+        {
+            handle.id = pool.smallNumbers[value].load(std::memory_order_acquire);
+            if (handle.id != 0)
+            {
+                pool.AddRef(handle.id);
+                return handle;
+            }
+        }
 
-        return pContext->fontNameToIdMap.at(font);
+        // Formatted on the stack, only looked up (and copied to the pool the first time)
+        char buffer[24];
+        std::to_chars_result const result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        handle.id = pool.Intern(std::string_view(buffer, result.ptr - buffer));
+
+        // The cache keeps its own reference, the first thread to get there sets it
+        uint32_t expected = 0;
+        if (isSmall && pool.smallNumbers[value].compare_exchange_strong(expected, handle.id, std::memory_order_acq_rel))
+            pool.AddRef(handle.id);
+        return handle;
+    }
+
+    std::string_view TextHandle::View() const
+    {
+        return id == 0 ? std::string_view("", 0) : TextPool::Get().View(id);
     }
 }
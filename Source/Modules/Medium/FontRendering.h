@@ -1,60 +1,119 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <flecs.h>
+#include <glm/glm.hpp>
 #include "LifeCycledModule.h"
 
 // Implemented features:
 // - [X] Using different fonts (and sizes)
 // - [X] Address non 1x DPI scale at init time (including fonts)
 // - [X] Address DPI changes at runtime (OS settings change and per monitor)
+// - [X] Glyph layouts cached per text, only redone when its FontText is modified
+// - [X] Measurements cached (LRU), batch measuring for layouting many labels
+// - [X] All text drawn in one batch (a draw per glyph atlas page)
+// - [X] Fonts listed in a manifest, loaded on first use (off the main thread) and released when unused
+// - [X] Blurred text (glyphs are rasterized blurred)
+// - [X] Glyph atlas shared with the UI (imgui fonts are rasterized in the same pages as text)
+// - [X] Text outside of the canvas (or its clip rect) is culled before its glyphs get drawn
+// - [X] World space text (eg. name plates), drawn with The-Forge's fontstash shaders from a single vertex buffer, depth tested and culled by distance
+// - [X] Interned text (TextHandle): text components are cheaply copied and compared, reading text doesn't lock, formatting numbers doesn't allocate
+
+struct ImFont;
+struct ImFontAtlas;
 
 namespace FontRendering
 {
-	// List of available fonts (by name)
-	// TODO: make this flexible so we don't have to recompile when available fonts assets change
-	enum eAvailableFonts
+	// Fonts are listed in the fonts manifest (Assets/Fonts/Fonts.manifest) and addressed by name, or rather its hash.
+	// New fonts only need a manifest entry.  Font files are loaded on first use and released once unused for a while.
+	typedef uint32_t FontId;
+
+	// Hash of a font name (FNV-1a), usable at compile time (eg. MakeFontId("Crimson-Roman"))
+	constexpr FontId MakeFontId(std::string_view const name)
+	{
+		FontId hash = 2166136261u;
+		for (char const c : name)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	FontId const DEFAULT_FONT = 0; // first font of the manifest
+	FontId const BUILTIN_FONT = MakeFontId("ProggyClean"); // imgui's built-in font, always available (bitmap only)
+
+	// Handle to an interned string, the text of FontText and WorldText.
+	// Strings are interned in a process wide pool: equal strings share a handle, which holds a reference to it.  Comparing text is comparing
+	// handles and copying a component doesn't copy its text.  Strings are freed along with their last handle.
+	class TextHandle
 	{
-		// Comic Relief
-		COMIC_RELIEF,
-		COMIC_RELIEF_BOLD,
-
-		// Crimson
-		CRIMSON_BOLD,
-		CRIMSON_BOLD_ITALIC,
-		CRIMSON_ITALIC,
-		CRIMSON_ROMAN,
-		CROMSON_SEMI_BOLD,
-		CRIMSON_SEMI_BOLD_ITALIC,
-
-		// Hermeneus One
-		HERMENEUS_ONE,
-
-		// Inconsolata LGC
-		INCONSOLATA_LGC,
-		INCONSOLATA_LGC_BOLD,
-		INCONSOLATA_LGC_BOLD_ITALIC,
-		INCONSOLATA_LGC_ITALIC,
-
-		// Titillium Text
-		TITILLIUM_TEXT_BOLD,
-
-		NUM_AVAILABLE_FONTS
+	public:
+		TextHandle() = default;
+		TextHandle(std::string_view const text);
+		TextHandle(char const* pText) : TextHandle(std::string_view(pText)) {}
+		TextHandle(std::string const& text) : TextHandle(std::string_view(text)) {}
+		TextHandle(TextHandle const& other);
+		TextHandle(TextHandle&& other) noexcept : id(other.id) { other.id = 0; }
+		TextHandle& operator=(TextHandle const& other);
+		TextHandle& operator=(TextHandle&& other) noexcept;
+		~TextHandle();
+
+		// Formats a number without allocating (small ones don't even look the pool up after their first use)
+		static TextHandle FromNumber(int64_t const value);
+
+		std::string_view View() const;
+		char const* CStr() const { return View().data(); } // null terminated
+		bool IsEmpty() const { return id == 0; }
+		uint32_t Id() const { return id; }
+
+		bool operator==(TextHandle const& other) const = default;
+
+	private:
+		uint32_t id = 0; // 0 is the empty string
 	};
 
 	// Component to draw font text
 	struct FontText
 	{
-		std::string text = "";
-		eAvailableFonts font = static_cast<eAvailableFonts>(0);
+		TextHandle text;
+		FontId font = DEFAULT_FONT;
 		unsigned int color = 0xFFFFFFFF;
 		float fontSize = 16.f;
 		float fontSpacing = 0.f;
-		float fontBlur = 0.f;
+		float fontBlur = 0.f; // in pixels, imgui's built-in font doesn't blur
 		float posX = 0.f;
 		float posY = 0.f;
 	};
 
+	// Optional component clipping a FontText to a rect (eg. rows of a scrolling list), in the same units as the text position.
+	// Text entirely outside of it is skipped, glyphs straddling its edges are cut.
+	struct FontTextClipRect
+	{
+		float posX = 0.f;
+		float posY = 0.f;
+		float width = 0.f;
+		float height = 0.f;
+	};
+
+	// Component to draw text in the world (eg. name plates), seen from the Engine::Camera singleton.
+	// Text is laid out in the transform's XY plane (+Y up), centered on its origin and sitting on it, sized in world units.
+	// Labels are depth tested against each other and culled once further than maxDistance from the camera (or out of its view).
+	struct WorldText
+	{
+		TextHandle text;
+		FontId font = DEFAULT_FONT;
+		unsigned int color = 0xFFFFFFFF;
+		float fontSize = 0.25f; // line height
+		float fontSpacing = 0.f;
+		float fontBlur = 0.f; // in world units, imgui's built-in font doesn't blur
+		glm::mat4 transform = glm::mat4(1.f);
+		float maxDistance = 100.f;
+		bool isBillboard = true; // faces the camera, only the transform's translation and scale are used
+	};
+
 	class module : public LifeCycledModule
 	{
 	public:
@@ -63,6 +122,18 @@ namespace FontRendering
 	};
 
 	// Utilities
-	void MeasureText(flecs::world const& ecs, FontText const& fontText, float& xOut, float& yOut);
-	unsigned int InternalId(flecs::world& ecs, eAvailableFonts const font);
+	// Measuring queues the text's font to be rasterized if it isn't yet.  Meanwhile, text is measured with another rasterized size of its font
+	// (0 if there's none), measurements are cached once it is.
+	void MeasureText(flecs::world& ecs, FontText const& fontText, float& xOut, float& yOut);
+	// Measures count texts at once, sizes are returned in the pXOut and pYOut arrays (count elements each)
+	void MeasureTexts(flecs::world& ecs, FontText const* pFontTexts, unsigned int const count, float* pXOut, float* pYOut);
+	bool HasFont(flecs::world& ecs, FontId const font);
+
+	// Glyph atlas service for the UI.  imgui's fonts are rasterized in the same atlas pages as text, so a font used at the same pixel size
+	// by both has its glyphs rasterized and uploaded once (their TexID is their page's texture).
+	// Pages get rebuilt at the start of the frame (OnLoad, before the UI starts its own): fonts returned stay valid until the next frame.
+	// Returns the font rasterized at pixelSize, or queues it to be and returns nullptr (also if it's not in the manifest).
+	ImFont* GetOrAddAtlasFont(flecs::world& ecs, FontId const font, unsigned int const pixelSize);
+	// Atlas for imgui's context (io.Fonts), only holding its built-in font at its base size for frames to start with, nullptr until initialized
+	ImFontAtlas* SharedAtlas(flecs::world& ecs);
 }
@@ -1,6 +1,4 @@
-#include <set>
-#include <map>
-#include <utility> // For std::pair
+#include <algorithm>
 
 #include <imgui.h>
 
@@ -8,7 +6,9 @@
 #include <Graphics/GraphicsConfig.h>
 
 #include "Low/Engine.h"
+#include "Low/Inputs.h"
 #include "Low/RHI.h"
+#include "Low/RenderGraph.h"
 #include "Low/Window.h"
 
 #include "imgui_impl_sdl3.h"
@@ -16,14 +16,8 @@
 
 #include "UI.h"
 
-#define DEFAULT_IMGUI_FONT_ID UINT_MAX
 #define DEFAULT_IMGUI_FONT_SIZE 13.f
 
-// Functions not accessible via normal interface header
-// Forward declare before namespace
-extern void* fntGetRawFontData(uint32_t fontID);
-extern uint32_t fntGetRawFontDataSize(uint32_t fontID);
-
 namespace UI
 {
     struct Context
@@ -31,31 +25,167 @@ namespace UI
         bool isInitialized = false;
         float contentScale = 1.f;
 
-        std::map<std::pair<unsigned int, unsigned int>, ImFont*> loadedFonts; // <fontId, size> -> ImFont*
-        std::set<std::pair<unsigned int, unsigned int>> fontsToLoad; // <fontId, size>
+        flecs::entity renderPass;
     };
 
+    // Gamepads are read from the inputs snapshot instead of being polled again by the SDL backend (see imconfig.h).
+    // Like the backend, all connected gamepads are merged.
+    static void FeedGamepads(Inputs::InputSnapshot const& snapshot)
+    {
+        ImGuiIO& io = ImGui::GetIO();
+        if ((io.ConfigFlags & ImGuiConfigFlags_NavEnableGamepad) == 0)
+            return;
+
+        io.BackendFlags &= ~ImGuiBackendFlags_HasGamepad;
+        if (snapshot.cur.gamepadConnected.none())
+            return;
+        io.BackendFlags |= ImGuiBackendFlags_HasGamepad;
+
+        struct ButtonKey { ImGuiKey key; SDL_GamepadButton button; };
+        static ButtonKey const buttonKeys[] =
+        {
+            { ImGuiKey_GamepadStart, SDL_GAMEPAD_BUTTON_START },
+            { ImGuiKey_GamepadBack, SDL_GAMEPAD_BUTTON_BACK },
+            { ImGuiKey_GamepadFaceLeft, SDL_GAMEPAD_BUTTON_WEST },
+            { ImGuiKey_GamepadFaceRight, SDL_GAMEPAD_BUTTON_EAST },
+            { ImGuiKey_GamepadFaceUp, SDL_GAMEPAD_BUTTON_NORTH },
+            { ImGuiKey_GamepadFaceDown, SDL_GAMEPAD_BUTTON_SOUTH },
+            { ImGuiKey_GamepadDpadLeft, SDL_GAMEPAD_BUTTON_DPAD_LEFT },
+            { ImGuiKey_GamepadDpadRight, SDL_GAMEPAD_BUTTON_DPAD_RIGHT },
+            { ImGuiKey_GamepadDpadUp, SDL_GAMEPAD_BUTTON_DPAD_UP },
+            { ImGuiKey_GamepadDpadDown, SDL_GAMEPAD_BUTTON_DPAD_DOWN },
+            { ImGuiKey_GamepadL1, SDL_GAMEPAD_BUTTON_LEFT_SHOULDER },
+            { ImGuiKey_GamepadR1, SDL_GAMEPAD_BUTTON_RIGHT_SHOULDER },
+            { ImGuiKey_GamepadL3, SDL_GAMEPAD_BUTTON_LEFT_STICK },
+            { ImGuiKey_GamepadR3, SDL_GAMEPAD_BUTTON_RIGHT_STICK },
+        };
+
+        for (ButtonKey const& buttonKey : buttonKeys)
+            io.AddKeyEvent(buttonKey.key, snapshot.GamepadsHolding(buttonKey.button).any());
+
+        // Axes map to [0, 1] analog keys, sticks past a dead zone (same one as the SDL backend)
+        struct AxisKey { ImGuiKey key; SDL_GamepadAxis axis; float v0; float v1; };
+        float const deadZone = 8000.f / SDL_JOYSTICK_AXIS_MAX;
+        AxisKey const axisKeys[] =
+        {
+            { ImGuiKey_GamepadL2, SDL_GAMEPAD_AXIS_LEFT_TRIGGER, 0.f, 1.f },
+            { ImGuiKey_GamepadR2, SDL_GAMEPAD_AXIS_RIGHT_TRIGGER, 0.f, 1.f },
+            { ImGuiKey_GamepadLStickLeft, SDL_GAMEPAD_AXIS_LEFTX, -deadZone, -1.f },
+            { ImGuiKey_GamepadLStickRight, SDL_GAMEPAD_AXIS_LEFTX, deadZone, 1.f },
+            { ImGuiKey_GamepadLStickUp, SDL_GAMEPAD_AXIS_LEFTY, -deadZone, -1.f },
+            { ImGuiKey_GamepadLStickDown, SDL_GAMEPAD_AXIS_LEFTY, deadZone, 1.f },
+            { ImGuiKey_GamepadRStickLeft, SDL_GAMEPAD_AXIS_RIGHTX, -deadZone, -1.f },
+            { ImGuiKey_GamepadRStickRight, SDL_GAMEPAD_AXIS_RIGHTX, deadZone, 1.f },
+            { ImGuiKey_GamepadRStickUp, SDL_GAMEPAD_AXIS_RIGHTY, -deadZone, -1.f },
+            { ImGuiKey_GamepadRStickDown, SDL_GAMEPAD_AXIS_RIGHTY, deadZone, 1.f },
+        };
+
+        for (AxisKey const& axisKey : axisKeys)
+        {
+            float merged = 0.f;
+            float const* pValues = snapshot.cur.gamepadAxes[axisKey.axis];
+            for (unsigned int g = 0; g < Inputs::InputSnapshot::MAX_GAMEPADS; ++g)
+            {
+                if (snapshot.cur.gamepadConnected[g])
+                    merged = std::max(merged, std::min(1.f, std::max(0.f, (pValues[g] - axisKey.v0) / (axisKey.v1 - axisKey.v0))));
+            }
+            io.AddKeyAnalogEvent(axisKey.key, merged > 0.1f, merged);
+        }
+    }
+
+    // While replaying, the recorded keyboard and mouse events are handed to the SDL backend as if they came from the main window.
+    // Text input isn't part of recordings.
+    static void FeedReplayedInputs(flecs::world& ecs)
+    {
+        Inputs::KeyboardEvents const* pKbEvents = ecs.has<Inputs::KeyboardEvents>() ? ecs.get<Inputs::KeyboardEvents>() : nullptr;
+        Inputs::MouseEvents const* pMouseEvents = ecs.has<Inputs::MouseEvents>() ? ecs.get<Inputs::MouseEvents>() : nullptr;
+        Inputs::InputSnapshot const* pSnapshot = ecs.has<Inputs::InputSnapshot>() ? ecs.get<Inputs::InputSnapshot>() : nullptr;
+        Window::SDLWindow const* pMainWindow = nullptr;
+        if (!pKbEvents || !pMouseEvents || !pSnapshot || ecs.count<Window::MainWindowTag>() == 0 || !Window::MainWindow(ecs, &pMainWindow))
+            return;
+
+        SDL_WindowID const windowId = SDL_GetWindowID(pMainWindow->pWindow);
+
+        for (Inputs::KeyEvent const& kbEvent : pKbEvents->events)
+        {
+            SDL_Event sdlEvent = {};
+            sdlEvent.type = kbEvent.isDown ? SDL_EVENT_KEY_DOWN : SDL_EVENT_KEY_UP;
+            sdlEvent.key.timestamp = kbEvent.timestampNS;
+            sdlEvent.key.windowID = windowId;
+            sdlEvent.key.scancode = kbEvent.scanCode;
+            sdlEvent.key.key = kbEvent.keyCode;
+            sdlEvent.key.mod = kbEvent.keyMod;
+            sdlEvent.key.down = kbEvent.isDown;
+            sdlEvent.key.repeat = kbEvent.isRepeat;
+            ImGui_ImplSDL3_ProcessEvent(&sdlEvent);
+        }
+
+        for (Inputs::MouseEvent const& mouseEvent : pMouseEvents->events)
+        {
+            SDL_Event sdlEvent = {};
+            switch (mouseEvent.type)
+            {
+                case Inputs::MouseEvent::MOTION:
+                    sdlEvent.type = SDL_EVENT_MOUSE_MOTION;
+                    sdlEvent.motion.timestamp = mouseEvent.timestampNS;
+                    sdlEvent.motion.windowID = windowId;
+                    sdlEvent.motion.x = mouseEvent.x;
+                    sdlEvent.motion.y = mouseEvent.y;
+                    break;
+                case Inputs::MouseEvent::WHEEL:
+                    sdlEvent.type = SDL_EVENT_MOUSE_WHEEL;
+                    sdlEvent.wheel.timestamp = mouseEvent.timestampNS;
+                    sdlEvent.wheel.windowID = windowId;
+                    sdlEvent.wheel.x = mouseEvent.x;
+                    sdlEvent.wheel.y = mouseEvent.y;
+                    break;
+                default:
+                    sdlEvent.type = mouseEvent.type == Inputs::MouseEvent::BUTTON_DOWN ? SDL_EVENT_MOUSE_BUTTON_DOWN : SDL_EVENT_MOUSE_BUTTON_UP;
+                    sdlEvent.button.timestamp = mouseEvent.timestampNS;
+                    sdlEvent.button.windowID = windowId;
+                    sdlEvent.button.button = mouseEvent.button;
+                    sdlEvent.button.down = mouseEvent.type == Inputs::MouseEvent::BUTTON_DOWN;
+                    sdlEvent.button.x = mouseEvent.x;
+                    sdlEvent.button.y = mouseEvent.y;
+                    break;
+            }
+            ImGui_ImplSDL3_ProcessEvent(&sdlEvent);
+        }
+
+        // The backend polls the live cursor when the window is focused, the replayed one needs to come last
+        ImGui::GetIO().AddMousePosEvent(pSnapshot->cur.mouseX, pSnapshot->cur.mouseY);
+    }
+
     module::module(flecs::world& ecs)
     {
         ecs.import<Engine::module>();
+        ecs.import<Inputs::module>();
         ecs.import<RHI::module>();
+        ecs.import<RenderGraph::module>();
         ecs.import<Window::module>();
+        ecs.import<FontRendering::module>(); // its atlas gets rebuilt before the UI starts a frame
         
         ecs.module<module>();
 
         ecs.component<Context>();
         ecs.component<UI>();
 
+        // UI is drawn on top of everything else
+        RenderGraph::Pass renderPass = {};
+        renderPass.phase = Engine::UI_RENDER;
+        renderPass.writes = { RenderGraph::BACKBUFFER };
+
         // Create the context singleton
         Context context = {};
+        context.renderPass = ecs.entity("UIRenderPass").set<RenderGraph::Pass>(renderPass);
         ecs.set<Context>(context);
         
+        // ImGui is a single context, the UI only lives in the main window
         ecs.system<Engine::Canvas, Window::SDLWindow>("UI Initializer")
+            .with<Window::MainWindowTag>()
             .kind(flecs::OnLoad)
             .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
                 {
-                    ASSERTMSG(i == 0, "Only 1 window is supported.");
-
                     if (!it.world().has<Context>())
                         return;
 
@@ -71,8 +201,14 @@ namespace UI
                     if (!sdlWin.pSwapChain)
                         return;
 
+                    // Fonts come from the font rendering glyph atlas (shared with text), its context needs to be initialized first
+                    auto world = it.world();
+                    ImFontAtlas* pSharedAtlas = FontRendering::SharedAtlas(world);
+                    if (!pSharedAtlas)
+                        return;
+
                     IMGUI_CHECKVERSION();
-                    ImGui::CreateContext();
+                    ImGui::CreateContext(pSharedAtlas);
                     ImGuiIO& io = ImGui::GetIO();
                     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
                     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
@@ -91,30 +227,9 @@ namespace UI
                     ImGui_TheForge_Init(initDesc);
                     
                     // Cache content scale so we can handle it if it changes
-                    SDL_DisplayID const dispId = SDL_GetDisplayForWindow(sdlWin.pWindow);
-                    if (dispId == 0)
-                    {
-                        LOGF(eERROR, "SDL_GetDisplayForWindow() failed.");
-                    }
-                    else
-                    {
-                        pContext->contentScale = SDL_GetDisplayContentScale(dispId);
-                    }
-
-                    // Load default font
-                    unsigned int const actualFontSize = DEFAULT_IMGUI_FONT_SIZE * pContext->contentScale; // ImGui guidelines recommends getting the floor
-                    ImFontConfig fontConfig = ImFontConfig();
-                    fontConfig.SizePixels = static_cast<float>(actualFontSize);
-                    ImFont* pDefaultFont = io.Fonts->AddFontDefault(&fontConfig);
-                    ASSERT(pDefaultFont);
-
-                    pContext->loadedFonts[{DEFAULT_IMGUI_FONT_ID, actualFontSize}] = pDefaultFont;
-
-                    // Make it the imgui default
-                    io.FontDefault = pDefaultFont;
-
-                    // Build the atlas texture
-                    ImGui_TheForge_BuildFontAtlas(pRHI->pGfxQueue);
+                    Window::DisplayMetrics const* pDisplayMetrics = it.entity(i).has<Window::DisplayMetrics>() ? it.entity(i).get<Window::DisplayMetrics>() : nullptr;
+                    if (pDisplayMetrics)
+                        pContext->contentScale = pDisplayMetrics->contentScale;
 
                     // Ensure style is setup for content scale
                     ImGui::GetStyle().ScaleAllSizes(pContext->contentScale);
@@ -139,6 +254,20 @@ namespace UI
 
                     ImGui_ImplSDL3_NewFrame();
                     ImGui_TheForge_NewFrame();
+
+                    auto world = it.world();
+                    if (Inputs::IsReplaying())
+                        FeedReplayedInputs(world);
+
+                    Inputs::InputSnapshot const* pSnapshot = it.world().has<Inputs::InputSnapshot>() ? it.world().get<Inputs::InputSnapshot>() : nullptr;
+                    if (pSnapshot)
+                        FeedGamepads(*pSnapshot);
+
+                    // The default font at the current content scale (ImGui guidelines recommends getting the floor).
+                    // Fonts only live for a frame, the atlas could have been rebuilt since the last one.  Until it's rasterized, imgui falls back to its base font.
+                    unsigned int const defaultFontSize = static_cast<unsigned int>(DEFAULT_IMGUI_FONT_SIZE * pContext->contentScale);
+                    ImGui::GetIO().FontDefault = FontRendering::GetOrAddAtlasFont(world, FontRendering::BUILTIN_FONT, defaultFontSize);
+
                     ImGui::NewFrame();
                 }
             );
@@ -158,9 +287,31 @@ namespace UI
                     ui.Update(world);
                 });
 
-        ecs.system<Engine::Canvas, Window::SDLWindow>("UI Draw")
+        // Content scale changes are published by the window module (see Window::DisplayMetrics).
+        // Fonts for the new scale get rasterized as they're asked for.
+        ecs.observer<Window::DisplayMetrics>("UI Content Scaler")
+            .with<Window::MainWindowTag>()
+            .event(flecs::OnSet)
+            .each([](flecs::iter& it, size_t i, Window::DisplayMetrics const& displayMetrics)
+                {
+                    if (!it.world().has<Context>())
+                        return;
+
+                    Context* pContext = it.world().get_mut<Context>();
+                    if (!pContext->isInitialized || pContext->contentScale == displayMetrics.contentScale)
+                        return;
+
+                    // Update imgui style scales
+                    ImGui::GetStyle().ScaleAllSizes(displayMetrics.contentScale / pContext->contentScale);
+
+                    pContext->contentScale = displayMetrics.contentScale;
+                }
+            );
+
+        ecs.system<Engine::Canvas, Window::SDLWindow, RenderGraph::CanvasTarget>("UI Draw")
+            .with<Window::MainWindowTag>()
             .kind(Engine::GetCustomPhaseEntity(ecs, Engine::UI_RENDER))
-            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin)
+            .each([](flecs::iter& it, size_t i, Engine::Canvas const& canvas, Window::SDLWindow const& sdlWin, RenderGraph::CanvasTarget const& canvasTarget)
                 {
                     if (!it.world().has<Context>())
                         return;
@@ -169,8 +320,6 @@ namespace UI
                     if (!pContext->isInitialized)
                         return;
 
-                    ASSERTMSG(i == 0, "Drawing to more than one window not implemented.");
-
                     // TODO: we always call end frame and that might not be very performant
                     //       The assumption is that the UI frame pacer system always calls ImGui::NewFrame, even if there's no UI
                     ImGui::EndFrame();
@@ -184,133 +333,25 @@ namespace UI
 
                         if (pDrawData && pDrawData->Valid && pDrawData->TotalIdxCount > 0 && pDrawData->TotalVtxCount > 0)
                         {
-                            if (sdlWin.pCurRT)
+                            if (canvasTarget.pCurRT)
                             {
                                 Cmd* pCmd = pRHI->curCmdRingElem.pCmds[0];
                                 ASSERT(pCmd);
 
-                                cmdBeginDebugMarker(pCmd, 1, 0, 1, "ImGui Draw");
-
-                                BindRenderTargetsDesc bindRenderTargets = {};
-                                bindRenderTargets.mRenderTargetCount = 1;
-                                bindRenderTargets.mRenderTargets[0] = { sdlWin.pCurRT, LOAD_ACTION_LOAD };
-                                cmdBindRenderTargets(pCmd, &bindRenderTargets);
+                                auto world = it.world();
+                                if (RenderGraph::BeginPass(world, pCmd, pContext->renderPass, canvasTarget))
+                                {
+                                    cmdBeginDebugMarker(pCmd, 1, 0, 1, "ImGui Draw");
 
-                                ImGui_TheForge_RenderDrawData(pDrawData, pCmd);
+                                    ImGui_TheForge_RenderDrawData(pDrawData, pCmd);
 
-                                cmdBindRenderTargets(pCmd, nullptr);
+                                    cmdEndDebugMarker(pCmd);
 
-                                cmdEndDebugMarker(pCmd);
+                                    RenderGraph::EndPass(world, pCmd, pContext->renderPass);
+                                }
                             }
                         }
                     }
-
-                    // Handle content scale changes
-                    bool contentScaleChanged = false;
-                    float contentScale = 1.f;
-
-                    SDL_DisplayID const dispId = SDL_GetDisplayForWindow(sdlWin.pWindow);
-                    if (dispId == 0)
-                    {
-                        LOGF(eERROR, "SDL_GetDisplayForWindow() failed.");
-                    }
-                    else
-                    {
-                        contentScale = SDL_GetDisplayContentScale(dispId);
-                    }
-
-                    if (pContext->contentScale != contentScale)
-                    {
-                        contentScaleChanged = true; 
-
-                        // Update imgui style scales
-                        ImGui::GetStyle().ScaleAllSizes(contentScale / pContext->contentScale);
-
-                        pContext->contentScale = contentScale;
-
-                        // Lets ensure we load up the default font for the new content scale
-                        unsigned int const actualFontSize = DEFAULT_IMGUI_FONT_SIZE * pContext->contentScale;
-                        if (pContext->loadedFonts.find({ DEFAULT_IMGUI_FONT_ID , actualFontSize }) == pContext->loadedFonts.end())
-                            pContext->fontsToLoad.insert({ DEFAULT_IMGUI_FONT_ID , actualFontSize });
-                    }
-
-                    // Load new fonts if needed and rebuild the atlas
-                    if (!pContext->fontsToLoad.empty())
-                    {
-                        // Clear the imgui font atlas (this will invalidate all the ImFont pointers we cached)
-                        ImGuiIO& io = ImGui::GetIO();
-                        io.FontDefault = nullptr; // This will get invalidated once we clear
-                        io.Fonts->Clear();
-
-                        // Start by readding all the already loaded fonts
-                        for (auto& loadedFontDesc : pContext->loadedFonts)
-                        {
-                            if (DEFAULT_IMGUI_FONT_ID == loadedFontDesc.first.first) // it was a default font
-                            {
-                                ImFontConfig fontConfig = ImFontConfig();
-                                fontConfig.SizePixels = static_cast<float>(loadedFontDesc.first.second);
-                                loadedFontDesc.second = io.Fonts->AddFontDefault(&fontConfig);
-                                ASSERT(loadedFontDesc.second);
-                            }
-                            else
-                            {
-                                void* pFontBuffer = fntGetRawFontData(loadedFontDesc.first.first);
-                                ASSERT(pFontBuffer);
-                                uint32_t fontBufferSize = fntGetRawFontDataSize(loadedFontDesc.first.first);
-
-                                ImFontConfig config = {};
-                                config.FontDataOwnedByAtlas = false;
-                                loadedFontDesc.second = io.Fonts->AddFontFromMemoryTTF(pFontBuffer, fontBufferSize, loadedFontDesc.first.second, &config, nullptr);
-                                ASSERT(loadedFontDesc.second);
-                            }
-                        }
-
-                        // Now handle the new ones to load
-                        for (auto const& newFontDesc : pContext->fontsToLoad)
-                        {
-                            ImFont* pFont = nullptr;
-
-                            if (DEFAULT_IMGUI_FONT_ID == newFontDesc.first) // it was a default font
-                            {
-                                ImFontConfig fontConfig = ImFontConfig();
-                                fontConfig.SizePixels = static_cast<float>(newFontDesc.second);
-                                pFont = io.Fonts->AddFontDefault(&fontConfig);
-                            }
-                            else
-                            {
-                                void* pFontBuffer = fntGetRawFontData(newFontDesc.first);
-                                ASSERT(pFontBuffer);
-                                uint32_t fontBufferSize = fntGetRawFontDataSize(newFontDesc.first);
-
-                                ImFontConfig config = {};
-                                config.FontDataOwnedByAtlas = false;
-                                pFont = io.Fonts->AddFontFromMemoryTTF(pFontBuffer, fontBufferSize, newFontDesc.second, &config, nullptr);
-                            }
-                            ASSERT(pFont);
-                            pContext->loadedFonts[{newFontDesc.first, newFontDesc.second}] = pFont;
-                        }
-
-                        // Rebuild the atlas
-                        ImGui_TheForge_BuildFontAtlas(pRHI->pGfxQueue);
-
-                        // All loaded, we can clear the fontsToLoad set
-                        pContext->fontsToLoad.clear();
-                    }
-
-                    // If content scale changed, we need to reset the default font for the target content scale
-                    if (contentScaleChanged)
-                    {
-                        unsigned int const actualFontSize = DEFAULT_IMGUI_FONT_SIZE * pContext->contentScale;
-                        if (pContext->loadedFonts.find({ DEFAULT_IMGUI_FONT_ID , actualFontSize }) != pContext->loadedFonts.end())
-                        {
-                            ImGui::GetIO().FontDefault = pContext->loadedFonts.at({DEFAULT_IMGUI_FONT_ID , actualFontSize});
-                        }
-                        else
-                        {
-                            ASSERTMSG(false, "Default ImGui font for target content scale was not loaded.  Defaulting to first loaded font.");
-                            ImGui::GetIO().FontDefault = nullptr;
-                        }
-                    }
                 }
             );
     }
@@ -331,10 +372,31 @@ namespace UI
         }
     }
 
+    static bool IsLiveInputEvent(SDL_Event const* sdlEvent)
+    {
+        switch (sdlEvent->type)
+        {
+            case SDL_EVENT_KEY_DOWN:
+            case SDL_EVENT_KEY_UP:
+            case SDL_EVENT_TEXT_INPUT:
+            case SDL_EVENT_MOUSE_MOTION:
+            case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            case SDL_EVENT_MOUSE_BUTTON_UP:
+            case SDL_EVENT_MOUSE_WHEEL:
+                return true;
+            default:
+                return false;
+        }
+    }
+
     void module::ProcessEvent(flecs::world& ecs, const SDL_Event* sdlEvent)
     {
         Context const* pContext = ecs.has<Context>() ? ecs.get<Context>() : nullptr;
 
+        // Replays feed the recorded inputs instead (see UI Frame Pacer)
+        if (Inputs::IsReplaying() && IsLiveInputEvent(sdlEvent))
+            return;
+
         if (pContext && pContext->isInitialized)
         {
             ImGui_ImplSDL3_ProcessEvent(sdlEvent);
@@ -354,44 +416,20 @@ namespace UI
         return false;
     }
 
-    ImFont* GetOrAddFont(flecs::world& ecs, FontRendering::eAvailableFonts const font, float const size)
+    ImFont* GetOrAddFont(flecs::world& ecs, FontRendering::FontId const font, float const size)
     {
-        ASSERT(font < FontRendering::NUM_AVAILABLE_FONTS);
-
-        Context* pContext = ecs.has<Context>() ? ecs.get_mut<Context>() : nullptr;
+        Context const* pContext = ecs.has<Context>() ? ecs.get<Context>() : nullptr;
 
         if (pContext && pContext->isInitialized)
         {
-            // First check if a default font is there to fallback on for the current content scale
-            ImFont* pDefaultFont = nullptr;
-
-            std::pair<unsigned int, unsigned int> const defaultFontForCurContentScale = { DEFAULT_IMGUI_FONT_ID, static_cast<unsigned int>(DEFAULT_IMGUI_FONT_SIZE * pContext->contentScale) };
-            std::pair<unsigned int, unsigned int> const defaultFont = { DEFAULT_IMGUI_FONT_ID, static_cast<unsigned int>(DEFAULT_IMGUI_FONT_SIZE) };
-
-            if (pContext->loadedFonts.find(defaultFontForCurContentScale) != pContext->loadedFonts.end())
-                pDefaultFont = pContext->loadedFonts.at(defaultFontForCurContentScale);
-            else if (pContext->loadedFonts.find(defaultFont) != pContext->loadedFonts.end())
-                pDefaultFont = pContext->loadedFonts.at(defaultFont);
+            unsigned int const pixelSize = static_cast<unsigned int>(size * pContext->contentScale);
+            ImFont* pFont = FontRendering::GetOrAddAtlasFont(ecs, font, pixelSize);
+            if (pFont)
+                return pFont;
 
-            ASSERTMSG(pDefaultFont, "Default font was not loaded or cached!");
-            if (!pDefaultFont)
-                return nullptr;
-
-            // Now see if the requested font is available
-            unsigned int const fontId = FontRendering::InternalId(ecs, font);
-            unsigned int const actualSize = size * pContext->contentScale;
-
-            if (pContext->loadedFonts.find({ fontId, actualSize }) != pContext->loadedFonts.end())
-            {
-                // it is so return it
-                return pContext->loadedFonts.at({ fontId, actualSize });
-            }
-            else
-            {
-                // need to load it.  Deffer it and return fallback
-                pContext->fontsToLoad.insert({ fontId, actualSize });
-                return pDefaultFont;
-            }
+            // Not rasterized yet (or not in the fonts manifest), fallback on the default font
+            ImGuiIO& io = ImGui::GetIO();
+            return io.FontDefault ? io.FontDefault : io.Fonts->Fonts[0];
         }
         
         return nullptr;
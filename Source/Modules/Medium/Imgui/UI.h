@@ -11,6 +11,7 @@
 // - [X] Being able to use external textures
 // - [X] Address non 1x DPI scale at init time (including fonts)
 // - [X] Address DPI changes at runtime (OS settings change and per monitor)
+// - [X] Glyphs shared with font rendering (one atlas for UI and text)
 // - [ ] Multi-viewport
 
 struct ImFont;
@@ -34,7 +35,8 @@ namespace UI
 	bool WantsCaptureInputs(flecs::world& ecs);
 
 	// This function will always return a valid ImFont* if the UI is currently initialized.
-	// A nullptr can be returned if UI is not initialized or if the default font failed to load for some reason.  In that case, don't call on ImGui::Push/PopFont()
-	// If the specified font was not yet loaded, it will be loaded at a deferred time and the default fallback font will be returned.
-	ImFont* GetOrAddFont(flecs::world& ecs, FontRendering::eAvailableFonts const font, float const size);
+	// A nullptr can be returned if UI is not initialized.  In that case, don't call on ImGui::Push/PopFont()
+	// If the specified font was not yet loaded, it will be loaded at a deferred time and the default fallback font will be returned (same if it's not in the fonts manifest).
+	// Fonts are rasterized in the font rendering glyph atlas (shared with FontText), the returned font is only valid for the current frame.
+	ImFont* GetOrAddFont(flecs::world& ecs, FontRendering::FontId const font, float const size);
 }
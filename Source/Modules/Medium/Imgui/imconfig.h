@@ -127,6 +127,9 @@
 //---- Debug Tools: Enable slower asserts
 //#define IMGUI_DEBUG_PARANOID
 
+//---- SDL3 backend: don't poll gamepads, UI.cpp feeds them from the inputs module's snapshot (see Inputs::InputSnapshot)
+#define IMGUI_IMPL_SDL3_DISABLE_GAMEPADS
+
 //---- Tip: You can add extra functions within the ImGui:: namespace from anywhere (e.g. your own sources/header files)
 /*
 namespace ImGui
@@ -733,6 +733,7 @@ void ImGui_ImplSDL3_SetGamepadMode(ImGui_ImplSDL3_GamepadMode mode, SDL_Gamepad*
     bd->GamepadMode = mode;
 }
 
+#ifndef IMGUI_IMPL_SDL3_DISABLE_GAMEPADS
 static void ImGui_ImplSDL3_UpdateGamepadButton(ImGui_ImplSDL3_Data* bd, ImGuiIO& io, ImGuiKey key, SDL_GamepadButton button_no)
 {
     bool merged_value = false;
@@ -811,6 +812,7 @@ static void ImGui_ImplSDL3_UpdateGamepads()
     ImGui_ImplSDL3_UpdateGamepadAnalog(bd, io, ImGuiKey_GamepadRStickUp,    SDL_GAMEPAD_AXIS_RIGHTY, -thumb_dead_zone, -32768);
     ImGui_ImplSDL3_UpdateGamepadAnalog(bd, io, ImGuiKey_GamepadRStickDown,  SDL_GAMEPAD_AXIS_RIGHTY, +thumb_dead_zone, +32767);
 }
+#endif
 
 static void ImGui_ImplSDL3_UpdateMonitors()
 {
@@ -891,8 +893,10 @@ void ImGui_ImplSDL3_NewFrame()
     ImGui_ImplSDL3_UpdateMouseData();
     ImGui_ImplSDL3_UpdateMouseCursor();
 
+#ifndef IMGUI_IMPL_SDL3_DISABLE_GAMEPADS
     // Update game controllers (if enabled and available)
     ImGui_ImplSDL3_UpdateGamepads();
+#endif
 }
 
 //--------------------------------------------------------------------------------------------------------
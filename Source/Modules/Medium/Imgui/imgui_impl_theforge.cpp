@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include <tinyimageformat/tinyimageformat_query.h>
@@ -6,6 +7,7 @@
 #include <IResourceLoader.h>
 #include <ILog.h>
 
+#include "Low/RHI.h"
 #include "imgui_impl_theforge.h"
 
 #define MAX_FRAMES 3u
@@ -25,16 +27,16 @@ struct ImGui_ImplTheForge_Data
 
     uintptr_t pDefaultFallbackFont = 0;
 
-    uint32_t mDynamicTexturesCount = 0;
+    std::vector<Texture*> dynamicTextures; // bound this frame, in the order of their descriptor set slots
     Shader* pShaderTextured[SAMPLE_COUNT_COUNT] = { nullptr };
     RootSignature* pRootSignatureTextured = nullptr;
     RootSignature* pRootSignatureTexturedMs = nullptr;
     DescriptorSet* pDescriptorSetUniforms = nullptr;
     DescriptorSet* pDescriptorSetTexture = nullptr;
-    Pipeline* pPipelineTextured[SAMPLE_COUNT_COUNT] = { nullptr };
+    RHI::PipelineHandle pipelineTextured[SAMPLE_COUNT_COUNT] = {}; // compiled async, the UI isn't drawn until ready
     Buffer* pVertexBuffer = nullptr;
     Buffer* pIndexBuffer = nullptr;
-    Buffer* pUniformBuffer[MAX_FRAMES] = { nullptr };
+    RHI::BufferRange uniformBuffer[MAX_FRAMES] = {}; // pooled
     
     Sampler* pDefaultSampler = nullptr;
     VertexLayout mVertexLayoutTextured = {};
@@ -109,16 +111,10 @@ bool ImGui_TheForge_Init(ImGui_ImplTheForge_InitDesc const& initDesc)
     ibDesc.ppBuffer = &pBD->pIndexBuffer;
     addResource(&ibDesc, nullptr);
 
-    BufferLoadDesc ubDesc = {};
-    ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
-    ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
-    ubDesc.mDesc.mSize = sizeof(float) * 16;
-    vbDesc.mDesc.pName = "UI Uniform Buffer";
+    // A single matrix per frame, sub-allocated from the RHI pool
     for (uint32_t i = 0; i < pBD->mFrameCount; ++i)
     {
-        ubDesc.ppBuffer = &pBD->pUniformBuffer[i];
-        addResource(&ubDesc, nullptr);
+        pBD->uniformBuffer[i] = RHI::AddPooledBuffer(RHI::BUFFER_POOL_UNIFORMS, sizeof(float) * 16);
     }
 
     VertexLayout* vertexLayout = &pBD->mVertexLayoutTextured;
@@ -168,9 +164,11 @@ bool ImGui_TheForge_Init(ImGui_ImplTheForge_InitDesc const& initDesc)
 
     for (uint32_t i = 0; i < pBD->mFrameCount; ++i)
     {
+        DescriptorDataRange range = { (uint32_t)pBD->uniformBuffer[i].offset, (uint32_t)pBD->uniformBuffer[i].size };
         DescriptorData params[1] = {};
         params[0].pName = "uniformBlockVS";
-        params[0].ppBuffers = &pBD->pUniformBuffer[i];
+        params[0].ppBuffers = &pBD->uniformBuffer[i].pBuffer;
+        params[0].pRanges = &range;
         updateDescriptorSet(pBD->pRenderer, i, pBD->pDescriptorSetUniforms, 1, params);
     }
 
@@ -210,7 +208,7 @@ bool ImGui_TheForge_Init(ImGui_ImplTheForge_InitDesc const& initDesc)
     for (uint32_t s = 0; s < TF_ARRAY_COUNT(pBD->pShaderTextured); ++s)
     {
         pipelineDesc.pShaderProgram = pBD->pShaderTextured[s];
-        addPipeline(pBD->pRenderer, &desc, &pBD->pPipelineTextured[s]);
+        pBD->pipelineTextured[s] = RHI::AddPipelineAsync(pBD->pRenderer, desc);
     }
 
     return true;
@@ -228,7 +226,7 @@ void ImGui_TheForge_Shutdown()
 
     for (uint32_t s = 0; s < TF_ARRAY_COUNT(pBD->pShaderTextured); ++s)
     {
-        removePipeline(pBD->pRenderer, pBD->pPipelineTextured[s]);
+        RHI::RemovePipelineAsync(pBD->pRenderer, pBD->pipelineTextured[s]);
     }
 
     for (uint32_t s = 0; s < TF_ARRAY_COUNT(pBD->pShaderTextured); ++s)
@@ -245,11 +243,7 @@ void ImGui_TheForge_Shutdown()
     removeResource(pBD->pIndexBuffer);
     for (uint32_t i = 0; i < pBD->mFrameCount; ++i)
     {
-        if (pBD->pUniformBuffer[i])
-        {
-            removeResource(pBD->pUniformBuffer[i]);
-            pBD->pUniformBuffer[i] = NULL;
-        }
+        RHI::RemovePooledBuffer(pBD->uniformBuffer[i]);
     }
 
     if (pBD->pFontTex)
@@ -262,7 +256,7 @@ void ImGui_TheForge_NewFrame()
 {
     ImGui_ImplTheForge_Data* bd = ImGui_ImplTheForge_GetBackendData();
     ASSERT(bd != nullptr && "Context or backend not initialized! Did you call ImGui_ImplTheForge_Init()?");
-    bd->mDynamicTexturesCount = 0u;
+    bd->dynamicTextures.clear();
 }
 
 static void cmdPrepareRenderingForUI(
@@ -283,7 +277,7 @@ static void cmdPrepareRenderingForUI(
         { (R + L) / (L - R), (T + B) / (B - T), 0.5f, 1.0f },
     };
 
-    BufferUpdateDesc update = { pBD->pUniformBuffer[pBD->mFrameIdx] };
+    BufferUpdateDesc update = { pBD->uniformBuffer[pBD->mFrameIdx].pBuffer, pBD->uniformBuffer[pBD->mFrameIdx].offset, sizeof(mvp) };
     beginUpdateResource(&update);
     memcpy(update.pMappedData, &mvp, sizeof(mvp));
     endUpdateResource(&update);
@@ -325,29 +319,42 @@ static void cmdDrawUICommand(ImGui_ImplTheForge_Data* pBD, Cmd* pCmd, const ImDr
     uint32_t  setIndex = (uint32_t)id;
     if (id != FONT_TEXTURE_INDEX) // it's not a font, it's an external texture
     {
-        if (pBD->mDynamicTexturesCount >= pBD->mMaxDynamicUIUpdatesPerBatch)
-        {
-            LOGF(eWARNING,
-                "Too many dynamic UIs.  Consider increasing 'mMaxDynamicUIUpdatesPerBatch' when initializing the user interface.");
-            return;
-        }
-
+        // Each texture gets a slot once per frame, no matter how many draws use it (eg. glyph atlas pages)
         Texture* tex = (Texture*)pImDrawCmd->TextureId;
-        setIndex = 1 + ((ptrdiff_t)pBD->mFrameIdx * pBD->mMaxDynamicUIUpdatesPerBatch +
-            pBD->mDynamicTexturesCount++);
+        auto const texIt = std::find(pBD->dynamicTextures.begin(), pBD->dynamicTextures.end(), tex);
+        uint32_t const dynamicIndex = (uint32_t)(texIt - pBD->dynamicTextures.begin());
 
+        setIndex = 1 + ((ptrdiff_t)pBD->mFrameIdx * pBD->mMaxDynamicUIUpdatesPerBatch + dynamicIndex);
 
-        DescriptorData params[1] = {};
-        params[0].pName = "uTex";
-        params[0].ppTextures = &tex;
-        updateDescriptorSet(pBD->pRenderer, setIndex, pBD->pDescriptorSetTexture, 1, params);
+        if (texIt == pBD->dynamicTextures.end())
+        {
+            if (pBD->dynamicTextures.size() >= pBD->mMaxDynamicUIUpdatesPerBatch)
+            {
+                LOGF(eWARNING,
+                    "Too many dynamic UIs.  Consider increasing 'mMaxDynamicUIUpdatesPerBatch' when initializing the user interface.");
+                return;
+            }
+            pBD->dynamicTextures.push_back(tex);
 
-        uint32_t pipelineIndex = (uint32_t)log2(params[0].ppTextures[0]->mSampleCount);
-        *ppPipelineInOut = pBD->pPipelineTextured[pipelineIndex];
+            DescriptorData params[1] = {};
+            params[0].pName = "uTex";
+            params[0].ppTextures = &tex;
+            updateDescriptorSet(pBD->pRenderer, setIndex, pBD->pDescriptorSetTexture, 1, params);
+        }
+
+        uint32_t pipelineIndex = (uint32_t)log2(tex->mSampleCount);
+        *ppPipelineInOut = RHI::GetPipeline(pBD->pipelineTextured[pipelineIndex]);
     }
     else
     {
-        *ppPipelineInOut = pBD->pPipelineTextured[0];
+        *ppPipelineInOut = RHI::GetPipeline(pBD->pipelineTextured[0]);
+    }
+
+    if (!*ppPipelineInOut) // still compiling, skip the draw
+    {
+        globalIdxOffsetInOut += indexCount;
+        globalVtxOffsetInOut += vertexCount;
+        return;
     }
 
     if (*ppPrevPipelineInOut != *ppPipelineInOut)
@@ -373,6 +380,11 @@ void ImGui_TheForge_RenderDrawData(ImDrawData* pImDrawData, Cmd* pCmd)
     ImGui_ImplTheForge_Data* pBD = ImGui_ImplTheForge_GetBackendData();
     ASSERT(pBD != nullptr && "Context or backend not initialized! Did you call ImGui_ImplTheForge_Init()?");
 
+    // Nothing can be drawn until the main pipeline is compiled
+    Pipeline* pPipeline = RHI::GetPipeline(pBD->pipelineTextured[0]);
+    if (!pPipeline)
+        return;
+
     float2 displayPos(pImDrawData->DisplayPos.x, pImDrawData->DisplayPos.y);
     float2 displaySize(pImDrawData->DisplaySize.x, pImDrawData->DisplaySize.y);
 
@@ -420,7 +432,6 @@ void ImGui_TheForge_RenderDrawData(ImDrawData* pImDrawData, Cmd* pCmd)
         idxDst += round_up_64(idxSize, sizeof(ImDrawIdx));
     }
 
-    Pipeline* pPipeline = pBD->pPipelineTextured[0];
     Pipeline* pPreviousPipeline = pPipeline;
     uint32_t  prevSetIndex = UINT32_MAX;
 